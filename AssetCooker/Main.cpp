@@ -0,0 +1,305 @@
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+#include <S2D_Assets.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <filesystem>
+
+static void PrintUsage()
+{
+    printf("S2D Asset Cooker\n\n");
+    printf("Usage:\n");
+    printf("  AssetCooker cook <image> [output" S2D_COOKED_TEXTURE_EXT "] [--straight] [--uncompressed] [--trim]\n");
+    printf("      Cooks an image into a texture the engine uploads without any conversion\n");
+    printf("      --straight      Keep the straight (not premultiplied) alpha\n");
+    printf("      --uncompressed  Don't compress the pixels with LZ4\n");
+    printf("      --trim          Cut off the fully transparent borders\n\n");
+    printf("  AssetCooker bench <image> <cooked" S2D_COOKED_TEXTURE_EXT "> [iterations]\n");
+    printf("      Compares the load times of the image and its cooked texture\n\n");
+    printf("  AssetCooker pack <directory> [output" S2D_PACK_EXT "] [--compress] [--align <bytes>]\n");
+    printf("      Packs all the files of a directory, paths inside the pack are relative to it\n");
+    printf("      --compress      Compress the entries with LZ4 (when it makes them smaller)\n");
+    printf("      --align         Alignment of the entries (16 bytes by default)\n");
+}
+
+static double GetMilliseconds(Uint64 start, Uint64 end)
+{
+    return (double)(end - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static Sint64 GetFileSize(const char* path)
+{
+    SDL_RWops* file = SDL_RWFromFile(path, "rb");
+    if (!file) return -1;
+
+    Sint64 size = SDL_RWsize(file);
+    SDL_RWclose(file);
+
+    return size;
+}
+
+static int Cook(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    S2DCookSettings settings;
+    const char* input = argv[2];
+    std::string output;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--straight") == 0) settings.premultiply = false;
+        else if (strcmp(argv[i], "--uncompressed") == 0) settings.compress = false;
+        else if (strcmp(argv[i], "--trim") == 0) settings.trim = true;
+        else if (argv[i][0] != '-' && output.empty()) output = argv[i];
+        else
+        {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Replace the extension of the input by default
+    if (output.empty())
+    {
+        output = input;
+
+        size_t dot = output.find_last_of('.');
+        size_t slash = output.find_last_of("/\\");
+
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+            output.erase(dot);
+
+        output += S2D_COOKED_TEXTURE_EXT;
+    }
+
+    if (!S2DCookedTexture::CookFile(input, output.c_str(), settings))
+    {
+        printf("Cannot cook %s: %s\n", input, SDL_GetError());
+        return 1;
+    }
+
+    printf("%s -> %s (%lld -> %lld bytes)\n", input, output.c_str(), (long long)GetFileSize(input), (long long)GetFileSize(output.c_str()));
+
+    return 0;
+}
+
+struct LoadTimes
+{
+    double decode = 0.0, upload = 0.0;
+};
+
+// Loads an image like LoadTexture does without a cooked texture
+static bool LoadImageFile(SDL_Renderer* renderer, const char* path, LoadTimes& times)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    SDL_Surface* surface = S2DCookedTexture::DecodeImage(path);
+    if (!surface) return false;
+
+    Uint64 decoded = SDL_GetPerformanceCounter();
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_RenderCopy(renderer, texture, NULL, NULL); // Make the driver really upload it
+
+    Uint64 uploaded = SDL_GetPerformanceCounter();
+
+    SDL_DestroyTexture(texture);
+    SDL_FreeSurface(surface);
+
+    times.decode += GetMilliseconds(start, decoded);
+    times.upload += GetMilliseconds(decoded, uploaded);
+
+    return texture != NULL;
+}
+
+// Loads an cooked texture like LoadTexture does
+static bool LoadCooked(SDL_Renderer* renderer, const char* path, LoadTimes& times)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    SDL_Surface* surface = S2DCookedTexture::Load(path, NULL);
+    if (!surface) return false;
+
+    Uint64 decoded = SDL_GetPerformanceCounter();
+
+    SDL_Texture* texture = SDL_CreateTexture(renderer, surface->format->format, SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+
+    if (texture)
+    {
+        SDL_UpdateTexture(texture, NULL, surface->pixels, surface->pitch);
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
+    }
+
+    Uint64 uploaded = SDL_GetPerformanceCounter();
+
+    SDL_DestroyTexture(texture);
+    SDL_FreeSurface(surface);
+
+    times.decode += GetMilliseconds(start, decoded);
+    times.upload += GetMilliseconds(decoded, uploaded);
+
+    return texture != NULL;
+}
+
+static int Bench(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* image = argv[2];
+    const char* cooked = argv[3];
+    int iterations = argc > 4 ? SDL_max(atoi(argv[4]), 1) : 20;
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    {
+        printf("Cannot initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_Window* window = SDL_CreateWindow("S2D Asset Cooker", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64, 64, SDL_WINDOW_HIDDEN);
+    SDL_Renderer* renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED) : NULL;
+
+    if (window && !renderer) renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+
+    if (!renderer)
+    {
+        printf("Cannot create renderer: %s\n", SDL_GetError());
+        if (window) SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+    SDL_RendererInfo info;
+    SDL_GetRendererInfo(renderer, &info);
+
+    LoadTimes imageTimes, cookedTimes;
+    bool success = true;
+
+    // The first loads warm up the file cache and the image libraries
+    LoadTimes warmup;
+    success &= LoadImageFile(renderer, image, warmup);
+    success &= LoadCooked(renderer, cooked, warmup);
+
+    for (int i = 0; i < iterations && success; i++)
+    {
+        success &= LoadImageFile(renderer, image, imageTimes);
+        success &= LoadCooked(renderer, cooked, cookedTimes);
+    }
+
+    if (success)
+    {
+        double imageTotal = (imageTimes.decode + imageTimes.upload) / iterations;
+        double cookedTotal = (cookedTimes.decode + cookedTimes.upload) / iterations;
+
+        printf("Renderer: %s, %d iterations\n\n", info.name, iterations);
+        printf("%-8s %12s %12s %12s %12s\n", "", "File (KB)", "Decode (ms)", "Upload (ms)", "Total (ms)");
+        printf("%-8s %12.1f %12.3f %12.3f %12.3f\n", "Image", GetFileSize(image) / 1024.0, imageTimes.decode / iterations, imageTimes.upload / iterations, imageTotal);
+        printf("%-8s %12.1f %12.3f %12.3f %12.3f\n", "Cooked", GetFileSize(cooked) / 1024.0, cookedTimes.decode / iterations, cookedTimes.upload / iterations, cookedTotal);
+        printf("\nCooked texture loads %.2fx faster\n", cookedTotal > 0.0 ? imageTotal / cookedTotal : 0.0);
+    }
+    else
+    {
+        printf("Cannot load the textures: %s\n", SDL_GetError());
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return success ? 0 : 1;
+}
+
+static int Pack(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::filesystem::path directory = argv[2];
+    std::string output;
+    bool compress = false;
+    Uint32 alignment = 16;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--compress") == 0) compress = true;
+        else if (strcmp(argv[i], "--align") == 0 && i + 1 < argc) alignment = (Uint32)SDL_max(atoi(argv[++i]), 1);
+        else if (argv[i][0] != '-' && output.empty()) output = argv[i];
+        else
+        {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::error_code error;
+
+    if (!std::filesystem::is_directory(directory, error))
+    {
+        printf("%s is not a directory\n", argv[2]);
+        return 1;
+    }
+
+    if (output.empty())
+    {
+        // Next to the directory by default
+        std::filesystem::path normalized = std::filesystem::absolute(directory, error).lexically_normal();
+        if (!normalized.has_filename()) normalized = normalized.parent_path();
+
+        output = normalized.string() + S2D_PACK_EXT;
+    }
+
+    S2DPackWriter writer;
+
+    for (auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+    {
+        if (!entry.is_regular_file()) continue;
+
+        std::string file = entry.path().string();
+        std::string packPath = entry.path().lexically_relative(directory).generic_string();
+
+        // Don't pack the output into itself
+        if (std::filesystem::equivalent(entry.path(), output, error)) continue;
+
+        if (!writer.AddFile(packPath.c_str(), file.c_str()))
+        {
+            printf("Cannot read %s: %s\n", file.c_str(), SDL_GetError());
+            return 1;
+        }
+    }
+
+    if (!writer.Write(output.c_str(), compress, alignment))
+    {
+        printf("Cannot write %s: %s\n", output.c_str(), SDL_GetError());
+        return 1;
+    }
+
+    printf("%s: %d files, %lld bytes\n", output.c_str(), writer.GetEntryCount(), (long long)GetFileSize(output.c_str()));
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    SDL_SetMainReady();
+
+    if (argc >= 2 && strcmp(argv[1], "cook") == 0) return Cook(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) return Bench(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "pack") == 0) return Pack(argc, argv);
+
+    PrintUsage();
+
+    return argc < 2 ? 0 : 1;
+}
@@ -252,6 +252,9 @@ void GameStudioApp::OnRender()
         }
     }
 
+    // Draw everything batched so far before ImGui renders through Direct3D
+    Graphics->FlushBatch();
+
     ImGui::Render();
     ImGui_ImplDX9_RenderDrawData(ImGui::GetDrawData());
 }
\ No newline at end of file
@@ -0,0 +1,165 @@
+#define SDL_MAIN_HANDLED
+#include <S2D_Misc.h>
+#include <S2D_Graphics.h>
+#include <S2D_Jobs.h>
+#include <S2D_FrameGraph.h>
+#include <S2D_Particles.h>
+#include <S2D_Core.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+EngineInitSettings settings;
+
+// The scene has to keep this many particles at this framerate
+#define TARGET_PARTICLES 100000
+#define TARGET_FPS 60.0f
+
+static int particleCount = 100000;
+static int frameCount = 600;
+static bool useSIMD = true;
+static bool useJobs = true;
+static int workerCount = 0;
+
+static void PrintUsage()
+{
+    printf("S2D Particle Benchmark\n\n");
+    printf("Usage:\n");
+    printf("  ParticleBench [--particles <count>] [--frames <count>] [--scalar] [--serial] [--workers <count>] [--render-thread] [--window]\n");
+    printf("      Runs a scene with a fountain of particles and prints the frame timings\n");
+    printf("      --particles     Number of living particles (100000 by default, the target needs at least that many)\n");
+    printf("      --frames        Number of rendered frames (600 by default)\n");
+    printf("      --scalar        Update the particles without SIMD\n");
+    printf("      --serial        Update the particles on the main thread only\n");
+    printf("      --workers       Number of job worker threads (one per CPU core by default)\n");
+    printf("      --render-thread Draw the recorded frames on a render thread\n");
+    printf("      --window        Show the window instead of running headless\n");
+}
+
+class ParticleBench : public S2DGame
+{
+public:
+    S2DCamera cam;
+    S2DParticleSystem* particles = nullptr;
+
+    double updateTotal = 0.0;
+    int updates = 0;
+
+    void OnInit()
+    {
+        particles = new S2DParticleSystem(particleCount);
+        particles->SetSIMD(useSIMD);
+        particles->SetGravity(Vec2(0.0f, 4.0f));
+        particles->SetDrag(0.2f);
+        particles->SetColors(Color(255, 200, 60, 255), Color(255, 40, 10, 0));
+        particles->SetSizeOverLife(1.0f, 0.25f);
+
+        // Four fountains spawning enough particles to keep the pool full (with headroom for the lifetimes dying out together)
+        for (int i = 0; i < 4; i++)
+        {
+            S2DParticleEmitter emitter;
+            emitter.position.x = -6.0f + i * 4.0f;
+            emitter.position.y = 6.0f;
+            emitter.area.x = 0.5f;
+            emitter.area.y = 0.0f;
+            emitter.spread = 40.0f;
+            emitter.minSpeed = 6.0f;
+            emitter.maxSpeed = 10.0f;
+            emitter.minLifetime = 1.5f;
+            emitter.maxLifetime = 2.5f;
+            emitter.minSize = 2.0f;
+            emitter.maxSize = 4.0f;
+            emitter.rate = particleCount / 2.0f / 4.0f * 1.5f;
+
+            particles->AddEmitter(emitter);
+        }
+
+        // Run the emitters until the pool is full, so the measured frames draw all the particles
+        for (int i = 0; i < 60 * 3; i++)
+            particles->Update(1.0f / 60.0f);
+
+        FrameGraph->AddSystem("Particles", [this](float) { UpdateParticles(); }, {}, { "Particles" });
+
+        printf("Particles: %d/%d, %s update, %d job workers\n", particles->GetCount(), particles->GetMaxCount(), useSIMD ? "SIMD" : "scalar", useJobs ? Jobs->GetWorkerCount() : 0);
+
+        if (settings.renderThread && !Graphics->GetRenderThread())
+            printf("The renderer can't be used from a render thread, drawing on the main thread\n");
+    }
+
+    void UpdateParticles()
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+
+        // A fixed step keeps the number of particles stable between runs
+        particles->Update(1.0f / 60.0f, useJobs ? Jobs : nullptr);
+
+        updateTotal += (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        updates++;
+    }
+
+    void OnRender()
+    {
+        Graphics->RenderParticles(&cam, particles);
+    }
+
+    void OnQuit()
+    {
+        S2DBatchStats stats = Graphics->GetBatchStats();
+
+        printf("Particles: %d, update: avg %.3f ms, last frame: %d vertices in %d draw calls\n",
+               particles->GetCount(), updates > 0 ? updateTotal / updates : 0.0, stats.vertices, stats.drawCalls);
+
+        if (!stats.geometry)
+            printf("SDL_RenderGeometry is not available (SDL older than 2.0.18), textured quads are drawn one by one\n");
+
+        S2DFrameStats frames = GetFrameStats();
+
+        bool passed = particles->GetCount() >= TARGET_PARTICLES && frames.averageFps >= TARGET_FPS;
+
+        printf("Target %d particles at %.0f FPS: %s (%d particles, avg %.1f FPS, 1%% low %.1f FPS)\n",
+               TARGET_PARTICLES, TARGET_FPS, passed ? "PASS" : "FAIL", particles->GetCount(), frames.averageFps, frames.onePercentLowFps);
+        fflush(stdout);
+    }
+
+    ParticleBench() : S2DGame(&settings) {}
+};
+
+int main(int argc, char** argv)
+{
+    bool headless = true;
+    bool renderThread = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--particles") && i + 1 < argc)
+            particleCount = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            frameCount = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--scalar"))
+            useSIMD = false;
+        else if (!strcmp(argv[i], "--serial"))
+            useJobs = false;
+        else if (!strcmp(argv[i], "--workers") && i + 1 < argc)
+            workerCount = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--render-thread"))
+            renderThread = true;
+        else if (!strcmp(argv[i], "--window"))
+            headless = false;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    settings = { "S2D Particle Benchmark", 0, new ScreenResolution {1280, 720}, false };
+    settings.headless = headless;
+    settings.headlessFrames = frameCount;
+    settings.jobWorkers = workerCount;
+    settings.renderThread = renderThread;
+
+    ParticleBench* game = new ParticleBench();
+    game->Run(nullptr);
+
+    return 0;
+}
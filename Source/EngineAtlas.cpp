@@ -0,0 +1,223 @@
+#include "EngineIncludes.h"
+
+// ImGui keeps its copy of the packer static, so it's compiled in here too (not all of its functions are used)
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable: 4505) // unreferenced local function has been removed
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "ImGui/imstb_rectpack.h"
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+// Converts an image into the atlas page format (the original surface is kept)
+static SDL_Surface* ConvertAtlasImage(SDL_Surface* surface)
+{
+    if (!surface) return nullptr;
+
+    return SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+}
+
+// Finds the smallest rectangle containing all the visible pixels of an ARGB8888 image
+static SDL_Rect TrimAtlasImage(SDL_Surface* image)
+{
+    int minX = image->w, minY = image->h, maxX = -1, maxY = -1;
+
+    for (int y = 0; y < image->h; y++)
+    {
+        const Uint32* row = (const Uint32*)((const Uint8*)image->pixels + y * image->pitch);
+
+        for (int x = 0; x < image->w; x++)
+        {
+            if ((row[x] >> 24) == 0) continue;
+
+            minX = SDL_min(minX, x);
+            maxX = SDL_max(maxX, x);
+            minY = SDL_min(minY, y);
+            maxY = SDL_max(maxY, y);
+        }
+    }
+
+    // Fully transparent images keep a single pixel
+    if (maxX < 0) return { 0, 0, 1, 1 };
+
+    return { minX, minY, maxX - minX + 1, maxY - minY + 1 };
+}
+
+std::vector<int> S2DGraphics::BuildAtlas(const std::vector<const char*>& paths, const S2DAtlasSettings& settings)
+{
+    std::vector<SDL_Surface*> images;
+    std::vector<std::string> normalized;
+
+    for (auto path : paths)
+    {
+        SDL_Surface* surface = Assets::LoadImageSurface(path);
+
+        images.push_back(ConvertAtlasImage(surface));
+        normalized.push_back(path ? S2DTextureCache::NormalizePath(path) : std::string());
+
+        if (surface) SDL_FreeSurface(surface);
+    }
+
+    return PackAtlas(images, normalized, settings);
+}
+
+std::vector<int> S2DGraphics::BuildAtlas(const std::vector<SDL_Surface*>& surfaces, const S2DAtlasSettings& settings)
+{
+    std::vector<SDL_Surface*> images;
+
+    for (auto surface : surfaces)
+    {
+        images.push_back(ConvertAtlasImage(surface));
+    }
+
+    return PackAtlas(images, std::vector<std::string>(images.size()), settings);
+}
+
+std::vector<int> S2DGraphics::PackAtlas(std::vector<SDL_Surface*>& images, const std::vector<std::string>& paths, const S2DAtlasSettings& settings)
+{
+    S2DProfileZone("Build Atlas");
+
+    std::vector<int> handles(images.size(), S2D_INVALID_TEXTURE);
+
+    int pageSize = SDL_max(settings.pageSize, 1);
+    int padding = SDL_max(settings.padding, 0);
+
+    // Stored part of every image
+    std::vector<SDL_Rect> stored(images.size());
+    std::vector<stbrp_rect> remaining;
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        if (!images[i]) continue;
+
+        stored[i] = settings.trim ? TrimAtlasImage(images[i]) : SDL_Rect{ 0, 0, images[i]->w, images[i]->h };
+
+        // Images bigger than a page can't be packed
+        if (stored[i].w + padding > pageSize || stored[i].h + padding > pageSize) continue;
+
+        stbrp_rect rect = {};
+        rect.id = (int)i;
+        rect.w = stored[i].w + padding;
+        rect.h = stored[i].h + padding;
+        remaining.push_back(rect);
+    }
+
+    std::vector<stbrp_node> nodes(pageSize);
+
+    while (!remaining.empty())
+    {
+        stbrp_context context;
+        stbrp_init_target(&context, pageSize, pageSize, nodes.data(), (int)nodes.size());
+        stbrp_pack_rects(&context, remaining.data(), (int)remaining.size());
+
+        SDL_Surface* pageSurface = SDL_CreateRGBSurfaceWithFormat(0, pageSize, pageSize, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!pageSurface) break;
+
+        SDL_FillRect(pageSurface, NULL, 0);
+
+        std::vector<stbrp_rect> packed, rest;
+
+        for (auto& rect : remaining)
+        {
+            if (!rect.was_packed)
+            {
+                rest.push_back(rect);
+                continue;
+            }
+
+            SDL_Surface* image = images[rect.id];
+            SDL_Rect target = { rect.x, rect.y, stored[rect.id].w, stored[rect.id].h };
+
+            // Copy the pixels as they are, including the alpha channel
+            SDL_SetSurfaceBlendMode(image, SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(image, &stored[rect.id], pageSurface, &target);
+
+            packed.push_back(rect);
+        }
+
+        // Nothing fits an empty page anymore
+        if (packed.empty())
+        {
+            SDL_FreeSurface(pageSurface);
+            break;
+        }
+
+        SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+
+        WaitRenderThread();
+
+        SDL_Texture* pageTexture = SDL_CreateTextureFromSurface(NativeRenderer, pageSurface);
+
+        if (!pageTexture)
+        {
+            SDL_FreeSurface(pageSurface);
+            break;
+        }
+
+        // The page keeps its pixels, there is no file to reload it from after a device reset
+        S2DTexture* page = new S2DTexture(pageTexture, NULL);
+        page->pixels = pageSurface;
+
+        if (Textures.Add(page) == S2D_INVALID_TEXTURE)
+        {
+            DestroyTexture(page);
+            break;
+        }
+
+        for (auto& rect : packed)
+        {
+            S2DTexture* sub = new S2DTexture(pageTexture, NULL);
+
+            sub->page = page;
+            sub->width = images[rect.id]->w;
+            sub->height = images[rect.id]->h;
+            sub->region = { rect.x, rect.y, stored[rect.id].w, stored[rect.id].h };
+            sub->trimX = stored[rect.id].x;
+            sub->trimY = stored[rect.id].y;
+
+            int handle = Textures.Add(sub);
+
+            if (handle == S2D_INVALID_TEXTURE)
+            {
+                delete sub;
+                continue;
+            }
+
+            page->subTextures++;
+
+            // Loading the path afterwards returns the packed image (if it isn't loaded already)
+            const std::string& path = paths[rect.id];
+
+            if (!path.empty() && !TextureCache.Contains(path))
+                sub->texPath = TextureCache.Insert(path, sub);
+
+            handles[rect.id] = handle;
+        }
+
+        // A page without any registered sub-texture is not needed
+        if (page->subTextures == 0)
+        {
+            Textures.Remove(page->textureID);
+            DestroyTexture(page);
+        }
+
+        remaining = rest;
+    }
+
+    for (auto image : images)
+    {
+        if (image) SDL_FreeSurface(image);
+    }
+
+    return handles;
+}
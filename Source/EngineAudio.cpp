@@ -1,5 +1,7 @@
 #include "EngineIncludes.h"
+#ifdef _WIN32
 #include <shlwapi.h>
+#endif // _WIN32
 
 int musicVolume = 100;
 int soundVolume = 100;
@@ -13,7 +15,7 @@ S2DMusicClip::S2DMusicClip(const char* path)
 
 S2DAudioClip::S2DAudioClip(const char* path)
 {
-    sndFile = Mix_LoadWAV(path);
+    sndFile = Mix_LoadWAV_RW(S2DFileSystem::Open(path), 1);
 }
 
 void S2DAudio::PlayAudioClip(S2DAudioClip* clip)
@@ -39,7 +41,8 @@ void S2DAudio::SetMusicClip(S2DMusicClip* clip, bool loop)
     }
     else
     {
-        clip->SetHandle(Mix_LoadMUS(clip->GetPath()));
+        // Music is streamed while it plays, packed music reads straight from the mapped pack
+        clip->SetHandle(Mix_LoadMUS_RW(S2DFileSystem::Open(clip->GetPath()), 1));
 
         Mix_PlayMusic(clip->GetHandle(), loop ? -1 : 0);
 
@@ -0,0 +1,301 @@
+#include "EngineIncludes.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define S2D_MATRIX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define S2D_MATRIX_NEON
+#include <arm_neon.h>
+#endif
+
+S2DMatrix2D S2DMatrix2D::Translation(float x, float y)
+{
+    S2DMatrix2D m;
+    m.tx = x;
+    m.ty = y;
+    return m;
+}
+
+S2DMatrix2D S2DMatrix2D::Rotation(float angle)
+{
+    float radians = angle * ((float)M_PI / 180.0f);
+
+    S2DMatrix2D m;
+    m.a = cosf(radians);
+    m.b = sinf(radians);
+    m.c = -m.b;
+    m.d = m.a;
+    return m;
+}
+
+S2DMatrix2D S2DMatrix2D::Scale(float x, float y)
+{
+    S2DMatrix2D m;
+    m.a = x;
+    m.d = y;
+    return m;
+}
+
+S2DMatrix2D S2DMatrix2D::operator*(const S2DMatrix2D& other) const
+{
+    S2DMatrix2D m;
+    m.a = a * other.a + c * other.b;
+    m.b = b * other.a + d * other.b;
+    m.c = a * other.c + c * other.d;
+    m.d = b * other.c + d * other.d;
+    m.tx = a * other.tx + c * other.ty + tx;
+    m.ty = b * other.tx + d * other.ty + ty;
+    return m;
+}
+
+S2DMatrix2D S2DMatrix2D::Inverse() const
+{
+    float det = a * d - b * c;
+    if (det == 0.0f) return S2DMatrix2D();
+
+    S2DMatrix2D m;
+    m.a = d / det;
+    m.b = -b / det;
+    m.c = -c / det;
+    m.d = a / det;
+    m.tx = -(m.a * tx + m.c * ty);
+    m.ty = -(m.b * tx + m.d * ty);
+    return m;
+}
+
+void S2DMatrix2D::TransformPoints(const SDL_FPoint* in, SDL_FPoint* out, int count) const
+{
+    int i = 0;
+
+#if defined(S2D_MATRIX_SSE2)
+    // Two interleaved points per register
+    __m128 ab = _mm_setr_ps(a, b, a, b);
+    __m128 cd = _mm_setr_ps(c, d, c, d);
+    __m128 t = _mm_setr_ps(tx, ty, tx, ty);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 p0 = _mm_loadu_ps(&in[i].x);
+        __m128 p1 = _mm_loadu_ps(&in[i + 2].x);
+
+        __m128 r0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p0, p0, _MM_SHUFFLE(2, 2, 0, 0)), ab), _mm_mul_ps(_mm_shuffle_ps(p0, p0, _MM_SHUFFLE(3, 3, 1, 1)), cd)), t);
+        __m128 r1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p1, p1, _MM_SHUFFLE(2, 2, 0, 0)), ab), _mm_mul_ps(_mm_shuffle_ps(p1, p1, _MM_SHUFFLE(3, 3, 1, 1)), cd)), t);
+
+        _mm_storeu_ps(&out[i].x, r0);
+        _mm_storeu_ps(&out[i + 2].x, r1);
+    }
+#elif defined(S2D_MATRIX_NEON)
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4x2_t p = vld2q_f32(&in[i].x);
+        float32x4x2_t r;
+
+        r.val[0] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(tx), p.val[0], a), p.val[1], c);
+        r.val[1] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(ty), p.val[0], b), p.val[1], d);
+
+        vst2q_f32(&out[i].x, r);
+    }
+#endif
+
+    for (; i < count; i++)
+        out[i] = Transform(in[i]);
+}
+
+void S2DMatrix2D::TransformPoints(const float* x, const float* y, SDL_FPoint* out, int count) const
+{
+    int i = 0;
+
+#if defined(S2D_MATRIX_SSE2)
+    __m128 ma = _mm_set1_ps(a), mb = _mm_set1_ps(b), mc = _mm_set1_ps(c), md = _mm_set1_ps(d);
+    __m128 mtx = _mm_set1_ps(tx), mty = _mm_set1_ps(ty);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 px = _mm_loadu_ps(&x[i]);
+        __m128 py = _mm_loadu_ps(&y[i]);
+
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, ma), _mm_mul_ps(py, mc)), mtx);
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, mb), _mm_mul_ps(py, md)), mty);
+
+        // Interleave the results into points
+        _mm_storeu_ps(&out[i].x, _mm_unpacklo_ps(rx, ry));
+        _mm_storeu_ps(&out[i + 2].x, _mm_unpackhi_ps(rx, ry));
+    }
+#elif defined(S2D_MATRIX_NEON)
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t px = vld1q_f32(&x[i]);
+        float32x4_t py = vld1q_f32(&y[i]);
+        float32x4x2_t r;
+
+        r.val[0] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(tx), px, a), py, c);
+        r.val[1] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(ty), px, b), py, d);
+
+        vst2q_f32(&out[i].x, r);
+    }
+#endif
+
+    for (; i < count; i++)
+        out[i] = Transform({ x[i], y[i] });
+}
+
+void S2DGraphics::UpdateCamera(S2DCamera* cam)
+{
+    Vec2Int scrSize = GetCurrentWindowSize();
+
+    if (cam->MatrixValid && cam->MatrixPosition == cam->Position && cam->MatrixZoom == cam->Zoom && cam->MatrixRotation == cam->Rotation &&
+        cam->MatrixViewport.x == cam->Viewport.x && cam->MatrixViewport.y == cam->Viewport.y &&
+        cam->MatrixViewport.w == cam->Viewport.w && cam->MatrixViewport.h == cam->Viewport.h && cam->MatrixScreen == scrSize)
+    {
+        return;
+    }
+
+    SDL_Rect& viewport = cam->ViewportRect;
+    viewport.x = (int)floorf(cam->Viewport.x * scrSize.x + 0.5f);
+    viewport.y = (int)floorf(cam->Viewport.y * scrSize.y + 0.5f);
+    viewport.w = (int)floorf(cam->Viewport.w * scrSize.x + 0.5f);
+    viewport.h = (int)floorf(cam->Viewport.h * scrSize.y + 0.5f);
+
+    cam->Scale = cam->Zoom > 0.0f ? cam->Zoom : 1.0f;
+
+    float radians = -cam->Rotation * ((float)M_PI / 180.0f);
+    cam->ScreenCos = cosf(radians);
+    cam->ScreenSin = sinf(radians);
+
+    // The viewport shows 16x16 world units around the camera (its Y axis points up), then the zoom and the rotation
+    // are applied around the center of the viewport
+    float unitX = viewport.w / 16.0f * cam->Scale;
+    float unitY = viewport.h / 16.0f * cam->Scale;
+
+    cam->Matrix = S2DMatrix2D::Translation((float)(viewport.x + viewport.w / 2), (float)(viewport.y + viewport.h / 2)) *
+                  S2DMatrix2D::Rotation(-cam->Rotation) *
+                  S2DMatrix2D::Scale(unitX, unitY) *
+                  S2DMatrix2D::Translation(-cam->Position.x, cam->Position.y);
+
+    cam->InverseMatrix = cam->Matrix.Inverse();
+
+    cam->MatrixPosition = cam->Position;
+    cam->MatrixZoom = cam->Zoom;
+    cam->MatrixRotation = cam->Rotation;
+    cam->MatrixViewport = cam->Viewport;
+    cam->MatrixScreen = scrSize;
+    cam->MatrixValid = true;
+}
+
+void S2DGraphics::SetDrawCamera(S2DCamera* cam)
+{
+    UpdateCamera(cam);
+
+    const SDL_Rect& viewport = cam->ViewportRect;
+
+    bool whole = viewport.x <= 0 && viewport.y <= 0 && viewport.x + viewport.w >= cam->MatrixScreen.x && viewport.y + viewport.h >= cam->MatrixScreen.y;
+
+    if (whole ? !Clipping : (Clipping && SDL_RectEquals(&viewport, &ClipRect))) return;
+
+    // The batched geometry was meant for the previous viewport
+    SpriteBatch.Flush();
+
+    SetRendererClip(whole ? NULL : &viewport);
+
+    ClipRect = viewport;
+    Clipping = !whole;
+}
+
+const S2DMatrix2D& S2DGraphics::GetViewMatrix(S2DCamera* cam)
+{
+    UpdateCamera(cam);
+
+    return cam->Matrix;
+}
+
+SDL_FPoint S2DGraphics::WorldToScreen(S2DCamera* cam, Vec2 pos)
+{
+    UpdateCamera(cam);
+
+    return cam->Matrix.Transform({ pos.x, pos.y });
+}
+
+void S2DGraphics::WorldToScreen(S2DCamera* cam, const SDL_FPoint* points, SDL_FPoint* out, int count)
+{
+    UpdateCamera(cam);
+
+    cam->Matrix.TransformPoints(points, out, count);
+}
+
+Vec2 S2DGraphics::ScreenToWorld(S2DCamera* cam, Vec2 pos)
+{
+    UpdateCamera(cam);
+
+    SDL_FPoint world = cam->InverseMatrix.Transform({ pos.x, pos.y });
+
+    return Vec2(world.x, world.y);
+}
+
+SDL_FRect S2DGraphics::GetCameraView(S2DCamera* cam)
+{
+    UpdateCamera(cam);
+
+    const SDL_Rect& viewport = cam->ViewportRect;
+
+    SDL_FPoint corners[4] = {
+        { (float)viewport.x, (float)viewport.y },
+        { (float)(viewport.x + viewport.w), (float)viewport.y },
+        { (float)(viewport.x + viewport.w), (float)(viewport.y + viewport.h) },
+        { (float)viewport.x, (float)(viewport.y + viewport.h) }
+    };
+
+    cam->InverseMatrix.TransformPoints(corners, corners, 4);
+
+    // Bounds of the (possibly rotated) viewport in the world
+    float minX = corners[0].x, minY = corners[0].y, maxX = corners[0].x, maxY = corners[0].y;
+
+    for (int i = 1; i < 4; i++)
+    {
+        minX = SDL_min(minX, corners[i].x);
+        minY = SDL_min(minY, corners[i].y);
+        maxX = SDL_max(maxX, corners[i].x);
+        maxY = SDL_max(maxY, corners[i].y);
+    }
+
+    return { minX, minY, maxX - minX, maxY - minY };
+}
+
+bool S2DGraphics::IsOnScreen(S2DCamera* cam, Vec2 pos, Vec2 size, float angle)
+{
+    UpdateCamera(cam);
+
+    SDL_FPoint screen = cam->Matrix.Transform({ pos.x, pos.y });
+
+    // Rotated objects can reach further than their size
+    bool rotated = angle != 0.0f || cam->Rotation != 0.0f;
+
+    float reachX = (rotated ? size.x + size.y : size.x) * cam->Scale;
+    float reachY = (rotated ? size.x + size.y : size.y) * cam->Scale;
+
+    const SDL_Rect& viewport = cam->ViewportRect;
+
+    return screen.x >= viewport.x - reachX && screen.x <= viewport.x + viewport.w + reachX &&
+           screen.y >= viewport.y - reachY && screen.y <= viewport.y + viewport.h + reachY;
+}
+
+SDL_FRect S2DGraphics::GetScreenRect(S2DCamera* cam, Vec2 pos, Vec2 center, Vec2 size, float& angle)
+{
+    UpdateCamera(cam);
+
+    SDL_FPoint anchor = cam->Matrix.Transform({ pos.x, pos.y });
+
+    float w = size.x * cam->Scale;
+    float h = size.y * cam->Scale;
+
+    // Offset of the rectangle center from its anchor, turned with the world
+    float offsetX = (0.5f - center.x) * w;
+    float offsetY = (0.5f - center.y) * h;
+
+    float centerX = anchor.x + offsetX * cam->ScreenCos - offsetY * cam->ScreenSin;
+    float centerY = anchor.y + offsetX * cam->ScreenSin + offsetY * cam->ScreenCos;
+
+    angle -= cam->Rotation;
+
+    return { centerX - w * 0.5f, centerY - h * 0.5f, w, h };
+}
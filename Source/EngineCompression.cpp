@@ -0,0 +1,211 @@
+#include "EngineIncludes.h"
+#include <string.h>
+
+// Limits of the LZ4 block format
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5     // The last bytes of a block are always literals
+#define LZ4_MFLIMIT 12          // The last match starts at least this many bytes before the end
+#define LZ4_MAX_OFFSET 65535
+
+#define LZ4_HASH_BITS 12
+
+static inline Uint32 Read32(const Uint8* p)
+{
+    Uint32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline Uint32 HashSequence(Uint32 sequence)
+{
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+// Writes the extra bytes of a length that doesn't fit into its token nibble
+static inline Uint8* WriteLength(Uint8* out, int length)
+{
+    for (; length >= 255; length -= 255)
+        *out++ = 255;
+
+    *out++ = (Uint8)length;
+    return out;
+}
+
+// Writes a sequence of literals followed by a match (matchLength 0 writes only the literals)
+static Uint8* WriteSequence(Uint8* out, Uint8* outEnd, const Uint8* literals, int literalLength, int offset, int matchLength)
+{
+    // Token, length bytes, literals and the offset
+    if (out + 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1 > outEnd) return nullptr;
+
+    Uint8* token = out++;
+
+    *token = (Uint8)(SDL_min(literalLength, 15) << 4);
+    if (literalLength >= 15) out = WriteLength(out, literalLength - 15);
+
+    memcpy(out, literals, literalLength);
+    out += literalLength;
+
+    if (matchLength == 0) return out;
+
+    *out++ = (Uint8)(offset & 0xFF);
+    *out++ = (Uint8)(offset >> 8);
+
+    matchLength -= LZ4_MIN_MATCH;
+
+    *token |= (Uint8)SDL_min(matchLength, 15);
+    if (matchLength >= 15) out = WriteLength(out, matchLength - 15);
+
+    return out;
+}
+
+int S2DCompression::Bound(int sourceSize)
+{
+    return sourceSize < 0 ? 0 : sourceSize + sourceSize / 255 + 16;
+}
+
+int S2DCompression::Compress(const void* source, int sourceSize, void* dest, int destCapacity)
+{
+    if (!source || !dest || sourceSize < 0) return 0;
+
+    const Uint8* src = (const Uint8*)source;
+    const Uint8* end = src + sourceSize;
+    const Uint8* anchor = src;
+    const Uint8* ip = src;
+
+    Uint8* out = (Uint8*)dest;
+    Uint8* outEnd = out + destCapacity;
+
+    if (sourceSize > LZ4_MFLIMIT)
+    {
+        const Uint8* matchLimit = end - LZ4_LAST_LITERALS;
+        const Uint8* lastMatchStart = end - LZ4_MFLIMIT;
+
+        // Positions of the last sequences with the same hash
+        std::vector<int> table(1 << LZ4_HASH_BITS, -1);
+
+        while (ip <= lastMatchStart)
+        {
+            Uint32 sequence = Read32(ip);
+            Uint32 hash = HashSequence(sequence);
+
+            int candidate = table[hash];
+            table[hash] = (int)(ip - src);
+
+            if (candidate < 0 || ip - (src + candidate) > LZ4_MAX_OFFSET || Read32(src + candidate) != sequence)
+            {
+                // Skip faster through data that doesn't compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            const Uint8* match = src + candidate;
+
+            // Extend the match backwards into the pending literals
+            while (ip > anchor && match > src && ip[-1] == match[-1])
+            {
+                ip--;
+                match--;
+            }
+
+            const Uint8* matchEnd = ip + LZ4_MIN_MATCH;
+            const Uint8* ref = match + LZ4_MIN_MATCH;
+
+            while (matchEnd < matchLimit && *matchEnd == *ref)
+            {
+                matchEnd++;
+                ref++;
+            }
+
+            out = WriteSequence(out, outEnd, anchor, (int)(ip - anchor), (int)(ip - match), (int)(matchEnd - ip));
+            if (!out) return 0;
+
+            ip = anchor = matchEnd;
+        }
+    }
+
+    out = WriteSequence(out, outEnd, anchor, (int)(end - anchor), 0, 0);
+    if (!out) return 0;
+
+    return (int)(out - (Uint8*)dest);
+}
+
+int S2DCompression::Decompress(const void* source, int sourceSize, void* dest, int destCapacity)
+{
+    if (!source || !dest || sourceSize <= 0) return -1;
+
+    const Uint8* ip = (const Uint8*)source;
+    const Uint8* end = ip + sourceSize;
+
+    Uint8* out = (Uint8*)dest;
+    Uint8* outStart = out;
+    Uint8* outEnd = out + destCapacity;
+
+    for (;;)
+    {
+        Uint8 token = *ip++;
+
+        size_t literalLength = token >> 4;
+
+        if (literalLength == 15)
+        {
+            Uint8 extra;
+            do
+            {
+                if (ip >= end) return -1;
+                extra = *ip++;
+                literalLength += extra;
+            } while (extra == 255);
+        }
+
+        if ((size_t)(end - ip) < literalLength || (size_t)(outEnd - out) < literalLength) return -1;
+
+        memcpy(out, ip, literalLength);
+        out += literalLength;
+        ip += literalLength;
+
+        // The last sequence has no match
+        if (ip == end) break;
+
+        if (end - ip < 2) return -1;
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (offset == 0 || offset > (size_t)(out - outStart)) return -1;
+
+        size_t matchLength = token & 15;
+
+        if (matchLength == 15)
+        {
+            Uint8 extra;
+            do
+            {
+                if (ip >= end) return -1;
+                extra = *ip++;
+                matchLength += extra;
+            } while (extra == 255);
+        }
+
+        matchLength += LZ4_MIN_MATCH;
+
+        if ((size_t)(outEnd - out) < matchLength) return -1;
+
+        const Uint8* match = out - offset;
+
+        // Matches can overlap the bytes being written
+        if (offset >= matchLength)
+        {
+            memcpy(out, match, matchLength);
+            out += matchLength;
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; i++)
+                *out++ = *match++;
+        }
+
+        if (ip >= end) return -1;
+    }
+
+    return (int)(out - outStart);
+}
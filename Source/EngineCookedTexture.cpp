@@ -0,0 +1,306 @@
+#include "EngineIncludes.h"
+#include <string.h>
+
+// Format of the cooked pixels, the one the renderers use natively (and SDL_image mostly decodes into)
+#define S2D_COOKED_TEXTURE_FORMAT SDL_PIXELFORMAT_ARGB8888
+
+static_assert(sizeof(S2DCookedTextureHeader) == 44, "S2DCookedTextureHeader must not have padding");
+
+bool S2DCookedTexture::IsCookedPath(const char* path)
+{
+    if (!path) return false;
+
+    size_t length = strlen(path);
+    size_t extLength = strlen(S2D_COOKED_TEXTURE_EXT);
+
+    return length >= extLength && SDL_strcasecmp(path + length - extLength, S2D_COOKED_TEXTURE_EXT) == 0;
+}
+
+SDL_Surface* S2DCookedTexture::DecodeImage(const char* path)
+{
+    SDL_Surface* surface = Assets::LoadImageSurface(path);
+
+    if (surface && surface->format->format != S2D_COOKED_TEXTURE_FORMAT)
+    {
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, S2D_COOKED_TEXTURE_FORMAT, 0);
+
+        SDL_FreeSurface(surface);
+        surface = converted;
+    }
+
+    return surface;
+}
+
+// Finds the smallest rectangle containing all the visible pixels
+static SDL_Rect TrimCookedImage(SDL_Surface* image)
+{
+    int minX = image->w, minY = image->h, maxX = -1, maxY = -1;
+
+    for (int y = 0; y < image->h; y++)
+    {
+        const Uint32* row = (const Uint32*)((const Uint8*)image->pixels + y * image->pitch);
+
+        for (int x = 0; x < image->w; x++)
+        {
+            if ((row[x] & image->format->Amask) == 0) continue;
+
+            minX = SDL_min(minX, x);
+            maxX = SDL_max(maxX, x);
+            minY = SDL_min(minY, y);
+            maxY = SDL_max(maxY, y);
+        }
+    }
+
+    // Fully transparent images keep a single pixel
+    if (maxX < 0) return { 0, 0, 1, 1 };
+
+    return { minX, minY, maxX - minX + 1, maxY - minY + 1 };
+}
+
+// Multiplies the colors of a tightly packed row by their alpha
+static void PremultiplyRow(Uint32* row, int count, const SDL_PixelFormat* format)
+{
+    for (int i = 0; i < count; i++)
+    {
+        Uint32 pixel = row[i];
+        Uint32 a = (pixel & format->Amask) >> format->Ashift;
+
+        if (a == 255) continue;
+
+        Uint32 r = (pixel & format->Rmask) >> format->Rshift;
+        Uint32 g = (pixel & format->Gmask) >> format->Gshift;
+        Uint32 b = (pixel & format->Bmask) >> format->Bshift;
+
+        r = (r * a + 127) / 255;
+        g = (g * a + 127) / 255;
+        b = (b * a + 127) / 255;
+
+        row[i] = (r << format->Rshift) | (g << format->Gshift) | (b << format->Bshift) | (pixel & format->Amask);
+    }
+}
+
+bool S2DCookedTexture::Cook(SDL_Surface* surface, std::vector<Uint8>& output, const S2DCookSettings& settings)
+{
+    if (!surface) return false;
+
+    SDL_Surface* image = SDL_ConvertSurfaceFormat(surface, S2D_COOKED_TEXTURE_FORMAT, 0);
+    if (!image) return false;
+
+    SDL_Rect stored = settings.trim ? TrimCookedImage(image) : SDL_Rect{ 0, 0, image->w, image->h };
+
+    // Stored pixels with tightly packed rows
+    std::vector<Uint8> pixels((size_t)stored.w * stored.h * sizeof(Uint32));
+
+    for (int y = 0; y < stored.h; y++)
+    {
+        const Uint8* source = (const Uint8*)image->pixels + (stored.y + y) * image->pitch + stored.x * sizeof(Uint32);
+        Uint32* row = (Uint32*)&pixels[(size_t)y * stored.w * sizeof(Uint32)];
+
+        memcpy(row, source, stored.w * sizeof(Uint32));
+
+        if (settings.premultiply) PremultiplyRow(row, stored.w, image->format);
+    }
+
+    S2DCookedTextureHeader header = {};
+    header.magic = S2D_COOKED_TEXTURE_MAGIC;
+    header.version = S2D_COOKED_TEXTURE_VERSION;
+    header.flags = settings.premultiply ? S2D_COOKED_PREMULTIPLIED : 0;
+    header.format = S2D_COOKED_TEXTURE_FORMAT;
+    header.width = image->w;
+    header.height = image->h;
+    header.trimX = stored.x;
+    header.trimY = stored.y;
+    header.storedWidth = stored.w;
+    header.storedHeight = stored.h;
+    header.rawSize = (Uint32)pixels.size();
+    header.dataSize = header.rawSize;
+
+    SDL_FreeSurface(image);
+
+    std::vector<Uint8> compressed;
+
+    if (settings.compress)
+    {
+        compressed.resize(S2DCompression::Bound((int)pixels.size()));
+
+        int size = S2DCompression::Compress(pixels.data(), (int)pixels.size(), compressed.data(), (int)compressed.size());
+
+        // Keep the raw pixels when they don't compress
+        if (size > 0 && (Uint32)size < header.rawSize)
+        {
+            compressed.resize(size);
+            header.flags |= S2D_COOKED_LZ4;
+            header.dataSize = (Uint32)size;
+        }
+    }
+
+    const std::vector<Uint8>& data = (header.flags & S2D_COOKED_LZ4) ? compressed : pixels;
+
+    output.resize(sizeof(header) + header.dataSize);
+    memcpy(output.data(), &header, sizeof(header));
+    if (header.dataSize) memcpy(output.data() + sizeof(header), data.data(), header.dataSize);
+
+    return true;
+}
+
+bool S2DCookedTexture::CookFile(const char* input, const char* output, const S2DCookSettings& settings)
+{
+    SDL_Surface* surface = IMG_Load(input);
+    if (!surface) return false;
+
+    std::vector<Uint8> data;
+    bool cooked = Cook(surface, data, settings);
+
+    SDL_FreeSurface(surface);
+
+    if (!cooked) return false;
+
+    SDL_RWops* file = SDL_RWFromFile(output, "wb");
+    if (!file) return false;
+
+    bool written = SDL_RWwrite(file, data.data(), 1, data.size()) == data.size();
+
+    return SDL_RWclose(file) == 0 && written;
+}
+
+SDL_Surface* S2DCookedTexture::Load(const char* path, S2DCookedTextureHeader* header)
+{
+    SDL_RWops* file = S2DFileSystem::Open(path);
+    if (!file) return nullptr;
+
+    SDL_Surface* surface = Load(file, header);
+
+    SDL_RWclose(file);
+
+    return surface;
+}
+
+SDL_Surface* S2DCookedTexture::Load(SDL_RWops* rw, S2DCookedTextureHeader* header)
+{
+    if (!rw) return nullptr;
+
+    S2DCookedTextureHeader info;
+
+    if (SDL_RWread(rw, &info, sizeof(info), 1) != 1)
+        return nullptr;
+
+    if (info.magic != S2D_COOKED_TEXTURE_MAGIC || info.version != S2D_COOKED_TEXTURE_VERSION)
+    {
+        SDL_SetError("Not an cooked texture");
+        return nullptr;
+    }
+
+    if (SDL_BYTESPERPIXEL(info.format) != sizeof(Uint32) || info.storedWidth <= 0 || info.storedHeight <= 0 ||
+        (Uint64)info.storedWidth * info.storedHeight * sizeof(Uint32) != info.rawSize)
+    {
+        SDL_SetError("Corrupted cooked texture");
+        return nullptr;
+    }
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, info.storedWidth, info.storedHeight, 32, info.format);
+    if (!surface) return nullptr;
+
+    // 32-bit rows don't get any padding, so the pixels go straight into the surface
+    bool loaded;
+
+    if (info.flags & S2D_COOKED_LZ4)
+    {
+        std::vector<Uint8> compressed(info.dataSize);
+
+        loaded = info.dataSize > 0 && SDL_RWread(rw, compressed.data(), info.dataSize, 1) == 1 &&
+                 S2DCompression::Decompress(compressed.data(), (int)info.dataSize, surface->pixels, (int)info.rawSize) == (int)info.rawSize;
+    }
+    else
+    {
+        loaded = info.dataSize == info.rawSize && SDL_RWread(rw, surface->pixels, info.rawSize, 1) == 1;
+    }
+
+    if (!loaded)
+    {
+        SDL_SetError("Corrupted cooked texture");
+        SDL_FreeSurface(surface);
+        return nullptr;
+    }
+
+    if (header) *header = info;
+
+    return surface;
+}
+
+// Copies the pixels of an premultiplied 32-bit surface with the colors divided by the alpha
+static void UnpremultiplyPixels(SDL_Surface* surface, std::vector<Uint32>& pixels)
+{
+    pixels.resize((size_t)surface->w * surface->h);
+
+    for (int y = 0; y < surface->h; y++)
+    {
+        const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + y * surface->pitch);
+        Uint32* target = &pixels[(size_t)y * surface->w];
+
+        for (int x = 0; x < surface->w; x++)
+        {
+            Uint8 r, g, b, a;
+            SDL_GetRGBA(row[x], surface->format, &r, &g, &b, &a);
+
+            if (a != 0 && a != 255)
+            {
+                r = (Uint8)SDL_min((r * 255 + a / 2) / a, 255);
+                g = (Uint8)SDL_min((g * 255 + a / 2) / a, 255);
+                b = (Uint8)SDL_min((b * 255 + a / 2) / a, 255);
+            }
+
+            target[x] = SDL_MapRGBA(surface->format, r, g, b, a);
+        }
+    }
+}
+
+SDL_Texture* S2DGraphics::CreateCookedTexture(SDL_Surface* surface, bool premultiplied)
+{
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+
+    WaitRenderThread();
+
+    // The pixels are already in the native format, so SDL doesn't need to convert them
+    SDL_Texture* texture = SDL_CreateTexture(NativeRenderer, surface->format->format, SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+    if (!texture) return NULL;
+
+    const void* pixels = surface->pixels;
+    std::vector<Uint32> straight;
+
+    if (premultiplied && SDL_SetTextureBlendMode(texture, S2DSpriteBatch::GetPremultipliedBlendMode()) != 0)
+    {
+        // Renderers without custom blend modes get the colors divided back by the alpha for the usual blending
+        // (the surface stays premultiplied, it can be uploaded again to a renderer supporting it)
+        UnpremultiplyPixels(surface, straight);
+        pixels = straight.data();
+
+        premultiplied = false;
+    }
+
+    if (!premultiplied) SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    if (SDL_UpdateTexture(texture, NULL, pixels, pixels == surface->pixels ? surface->pitch : surface->w * 4) != 0)
+    {
+        SDL_DestroyTexture(texture);
+        return NULL;
+    }
+
+    return texture;
+}
+
+bool S2DGraphics::UploadCookedTexture(S2DTexture* tex, SDL_Surface* surface, const S2DCookedTextureHeader& header)
+{
+    tex->cooked = true;
+    tex->premultiplied = (header.flags & S2D_COOKED_PREMULTIPLIED) != 0;
+    tex->nativeTexture = CreateCookedTexture(surface, tex->premultiplied);
+
+    if (!tex->nativeTexture) return false;
+
+    tex->width = header.width;
+    tex->height = header.height;
+    tex->region = { 0, 0, header.storedWidth, header.storedHeight };
+    tex->trimX = header.trimX;
+    tex->trimY = header.trimY;
+
+    return true;
+}
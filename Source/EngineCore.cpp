@@ -6,6 +6,9 @@ EngineInitSettings* defaultSettings = new EngineInitSettings{ "S2D Game Engine",
 
 bool IsConsoleApp()
 {
+#ifndef _WIN32
+    return true;
+#else
     PIMAGE_NT_HEADERS header = ImageNtHeader((PVOID)GetModuleHandle(NULL));
     if (header->OptionalHeader.Subsystem == IMAGE_SUBSYSTEM_WINDOWS_CUI)
     {
@@ -13,6 +16,7 @@ bool IsConsoleApp()
     }
 
     return false;
+#endif // _WIN32
 }
 
 std::string ReplaceAll(std::string str, const std::string& from, const std::string& to) {
@@ -25,39 +29,39 @@ std::string ReplaceAll(std::string str, const std::string& from, const std::stri
 }
 
 void PrintModifiers(Uint16 mod) {
-    OutputDebugStringA("Modifers: ");
+    S2DDebugOutput("Modifers: ");
 
     if (mod == KMOD_NONE) {
-        OutputDebugStringA("None\n");
+        S2DDebugOutput("None\n");
         return;
     }
 
-    if (mod & KMOD_NUM) OutputDebugStringA("NUMLOCK ");
-    if (mod & KMOD_CAPS) OutputDebugStringA("CAPSLOCK ");
-    if (mod & KMOD_LCTRL) OutputDebugStringA("LCTRL ");
-    if (mod & KMOD_RCTRL) OutputDebugStringA("RCTRL ");
-    if (mod & KMOD_RSHIFT) OutputDebugStringA("RSHIFT ");
-    if (mod & KMOD_LSHIFT) OutputDebugStringA("LSHIFT ");
-    if (mod & KMOD_RALT) OutputDebugStringA("RALT ");
-    if (mod & KMOD_LALT) OutputDebugStringA("LALT ");
-    if (mod & KMOD_CTRL) OutputDebugStringA("CTRL ");
-    if (mod & KMOD_SHIFT) OutputDebugStringA("SHIFT ");
-    if (mod & KMOD_ALT) OutputDebugStringA("ALT ");
-    OutputDebugStringA("\n");
+    if (mod & KMOD_NUM) S2DDebugOutput("NUMLOCK ");
+    if (mod & KMOD_CAPS) S2DDebugOutput("CAPSLOCK ");
+    if (mod & KMOD_LCTRL) S2DDebugOutput("LCTRL ");
+    if (mod & KMOD_RCTRL) S2DDebugOutput("RCTRL ");
+    if (mod & KMOD_RSHIFT) S2DDebugOutput("RSHIFT ");
+    if (mod & KMOD_LSHIFT) S2DDebugOutput("LSHIFT ");
+    if (mod & KMOD_RALT) S2DDebugOutput("RALT ");
+    if (mod & KMOD_LALT) S2DDebugOutput("LALT ");
+    if (mod & KMOD_CTRL) S2DDebugOutput("CTRL ");
+    if (mod & KMOD_SHIFT) S2DDebugOutput("SHIFT ");
+    if (mod & KMOD_ALT) S2DDebugOutput("ALT ");
+    S2DDebugOutput("\n");
 }
 
 void PrintKeyInfo(SDL_KeyboardEvent* key) {
     /* Is it a release or a press? */
     if (key->type == SDL_KEYUP)
-        OutputDebugStringA("Release:- ");
+        S2DDebugOutput("Release:- ");
     else
-        OutputDebugStringA("Press:- ");
+        S2DDebugOutput("Press:- ");
 
     /* Print the hardware scancode first */
-    OutputDebugStringA(("Scancode: " + std::to_string(key->keysym.scancode)).c_str());
+    S2DDebugOutput(("Scancode: " + std::to_string(key->keysym.scancode)).c_str());
     /* Print the name of the key */
-    OutputDebugStringA((", Name: " + std::string(SDL_GetKeyName(key->keysym.sym))).c_str());
-    OutputDebugStringA("\n");
+    S2DDebugOutput((", Name: " + std::string(SDL_GetKeyName(key->keysym.sym))).c_str());
+    S2DDebugOutput("\n");
     /* Print modifier info */
     PrintModifiers(key->keysym.mod);
 }
@@ -94,6 +98,16 @@ void S2DGame::HandleEvents(SDL_Event& e)
         }
         break;
 
+    case SDL_RENDER_DEVICE_RESET:
+        // The graphics device was lost together with all the textures
+        Graphics->ResetDevice();
+        break;
+
+    case SDL_RENDER_TARGETS_RESET:
+        // The textures survived, only the render targets lost their contents
+        Graphics->ResetRenderTargets();
+        break;
+
     case SDL_MOUSEBUTTONDOWN:
         if(WindowFocused) Input::ProcessMouseButton((MouseButton)(e.button.button - 1), true);
         break;
@@ -109,7 +123,7 @@ void S2DGame::HandleEvents(SDL_Event& e)
     case SDL_KEYDOWN:
         if ((e.key.keysym.mod & KMOD_RALT || e.key.keysym.mod & KMOD_LALT) && e.key.keysym.sym == SDLK_RETURN && WindowFocused)
         {
-            OutputDebugStringA("Toggle Fullscreen\n");
+            S2DDebugOutput("Toggle Fullscreen\n");
 
             bool enabled = Graphics->GetFullscreen();
 
@@ -167,16 +181,36 @@ float S2DGame::GetFrameRate()
     return Framerate;
 }
 
+void S2DGame::SetFixedTimeStep(bool state, float updatesPerSecond)
+{
+    FixedTimeStep = state;
+
+    if (updatesPerSecond > 0.0f)
+        FixedDeltatime = 1.0f / updatesPerSecond;
+
+    FixedAccumulator = 0.0f;
+    InterpolationAlpha = 0.0f;
+}
+
 void S2DGame::Run(GameSplashScreen* splash)
 {
+    bool headless = CurrentSettings->headless;
+
+    if (headless)
+    {
+        // No display or sound card is needed, SDL picks these up on initialization
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    }
+
     SDL_Init(SDL_INIT_EVERYTHING);
     IMG_Init(NULL);
     Mix_Init(NULL);
     TTF_Init();
 
-    if (splash)
+    if (splash && !headless)
     {
-        SDL_Surface* surface = IMG_Load(splash->imagePath);
+        SDL_Surface* surface = Assets::LoadImageSurface(splash->imagePath);
 
         SDL_Window* window = SDL_CreateWindow("SplashScreen", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, surface->w, surface->h, SDL_WINDOW_ALWAYS_ON_TOP | SDL_WINDOW_BORDERLESS | SDL_WINDOW_SKIP_TASKBAR);
 
@@ -196,9 +230,14 @@ void S2DGame::Run(GameSplashScreen* splash)
     if (Mix_OpenAudio(22050, MIX_DEFAULT_FORMAT, 8, 4096) < 0)
         S2DFatalErrorFormatted("Cannot initalizate sound system!\n\t%s", Mix_GetError());
 
+    Jobs = new S2DJobSystem(CurrentSettings->jobWorkers);
+
     Graphics = new S2DGraphics(CurrentSettings);
+    Graphics->SetJobSystem(Jobs);
+
+    FrameGraph = new S2DFrameGraph();
     //Physics = new S2DPhysics();
-    SDL_RaiseWindow(Graphics->GetWindow());
+    if (!headless) SDL_RaiseWindow(Graphics->GetWindow());
     WindowFocused = true;
 
     OnInit();
@@ -207,18 +246,41 @@ void S2DGame::Run(GameSplashScreen* splash)
 
     Uint64 g_Time = 0;
 
-    float timeStep = 1.0f / 60.0f;
+    Deltatime = 1.0f / 60.0f;
+
+    S2DProfiler::SetThreadName("Main Thread");
+
+    // Timing results of the headless run
+    int headlessFrames = 0;
+    double headlessTotal = 0.0, headlessMin = 0.0, headlessMax = 0.0;
 
     for (;;)
     {
+        S2DProfileFrame();
+        S2DProfileZone("Frame");
+
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+
         SDL_Event event;
 
-        while (SDL_PollEvent(&event))
         {
-            HandleEvents(event);
+            S2DProfileZone("Events");
+
+            while (SDL_PollEvent(&event))
+            {
+                HandleEvents(event);
+            }
         }
 
-        if (WindowFocused && Graphics->IsRunning())
+        {
+            S2DProfileZone("Main Thread Callbacks");
+            Jobs->RunMainThreadCallbacks();
+        }
+
+        // The events are handled, the render thread can draw the last frame while this one is simulated
+        Graphics->SubmitFrame();
+
+        if ((WindowFocused || headless) && Graphics->IsRunning())
         {
             Vec2Int delta;
 
@@ -233,12 +295,50 @@ void S2DGame::Run(GameSplashScreen* splash)
             else
                 Input::UpdateMousePos();
 
-            //Physics->Update(timeStep);
+            Uint64 updateStart = SDL_GetPerformanceCounter();
 
-            OnUpdate();
+            if (FixedTimeStep)
+            {
+                FixedAccumulator += Deltatime;
+
+                int steps = 0;
+
+                while (FixedAccumulator >= FixedDeltatime && steps < MaxFixedSteps)
+                {
+                    //Physics->Update(FixedDeltatime);
+
+                    {
+                        S2DProfileZone("OnFixedUpdate");
+                        OnFixedUpdate();
+                    }
+
+                    FixedAccumulator -= FixedDeltatime;
+                    steps++;
+                }
+
+                // Too far behind, drop the time we can't simulate instead of spiraling down
+                if (FixedAccumulator >= FixedDeltatime)
+                    FixedAccumulator = fmodf(FixedAccumulator, FixedDeltatime);
+
+                InterpolationAlpha = FixedAccumulator / FixedDeltatime;
+            }
+
+            {
+                S2DProfileZone("OnUpdate");
+                OnUpdate();
+            }
+
+            FrameGraph->Run(Jobs, Deltatime);
+
+            Uint64 renderStart = SDL_GetPerformanceCounter();
 
             Graphics->BeginFrame();
-            OnRender();
+
+            {
+                S2DProfileZone("OnRender");
+                OnRender();
+            }
+
             Graphics->EndFrame();
 
             // Setup time step (we don't use SDL_GetTicks() because it is using millisecond resolution)
@@ -247,14 +347,58 @@ void S2DGame::Run(GameSplashScreen* splash)
             Deltatime = g_Time > 0 ? (float)((double)(current_time - g_Time) / frequency) : (float)(1.0f / 60.0f);
             Framerate = 1.0f / Deltatime;
             Frametime = Deltatime * 1000.0f;
+
+            // The first frame has no previous one to measure against
+            if (g_Time > 0)
+            {
+                double toMilliseconds = 1000.0 / frequency;
+                FrameHistory.Add(Frametime, (float)((renderStart - updateStart) * toMilliseconds), (float)((current_time - renderStart) * toMilliseconds));
+            }
+
             g_Time = current_time;
 
-            if (Input::mouseLocked)
+            if (Input::mouseLocked && !headless)
             {
                 SDL_WarpMouseGlobal(size.x / 2, size.y / 2);
             }
 
-            //OutputDebugStringA(("Framerate: " + std::to_string(Framerate) + "(" + std::to_string(Frametime) + " ms)\n").c_str());
+            if (headless)
+            {
+                double frameTime = (double)(current_time - frameStart) / frequency;
+
+                headlessTotal += frameTime;
+                if (headlessFrames == 0 || frameTime < headlessMin) headlessMin = frameTime;
+                if (headlessFrames == 0 || frameTime > headlessMax) headlessMax = frameTime;
+                headlessFrames++;
+
+                if (CurrentSettings->headlessFrames > 0 && headlessFrames >= CurrentSettings->headlessFrames)
+                {
+                    double average = headlessTotal / headlessFrames;
+
+                    printf("S2D headless run: %d frames in %.3f s\n", headlessFrames, headlessTotal);
+                    printf("\tavg: %.3f ms (%.1f FPS), min: %.3f ms, max: %.3f ms\n", average * 1000.0, 1.0 / average, headlessMin * 1000.0, headlessMax * 1000.0);
+
+                    S2DFrameStats stats = GetFrameStats();
+
+                    printf("\tlast %d frames: p50: %.3f ms, p95: %.3f ms, p99: %.3f ms, 1%% low: %.1f FPS\n", stats.frames, stats.frame.p50, stats.frame.p95, stats.frame.p99, stats.onePercentLowFps);
+                    printf("\tupdate: avg %.3f ms, p99 %.3f ms, render: avg %.3f ms, p99 %.3f ms\n", stats.update.mean, stats.update.p99, stats.render.mean, stats.render.p99);
+
+                    if (FrameGraph->GetSystemCount() > 0)
+                    {
+                        S2DFrameGraphStats graph = FrameGraph->GetStats();
+
+                        printf("\tsystems: avg %.3f ms, critical path %.3f ms, work %.3f ms\n", graph.averageWall, graph.averageCriticalPath, graph.averageWork);
+
+                        for (auto& system : graph.systems)
+                            printf("\t\t%-24s avg %.3f ms, max %.3f ms%s\n", system.name.c_str(), system.average, system.max, system.critical ? " (critical)" : "");
+                    }
+
+                    fflush(stdout);
+
+                    Quit();
+                }
+            }
+
         }
         else
         {
@@ -269,23 +413,46 @@ void S2DGame::Quit()
     SDL_SetRelativeMouseMode(SDL_FALSE);
     S2DInput::ShowCursor(true);
     S2DInput::LockCursor(false);
+
+    // The render thread may still be presenting the last submitted frame
+    Graphics->SetRenderThread(false);
+
+    // The decodes in flight use SDL, the workers are stopped before it shuts down
+    Graphics->ShutdownTextureLoader();
+    Graphics->SetJobSystem(nullptr);
+
+    delete Jobs;
+    Jobs = nullptr;
+
     SDL_Quit();
     IMG_Quit();
     Mix_Quit();
     TTF_Quit();
+#ifdef _WIN32
     ExitProcess(0);
+#else
+    exit(0);
+#endif // _WIN32
 }
 
 S2DGame::S2DGame(EngineInitSettings* settings)
 {
     CurrentSettings = settings;
+
+#ifdef _WIN32
+    // Headless instances are allowed to run side by side (e.g. parallel test runs)
+    if (settings->headless) return;
+
     std::string mutexName = ReplaceAll(std::string(settings->title), " ", "").c_str();
 	MutexHandle = CreateMutexA(NULL, TRUE, ("S2DGame_" + mutexName).c_str());
     if (GetLastError() == ERROR_ALREADY_EXISTS)
         S2DFatalError("An another application instance is already running!");
+#endif // _WIN32
 }
 
 S2DGame::~S2DGame()
 {
-    ReleaseMutex(MutexHandle);
+#ifdef _WIN32
+    if (MutexHandle) ReleaseMutex(MutexHandle);
+#endif // _WIN32
 }
\ No newline at end of file
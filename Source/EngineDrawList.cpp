@@ -0,0 +1,524 @@
+#include "EngineIncludes.h"
+#include <cstring>
+
+// Sorts of fewer entries than this run on the calling thread
+#define S2D_SORT_JOB_SIZE 16384
+
+// Number of the key bits sorted in a single pass
+#define S2D_SORT_RADIX_BITS 8
+#define S2D_SORT_RADIX_SIZE (1 << S2D_SORT_RADIX_BITS)
+
+static Uint64 GetBlendSortIndex(SDL_BlendMode blendMode)
+{
+    switch (blendMode)
+    {
+    case SDL_BLENDMODE_NONE: return 0;
+    case SDL_BLENDMODE_BLEND: return 1;
+    case SDL_BLENDMODE_ADD: return 2;
+    case SDL_BLENDMODE_MOD: return 3;
+    case SDL_BLENDMODE_MUL: return 4;
+    default: break;
+    }
+
+    return blendMode == S2DSpriteBatch::GetPremultipliedBlendMode() ? 5 : 6;
+}
+
+Uint64 S2DMakeSortKey(int layer, float depth, SDL_BlendMode blendMode, int textureSortID)
+{
+    Uint64 layerBits = (Uint64)(SDL_max(-128, SDL_min(127, layer)) + 128);
+
+    // Flipping the sign bit (and the rest of negative numbers) orders the float bits like the floats
+    Uint32 depthBits;
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+    depthBits = (depthBits & 0x80000000) ? ~depthBits : (depthBits | 0x80000000);
+
+    // Layer (8 bits), depth (32 bits), blend mode (4 bits), texture (20 bits)
+    return (layerBits << 56) | ((Uint64)depthBits << 24) | (GetBlendSortIndex(blendMode) << S2D_TEXTURE_INDEX_BITS) |
+           (Uint64)(textureSortID & S2D_TEXTURE_INDEX_MASK);
+}
+
+void S2DRadixSort(std::vector<S2DSortEntry>& entries, std::vector<S2DSortEntry>& scratch, S2DJobSystem* jobs)
+{
+    int count = (int)entries.size();
+    if (count < 2) return;
+
+    S2DProfileZone("Radix Sort");
+
+    scratch.resize(count);
+
+    int chunks = 1;
+
+    if (jobs && count >= S2D_SORT_JOB_SIZE * 2)
+        chunks = SDL_min(jobs->GetWorkerCount() + 1, count / S2D_SORT_JOB_SIZE);
+
+    int chunkSize = (count + chunks - 1) / chunks;
+
+    auto forEachChunk = [&](const std::function<void(int chunk, int begin, int end)>& function)
+    {
+        auto run = [&](int begin, int end)
+        {
+            for (int chunk = begin; chunk < end; chunk++)
+                function(chunk, chunk * chunkSize, SDL_min(count, (chunk + 1) * chunkSize));
+        };
+
+        if (chunks > 1)
+            jobs->Wait(jobs->ParallelFor(chunks, 1, run));
+        else
+            run(0, 1);
+    };
+
+    // Bits that differ between the keys, the passes over the other bits would keep the order
+    std::vector<Uint64> chunkBits(chunks, 0);
+
+    forEachChunk([&](int chunk, int begin, int end)
+    {
+        Uint64 first = entries[0].key;
+        Uint64 bits = 0;
+
+        for (int i = begin; i < end; i++)
+            bits |= entries[i].key ^ first;
+
+        chunkBits[chunk] = bits;
+    });
+
+    Uint64 differentBits = 0;
+
+    for (Uint64 bits : chunkBits)
+        differentBits |= bits;
+
+    // Counts of the digits in every chunk, then the position of the first entry of every digit and chunk
+    std::vector<int> offsets((size_t)chunks * S2D_SORT_RADIX_SIZE);
+
+    for (int shift = 0; shift < 64; shift += S2D_SORT_RADIX_BITS)
+    {
+        if (((differentBits >> shift) & (S2D_SORT_RADIX_SIZE - 1)) == 0) continue;
+
+        forEachChunk([&](int chunk, int begin, int end)
+        {
+            int* counts = &offsets[(size_t)chunk * S2D_SORT_RADIX_SIZE];
+            memset(counts, 0, S2D_SORT_RADIX_SIZE * sizeof(int));
+
+            for (int i = begin; i < end; i++)
+                counts[(entries[i].key >> shift) & (S2D_SORT_RADIX_SIZE - 1)]++;
+        });
+
+        // The earlier chunks go first within every digit, so equal keys keep their order
+        int position = 0;
+
+        for (int digit = 0; digit < S2D_SORT_RADIX_SIZE; digit++)
+        {
+            for (int chunk = 0; chunk < chunks; chunk++)
+            {
+                int& offset = offsets[(size_t)chunk * S2D_SORT_RADIX_SIZE + digit];
+                int digitCount = offset;
+
+                offset = position;
+                position += digitCount;
+            }
+        }
+
+        forEachChunk([&](int chunk, int begin, int end)
+        {
+            int* positions = &offsets[(size_t)chunk * S2D_SORT_RADIX_SIZE];
+
+            for (int i = begin; i < end; i++)
+                scratch[positions[(entries[i].key >> shift) & (S2D_SORT_RADIX_SIZE - 1)]++] = entries[i];
+        });
+
+        entries.swap(scratch);
+    }
+}
+
+static inline bool IsEntryBefore(const S2DSortEntry& a, const S2DSortEntry& b)
+{
+    if (a.key != b.key) return a.key < b.key;
+    if (a.list != b.list) return a.list < b.list;
+
+    return a.item < b.item;
+}
+
+bool S2DSortAlmostSorted(std::vector<S2DSortEntry>& entries, int maxMoves)
+{
+    S2DProfileZone("Insertion Sort");
+
+    int moves = 0;
+
+    for (int i = 1; i < (int)entries.size(); i++)
+    {
+        if (!IsEntryBefore(entries[i], entries[i - 1])) continue;
+
+        S2DSortEntry entry = entries[i];
+        int j = i;
+
+        for (; j > 0 && IsEntryBefore(entry, entries[j - 1]); j--)
+            entries[j] = entries[j - 1];
+
+        entries[j] = entry;
+
+        moves += i - j;
+        if (moves > maxMoves) return false;
+    }
+
+    return true;
+}
+
+void S2DDrawList::Clear()
+{
+    Items.clear();
+    Vertices.clear();
+    Indices.clear();
+}
+
+void S2DDrawList::Draw(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, float angle, const SDL_FPoint* center, TexFlipMode flip, Color color)
+{
+    // Both only read the texture, so the recording threads can call them
+    SDL_BlendMode blendMode;
+    SDL_GetTextureBlendMode(texture, &blendMode);
+
+    int width = 0, height = 0;
+    if (SDL_QueryTexture(texture, NULL, NULL, &width, &height) != 0 || width <= 0 || height <= 0) return;
+
+    Item item;
+    item.key = S2DMakeSortKey(Layer, Depth, blendMode, SortID);
+    item.texture = texture;
+    item.blendMode = blendMode;
+    item.primitive = S2DBatchPrimitive::Quads;
+    item.vertex = (int)Vertices.size();
+    item.vertexCount = 4;
+    item.index = item.indexCount = 0;
+
+    Vertices.resize(Vertices.size() + 4);
+    S2DSpriteBatch::BuildQuad(&Vertices[item.vertex], width, height, blendMode, src, dst, angle, center, flip, color);
+
+    Items.push_back(item);
+}
+
+void S2DDrawList::RenderTexture(int textureID, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color, int layer, float depth)
+{
+    const S2DTextureInfo* info = Owner->Textures.GetInfo(textureID);
+    if (!info || !info->texture) return;
+
+    if (!Owner->IsOnScreen(Camera, pos, size, angle)) return;
+
+    SDL_FRect rect = Owner->GetScreenRect(Camera, pos, center, size, angle);
+
+    Layer = layer;
+    Depth = depth;
+    SortID = info->sortID;
+
+    Owner->DrawTextureRegion(*info, NULL, rect, angle, flip, color, this);
+}
+
+void S2DDrawList::RenderSprite(S2DSprite* sprite, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color, int layer, float depth)
+{
+    S2DTexture* tex = sprite->GetTexture();
+    if (!tex || !tex->GetSDLTexture()) return;
+
+    if (!Owner->IsOnScreen(Camera, pos, size, angle)) return;
+
+    SDL_FRect rect = Owner->GetScreenRect(Camera, pos, center, size, angle);
+
+    // Registered textures have their draw data at hand
+    const S2DTextureInfo* registered = Owner->Textures.IsValid(tex->textureID) ? Owner->Textures.GetInfo(tex->textureID) : nullptr;
+    S2DTextureInfo info = registered ? *registered : tex->GetInfo();
+
+    Layer = layer;
+    Depth = depth;
+    SortID = info.sortID;
+
+    Owner->DrawTextureRegion(info, &sprite->GetCurFrameRect(), rect, angle, flip, color, this);
+}
+
+S2DVertex* S2DDrawList::AddPrimitive(S2DBatchPrimitive primitive, int vertexCount, Color color, int layer, float depth)
+{
+    Item item;
+    item.key = S2DMakeSortKey(layer, depth, S2DSpriteBatch::PrimitiveBlendMode, 0);
+    item.texture = NULL;
+    item.blendMode = S2DSpriteBatch::PrimitiveBlendMode;
+    item.primitive = primitive;
+    item.vertex = (int)Vertices.size();
+    item.vertexCount = vertexCount;
+    item.index = (int)Indices.size();
+    item.indexCount = 0;
+
+    Items.push_back(item);
+
+    S2DVertex v;
+    v.position = { 0.0f, 0.0f };
+    v.color = { color.r, color.g, color.b, color.a };
+    v.texCoord = { 0.0f, 0.0f };
+
+    Vertices.resize(Vertices.size() + vertexCount, v);
+
+    return &Vertices[item.vertex];
+}
+
+void S2DDrawList::RenderFilledBox(Vec2 pos, Vec2 center, Vec2 size, Color color, int layer, float depth)
+{
+    if (!Owner->IsOnScreen(Camera, pos, size, 0.0f)) return;
+
+    float angle = 0.0f;
+    SDL_FRect rect = Owner->GetScreenRect(Camera, pos, center, size, angle);
+
+    if (angle == 0.0f)
+    {
+        S2DVertex* v = AddPrimitive(S2DBatchPrimitive::Quads, 4, color, layer, depth);
+
+        v[0].position = { rect.x, rect.y };
+        v[1].position = { rect.x + rect.w, rect.y };
+        v[2].position = { rect.x + rect.w, rect.y + rect.h };
+        v[3].position = { rect.x, rect.y + rect.h };
+        return;
+    }
+
+    // A turned camera fills the box as two triangles
+    S2DVertex* v = AddPrimitive(S2DBatchPrimitive::Triangles, 4, color, layer, depth);
+
+    S2DVertex corners[4];
+    S2DSpriteBatch::BuildQuad(corners, 1, 1, SDL_BLENDMODE_BLEND, NULL, rect, angle, NULL, TexFlipMode::None, color);
+
+    for (int i = 0; i < 4; i++)
+        v[i].position = corners[i].position;
+
+    const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+    Indices.insert(Indices.end(), quad, quad + 6);
+    Items.back().indexCount = 6;
+}
+
+void S2DDrawList::RenderLine(Vec2 p1, Vec2 p2, Color color, int layer, float depth)
+{
+    S2DVertex* v = AddPrimitive(S2DBatchPrimitive::Lines, 2, color, layer, depth);
+
+    v[0].position = Camera->Matrix.Transform({ p1.x, p1.y });
+    v[1].position = Camera->Matrix.Transform({ p2.x, p2.y });
+}
+
+S2DDrawList* S2DGraphics::AddDrawList(S2DCamera* cam, bool queue)
+{
+    if ((int)DrawLists.size() == UsedDrawLists)
+        DrawLists.push_back(new S2DDrawList());
+
+    S2DDrawList* list = DrawLists[UsedDrawLists++];
+    list->Owner = this;
+    list->Camera = cam;
+    list->Queue = queue;
+    list->Clear();
+
+    return list;
+}
+
+S2DDrawList* S2DGraphics::GetQueueList(S2DCamera* cam)
+{
+    if (cam) UpdateCamera(cam);
+
+    // The lists recorded in parallel after it are sorted together with it
+    for (int i = UsedDrawLists - 1; i >= 0; i--)
+    {
+        if (DrawLists[i]->Queue && DrawLists[i]->Camera == cam) return DrawLists[i];
+    }
+
+    return AddDrawList(cam, true);
+}
+
+void S2DGraphics::QueueTexture(S2DCamera* cam, int textureID, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color, int layer, float depth)
+{
+    GetQueueList(cam)->RenderTexture(textureID, pos, center, size, angle, flip, color, layer, depth);
+}
+
+void S2DGraphics::QueueSprite(S2DCamera* cam, S2DSprite* sprite, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color, int layer, float depth)
+{
+    GetQueueList(cam)->RenderSprite(sprite, pos, center, size, angle, flip, color, layer, depth);
+}
+
+void S2DGraphics::QueueFilledBox(S2DCamera* cam, Vec2 pos, Vec2 center, Vec2 size, Color color, int layer, float depth)
+{
+    GetQueueList(cam)->RenderFilledBox(pos, center, size, color, layer, depth);
+}
+
+void S2DGraphics::QueueLine(S2DCamera* cam, Vec2 p1, Vec2 p2, Color color, int layer, float depth)
+{
+    GetQueueList(cam)->RenderLine(p1, p2, color, layer, depth);
+}
+
+void S2DGraphics::QueueText(S2DFont* font, int size, const char* text, Vec2 pos, Vec2 center, float angle, TexFlipMode flip, Color color, int layer, float depth)
+{
+    if (!font) return;
+
+    S2DDrawList* list = GetQueueList(nullptr);
+
+    // The glyphs are recorded with the order of the text
+    list->Layer = layer;
+    list->Depth = depth;
+    list->SortID = 0;
+
+    font->Render(size, text, pos, center, angle, flip, color, list);
+}
+
+void S2DGraphics::RecordDrawLists(S2DCamera* cam, int count, int chunkSize, S2DDrawListFunction function)
+{
+    if (count <= 0 || !function) return;
+
+    S2DProfileZone("Record Draw Lists");
+
+    if (chunkSize <= 0) chunkSize = count;
+
+    // The lists only read the camera, its transform has to be ready before they start
+    UpdateCamera(cam);
+
+    int first = UsedDrawLists;
+    int lists = (count - 1) / chunkSize + 1;
+
+    for (int i = 0; i < lists; i++)
+        AddDrawList(cam, false);
+
+    auto record = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+            function(*DrawLists[first + i], i * chunkSize, SDL_min(count, (i + 1) * chunkSize));
+    };
+
+    S2DJobSystem* jobs = GetJobSystem();
+    jobs->Wait(jobs->ParallelFor(lists, 1, record));
+}
+
+void S2DGraphics::SubmitDrawLists()
+{
+    if (UsedDrawLists == 0) return;
+
+    S2DProfileZone("Submit Draw Lists");
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    // Entries in the recorded order, the sorts keep it for equal keys
+    DrawListOffsets.resize(UsedDrawLists);
+
+    int total = 0;
+
+    for (int i = 0; i < UsedDrawLists; i++)
+    {
+        DrawListOffsets[i] = total;
+        total += DrawLists[i]->GetCount();
+    }
+
+    DrawOrder.resize(total);
+
+    for (int i = 0; i < UsedDrawLists; i++)
+    {
+        S2DDrawList* list = DrawLists[i];
+
+        for (int item = 0; item < (int)list->Items.size(); item++)
+            DrawOrder[DrawListOffsets[i] + item] = { list->Items[item].key, i, item };
+    }
+
+    // The same objects usually come in the same order every frame and only move a little (like in y-sorted scenes),
+    // so the order of the last frame needs just a few fixes
+    bool reused = false;
+
+    if (total > 1 && (int)LastDrawOrder.size() == total)
+    {
+        DrawOrderScratch.resize(total);
+
+        for (int i = 0; i < total; i++)
+            DrawOrderScratch[i] = DrawOrder[LastDrawOrder[i]];
+
+        // Beyond about half a move per entry the radix sort is faster
+        if (S2DSortAlmostSorted(DrawOrderScratch, total / 2))
+        {
+            DrawOrder.swap(DrawOrderScratch);
+            reused = true;
+        }
+    }
+
+    if (!reused)
+        S2DRadixSort(DrawOrder, DrawOrderScratch, total >= S2D_SORT_JOB_SIZE * 2 ? GetJobSystem() : nullptr);
+
+    LastDrawOrder.resize(total);
+
+    for (int i = 0; i < total; i++)
+        LastDrawOrder[i] = DrawListOffsets[DrawOrder[i].list] + DrawOrder[i].item;
+
+    QueueStats = S2DRenderQueueStats();
+    QueueStats.objects = total;
+    QueueStats.lists = UsedDrawLists;
+    QueueStats.reusedOrder = reused;
+    QueueStats.sortMs = (float)((double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+
+    for (int first = 0; first < total;)
+    {
+        S2DDrawList* list = DrawLists[DrawOrder[first].list];
+        const S2DDrawList::Item& item = list->Items[DrawOrder[first].item];
+
+        // The screen coordinates of the lists without a camera aren't clipped
+        if (list->Camera)
+        {
+            SetDrawCamera(list->Camera);
+        }
+        else if (Clipping)
+        {
+            SpriteBatch.Flush();
+            SetRendererClip(NULL);
+            Clipping = false;
+        }
+
+        // Items of the same texture and camera following each other go into the batch together
+        int last = first + 1;
+
+        for (; last < total; last++)
+        {
+            S2DDrawList* next = DrawLists[DrawOrder[last].list];
+            const S2DDrawList::Item& nextItem = next->Items[DrawOrder[last].item];
+
+            if (next->Camera != list->Camera || nextItem.texture != item.texture || nextItem.blendMode != item.blendMode || nextItem.primitive != item.primitive) break;
+        }
+
+        QueueStats.batches++;
+
+        if (item.primitive == S2DBatchPrimitive::Quads)
+        {
+            S2DVertex* vertices = SpriteBatch.ReserveQuads(item.texture, item.blendMode, last - first);
+
+            if (vertices)
+            {
+                for (int i = first; i < last; i++, vertices += 4)
+                {
+                    S2DDrawList* owner = DrawLists[DrawOrder[i].list];
+                    memcpy(vertices, &owner->Vertices[owner->Items[DrawOrder[i].item].vertex], 4 * sizeof(S2DVertex));
+                }
+
+                SpriteBatch.CommitQuads(last - first);
+            }
+
+            first = last;
+            continue;
+        }
+
+        for (int i = first; i < last; i++)
+        {
+            S2DDrawList* owner = DrawLists[DrawOrder[i].list];
+            const S2DDrawList::Item& primitive = owner->Items[DrawOrder[i].item];
+            const S2DVertex* v = &owner->Vertices[primitive.vertex];
+
+            Color color(v[0].color.r, v[0].color.g, v[0].color.b, v[0].color.a);
+
+            if (primitive.primitive == S2DBatchPrimitive::Lines)
+            {
+                SpriteBatch.DrawLine(v[0].position, v[1].position, color);
+                continue;
+            }
+
+            ShapePoints.resize(primitive.vertexCount);
+
+            for (int j = 0; j < primitive.vertexCount; j++)
+                ShapePoints[j] = v[j].position;
+
+            SpriteBatch.FillTriangles(ShapePoints.data(), primitive.vertexCount, &owner->Indices[primitive.index], primitive.indexCount, color);
+        }
+
+        first = last;
+    }
+
+    for (int i = 0; i < UsedDrawLists; i++)
+        DrawLists[i]->Clear();
+
+    UsedDrawLists = 0;
+}
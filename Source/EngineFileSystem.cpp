@@ -0,0 +1,420 @@
+#include "EngineIncludes.h"
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <filesystem>
+#include <string.h>
+
+// Lock-free counters updated by the streams (they can be read on any thread)
+struct S2DFileCounters
+{
+    std::atomic<Uint64> opens{ 0 };
+    std::atomic<Uint64> bytesRead{ 0 };
+    std::atomic<Uint64> openTicks{ 0 };
+    std::atomic<Uint64> readTicks{ 0 };
+
+    void Reset()
+    {
+        opens = 0;
+        bytesRead = 0;
+        openTicks = 0;
+        readTicks = 0;
+    }
+
+    S2DFileStats GetStats()
+    {
+        double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+
+        S2DFileStats stats;
+        stats.opens = opens;
+        stats.bytesRead = bytesRead;
+        stats.openMs = (float)(openTicks * toMs);
+        stats.readMs = (float)(readTicks * toMs);
+        return stats;
+    }
+};
+
+struct S2DMount
+{
+    int id = 0;
+    MountType type = MountType::Directory;
+    std::string source;
+    std::string mountPoint;
+
+    // Virtual paths of the files and where they are inside the mount
+    std::vector<std::pair<std::string, std::string>> files;
+
+    S2DPack* pack = nullptr;
+
+    const void* data = nullptr;
+    size_t size = 0;
+
+    // Shared with the opened streams, so they can be closed after the mount is gone
+    std::shared_ptr<S2DFileCounters> counters = std::make_shared<S2DFileCounters>();
+
+    ~S2DMount() { delete pack; }
+};
+
+// The index hashes the normalized paths like the packs do
+struct S2DPathHash
+{
+    size_t operator()(const std::string& path) const { return (size_t)S2DPack::HashPath(path); }
+};
+
+namespace FileSystem
+{
+    struct IndexEntry
+    {
+        std::shared_ptr<S2DMount> mount;
+        std::string source;
+    };
+
+    std::mutex lock;
+
+    std::vector<std::shared_ptr<S2DMount>> mounts;
+
+    // Virtual path -> the last mount providing it
+    std::unordered_map<std::string, IndexEntry, S2DPathHash> index;
+
+    std::shared_ptr<S2DFileCounters> disk = std::make_shared<S2DFileCounters>();
+
+    int nextID = 1;
+
+    // Joins the mount point and a path inside the mount
+    std::string GetVirtualPath(const std::string& mountPoint, const std::string& path)
+    {
+        return S2DPack::NormalizePath(mountPoint.empty() ? path.c_str() : (mountPoint + "/" + path).c_str());
+    }
+
+    void IndexMount(const std::shared_ptr<S2DMount>& mount)
+    {
+        for (auto& file : mount->files)
+        {
+            index[file.first] = { mount, file.second };
+        }
+    }
+
+    void RebuildIndex()
+    {
+        index.clear();
+
+        for (auto& mount : mounts)
+            IndexMount(mount);
+    }
+
+    void ScanDirectory(S2DMount* mount)
+    {
+        S2DProfileZone("Scan Directory");
+
+        mount->files.clear();
+
+        std::error_code error;
+        std::filesystem::path root(mount->source);
+
+        for (std::filesystem::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error))
+        {
+            if (!it->is_regular_file(error)) continue;
+
+            std::string relative = it->path().lexically_relative(root).generic_string();
+
+            mount->files.emplace_back(GetVirtualPath(mount->mountPoint, relative), it->path().string());
+        }
+    }
+
+    int AddMount(const std::shared_ptr<S2DMount>& mount)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        mount->id = nextID++;
+
+        mounts.push_back(mount);
+        IndexMount(mount);
+
+        return mount->id;
+    }
+}
+
+struct S2DCountedStream
+{
+    SDL_RWops* source;
+    std::shared_ptr<S2DFileCounters> counters;
+};
+
+static S2DCountedStream* GetCountedStream(SDL_RWops* rw)
+{
+    return (S2DCountedStream*)rw->hidden.unknown.data1;
+}
+
+static Sint64 SDLCALL CountedSize(SDL_RWops* rw)
+{
+    return SDL_RWsize(GetCountedStream(rw)->source);
+}
+
+static Sint64 SDLCALL CountedSeek(SDL_RWops* rw, Sint64 offset, int whence)
+{
+    return SDL_RWseek(GetCountedStream(rw)->source, offset, whence);
+}
+
+static size_t SDLCALL CountedRead(SDL_RWops* rw, void* ptr, size_t size, size_t maxnum)
+{
+    S2DCountedStream* stream = GetCountedStream(rw);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    size_t read = SDL_RWread(stream->source, ptr, size, maxnum);
+
+    stream->counters->readTicks += SDL_GetPerformanceCounter() - start;
+    stream->counters->bytesRead += read * size;
+
+    return read;
+}
+
+static size_t SDLCALL CountedWrite(SDL_RWops* /*rw*/, const void* /*ptr*/, size_t /*size*/, size_t /*num*/)
+{
+    SDL_SetError("Files opened through the filesystem are read-only");
+    return 0;
+}
+
+static int SDLCALL CountedClose(SDL_RWops* rw)
+{
+    S2DCountedStream* stream = GetCountedStream(rw);
+
+    int result = SDL_RWclose(stream->source);
+
+    delete stream;
+    SDL_FreeRW(rw);
+
+    return result;
+}
+
+// Wraps a stream to count the bytes read from it
+static SDL_RWops* CountStream(SDL_RWops* source, const std::shared_ptr<S2DFileCounters>& counters)
+{
+    SDL_RWops* rw = SDL_AllocRW();
+
+    if (!rw)
+    {
+        SDL_RWclose(source);
+        return nullptr;
+    }
+
+    rw->type = SDL_RWOPS_UNKNOWN;
+    rw->size = CountedSize;
+    rw->seek = CountedSeek;
+    rw->read = CountedRead;
+    rw->write = CountedWrite;
+    rw->close = CountedClose;
+    rw->hidden.unknown.data1 = new S2DCountedStream{ source, counters };
+
+    return rw;
+}
+
+int S2DFileSystem::MountDirectory(const char* directory, const char* mountPoint)
+{
+    if (!directory) return -1;
+
+    std::error_code error;
+
+    if (!std::filesystem::is_directory(std::filesystem::path(directory), error))
+    {
+        SDL_SetError("%s is not a directory", directory);
+        return -1;
+    }
+
+    auto mount = std::make_shared<S2DMount>();
+    mount->type = MountType::Directory;
+    mount->source = directory;
+    mount->mountPoint = mountPoint ? mountPoint : "";
+
+    FileSystem::ScanDirectory(mount.get());
+
+    return FileSystem::AddMount(mount);
+}
+
+int S2DFileSystem::MountPack(const char* path, const char* mountPoint)
+{
+    S2DPack* pack = S2DPack::Open(path);
+    if (!pack) return -1;
+
+    auto mount = std::make_shared<S2DMount>();
+    mount->type = MountType::Pack;
+    mount->source = path;
+    mount->mountPoint = mountPoint ? mountPoint : "";
+    mount->pack = pack;
+
+    for (int i = 0; i < pack->GetEntryCount(); i++)
+    {
+        std::string entry = pack->GetEntryPath(i);
+        mount->files.emplace_back(FileSystem::GetVirtualPath(mount->mountPoint, entry), entry);
+    }
+
+    return FileSystem::AddMount(mount);
+}
+
+int S2DFileSystem::MountMemory(const char* path, const void* data, size_t size)
+{
+    if (!path || !data || size == 0 || size > SDL_MAX_SINT32) return -1;
+
+    auto mount = std::make_shared<S2DMount>();
+    mount->type = MountType::Memory;
+    mount->source = path;
+    mount->data = data;
+    mount->size = size;
+    mount->files.emplace_back(S2DPack::NormalizePath(path), path);
+
+    return FileSystem::AddMount(mount);
+}
+
+bool S2DFileSystem::Unmount(int mountID)
+{
+    std::lock_guard<std::mutex> guard(FileSystem::lock);
+
+    auto it = std::find_if(FileSystem::mounts.begin(), FileSystem::mounts.end(), [&](const std::shared_ptr<S2DMount>& m) { return m->id == mountID; });
+    if (it == FileSystem::mounts.end()) return false;
+
+    FileSystem::mounts.erase(it);
+    FileSystem::RebuildIndex();
+
+    return true;
+}
+
+void S2DFileSystem::UnmountAll()
+{
+    std::lock_guard<std::mutex> guard(FileSystem::lock);
+
+    FileSystem::index.clear();
+    FileSystem::mounts.clear();
+}
+
+void S2DFileSystem::Rescan()
+{
+    std::lock_guard<std::mutex> guard(FileSystem::lock);
+
+    for (auto& mount : FileSystem::mounts)
+    {
+        if (mount->type == MountType::Directory)
+            FileSystem::ScanDirectory(mount.get());
+    }
+
+    FileSystem::RebuildIndex();
+}
+
+bool S2DFileSystem::Exists(const char* path)
+{
+    if (!path) return false;
+
+    {
+        std::lock_guard<std::mutex> guard(FileSystem::lock);
+
+        if (FileSystem::index.find(S2DPack::NormalizePath(path)) != FileSystem::index.end())
+            return true;
+    }
+
+    SDL_RWops* file = SDL_RWFromFile(path, "rb");
+    if (file) SDL_RWclose(file);
+
+    return file != NULL;
+}
+
+SDL_RWops* S2DFileSystem::Open(const char* path)
+{
+    if (!path) return nullptr;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    FileSystem::IndexEntry entry;
+
+    {
+        std::lock_guard<std::mutex> guard(FileSystem::lock);
+
+        auto it = FileSystem::index.find(S2DPack::NormalizePath(path));
+        if (it != FileSystem::index.end()) entry = it->second;
+    }
+
+    SDL_RWops* rw = nullptr;
+    std::shared_ptr<S2DFileCounters> counters = entry.mount ? entry.mount->counters : FileSystem::disk;
+
+    if (!entry.mount)
+        rw = SDL_RWFromFile(path, "rb");
+    else if (entry.mount->type == MountType::Directory)
+        rw = SDL_RWFromFile(entry.source.c_str(), "rb");
+    else if (entry.mount->type == MountType::Pack)
+        rw = entry.mount->pack->OpenEntry(entry.source.c_str());
+    else
+        rw = SDL_RWFromConstMem(entry.mount->data, (int)entry.mount->size);
+
+    if (!rw) return nullptr;
+
+    counters->opens++;
+    counters->openTicks += SDL_GetPerformanceCounter() - start;
+
+    return CountStream(rw, counters);
+}
+
+std::vector<S2DMountInfo> S2DFileSystem::GetMounts()
+{
+    std::lock_guard<std::mutex> guard(FileSystem::lock);
+
+    std::vector<S2DMountInfo> result;
+
+    for (auto& mount : FileSystem::mounts)
+    {
+        S2DMountInfo info;
+        info.id = mount->id;
+        info.type = mount->type;
+        info.source = mount->source;
+        info.mountPoint = mount->mountPoint;
+        info.files = (int)mount->files.size();
+        info.stats = mount->counters->GetStats();
+        result.push_back(info);
+    }
+
+    return result;
+}
+
+S2DFileStats S2DFileSystem::GetDiskStats()
+{
+    return FileSystem::disk->GetStats();
+}
+
+void S2DFileSystem::ResetStats()
+{
+    std::lock_guard<std::mutex> guard(FileSystem::lock);
+
+    for (auto& mount : FileSystem::mounts)
+        mount->counters->Reset();
+
+    FileSystem::disk->Reset();
+}
+
+static void DumpMountStats(const char* name, const char* source, int files, const S2DFileStats& stats)
+{
+    char line[512];
+    snprintf(line, sizeof(line), "%-9s %-40s %6d files %6llu opens %10.1f KB %8.2f ms open %8.2f ms read\n",
+             name, source, files, (unsigned long long)stats.opens, stats.bytesRead / 1024.0, stats.openMs, stats.readMs);
+
+    S2DDebugOutput(line);
+}
+
+void S2DFileSystem::DumpStats()
+{
+    static const char* typeNames[] = { "Directory", "Pack", "Memory" };
+
+    for (auto& mount : GetMounts())
+        DumpMountStats(typeNames[(int)mount.type], mount.source.c_str(), mount.files, mount.stats);
+
+    DumpMountStats("Disk", "(not mounted)", 0, GetDiskStats());
+}
+
+namespace Assets
+{
+    SDL_Surface* LoadImageSurface(const char* path)
+    {
+        if (!path) return nullptr;
+
+        // SDL_image needs the extension for formats it can't detect (like TGA)
+        const char* ext = strrchr(path, '.');
+
+        return IMG_LoadTyped_RW(S2DFileSystem::Open(path), 1, ext ? ext + 1 : NULL);
+    }
+}
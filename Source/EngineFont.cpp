@@ -0,0 +1,540 @@
+#include "EngineIncludes.h"
+#include <string>
+#include <map>
+#include <unordered_map>
+
+// Glyph cached in an atlas page
+struct S2DGlyph
+{
+    bool loaded = false;        // Metrics are known
+    bool rasterized = false;    // Pixels are stored in an atlas page
+    int page = -1;
+    SDL_Rect rect = { 0, 0, 0, 0 };
+    int offsetX = 0, offsetY = 0;
+    int minX = 0, advance = 0;
+};
+
+// Measured string in the measure cache
+struct S2DMeasuredText
+{
+    Uint64 hash = 0;
+    int length = 0;
+    std::string text;   // Compared on a hit, different strings can share the hash
+    Uint32 lastUse = 0;
+    S2DTextMetrics metrics;
+};
+
+// Number of sets and entries per set of the measure cache
+#define S2D_MEASURE_CACHE_SETS 64
+#define S2D_MEASURE_CACHE_WAYS 4
+
+// Font face opened at a single pixel size, together with its glyph atlas
+struct S2DGlyphAtlas
+{
+    std::string path;
+    int size = 0;
+
+    TTF_Font* face = nullptr;
+    int ascent = 0, height = 0, lineSkip = 0;
+    bool kerning = false;
+
+    SDL_Renderer* renderer = nullptr;
+    std::vector<SDL_Texture*> pages;
+    int pageSize = 512;
+    int penX = 0, penY = 0, rowHeight = 0;
+
+    S2DGlyph ascii[128];
+    std::unordered_map<Uint16, S2DGlyph> glyphs;
+    std::unordered_map<Uint32, int> kerningPairs;
+
+    // Set-associative LRU cache of measured strings
+    S2DMeasuredText measured[S2D_MEASURE_CACHE_SETS][S2D_MEASURE_CACHE_WAYS];
+    Uint32 measureClock = 0;
+};
+
+// Space between glyphs in atlas pages (avoids bleeding with linear filtering)
+#define S2D_GLYPH_PADDING 1
+
+// Releases the atlas pages, glyph metrics stay cached
+static void ResetGlyphAtlas(S2DGlyphAtlas* atlas)
+{
+    for (auto page : atlas->pages)
+    {
+        SDL_DestroyTexture(page);
+    }
+
+    atlas->pages.clear();
+    atlas->penX = atlas->penY = atlas->rowHeight = 0;
+    atlas->renderer = nullptr;
+
+    for (auto& glyph : atlas->ascii)
+    {
+        glyph.rasterized = false;
+        glyph.page = -1;
+    }
+
+    for (auto& glyph : atlas->glyphs)
+    {
+        glyph.second.rasterized = false;
+        glyph.second.page = -1;
+    }
+}
+
+namespace Fonts
+{
+    std::vector<S2DFont*> LoadedFonts;
+
+    S2DSpriteBatch* TextBatch = nullptr;
+
+    // Waits until the render thread stops using the renderer
+    std::function<void()> WaitRenderer;
+
+    std::map<std::pair<std::string, int>, S2DGlyphAtlas*> GlyphAtlases;
+
+    void ResetGlyphAtlases()
+    {
+        for (auto& it : GlyphAtlases)
+        {
+            ResetGlyphAtlas(it.second);
+        }
+    }
+}
+
+// Decodes the next UTF-8 codepoint and advances the text pointer, returns 0 at the end of the string
+static Uint32 NextCodepoint(const char*& text)
+{
+    const Uint8* s = (const Uint8*)text;
+
+    if (s[0] == 0) return 0;
+
+    if (s[0] < 0x80)
+    {
+        text += 1;
+        return s[0];
+    }
+
+    int length = 0;
+    Uint32 cp = 0;
+
+    if ((s[0] & 0xE0) == 0xC0) { length = 2; cp = s[0] & 0x1F; }
+    else if ((s[0] & 0xF0) == 0xE0) { length = 3; cp = s[0] & 0x0F; }
+    else if ((s[0] & 0xF8) == 0xF0) { length = 4; cp = s[0] & 0x07; }
+
+    for (int i = 1; i < length; i++)
+    {
+        if ((s[i] & 0xC0) != 0x80)
+        {
+            length = 0;
+            break;
+        }
+
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+
+    // Not a valid UTF-8 sequence, treat the byte as Latin-1
+    if (length == 0)
+    {
+        text += 1;
+        return s[0];
+    }
+
+    text += length;
+
+    // SDL_ttf only handles the Basic Multilingual Plane
+    return cp > 0xFFFF ? '?' : cp;
+}
+
+static S2DGlyphAtlas* FindGlyphAtlas(const std::string& path, int size)
+{
+    auto key = std::make_pair(path, size);
+
+    auto it = Fonts::GlyphAtlases.find(key);
+    if (it != Fonts::GlyphAtlases.end()) return it->second;
+
+    TTF_Font* face = TTF_OpenFontRW(S2DFileSystem::Open(path.c_str()), 1, size);
+    if (!face) return nullptr;
+
+    S2DGlyphAtlas* atlas = new S2DGlyphAtlas();
+    atlas->path = path;
+    atlas->size = size;
+    atlas->face = face;
+    atlas->ascent = TTF_FontAscent(face);
+    atlas->height = TTF_FontHeight(face);
+    atlas->lineSkip = TTF_FontLineSkip(face);
+    atlas->kerning = TTF_GetFontKerning(face) != 0;
+
+    while (atlas->pageSize < atlas->height * 8 && atlas->pageSize < 4096)
+        atlas->pageSize *= 2;
+
+    Fonts::GlyphAtlases.insert(std::make_pair(key, atlas));
+
+    return atlas;
+}
+
+static S2DGlyph* GetGlyph(S2DGlyphAtlas* atlas, Uint16 ch)
+{
+    S2DGlyph* glyph = ch < 128 ? &atlas->ascii[ch] : &atlas->glyphs[ch];
+
+    if (!glyph->loaded)
+    {
+        int minX, maxX, minY, maxY, advance;
+
+        if (TTF_GlyphMetrics(atlas->face, ch, &minX, &maxX, &minY, &maxY, &advance) == 0)
+        {
+            glyph->minX = minX;
+            glyph->advance = advance;
+        }
+
+        glyph->loaded = true;
+    }
+
+    return glyph;
+}
+
+static int GetKerning(S2DGlyphAtlas* atlas, Uint16 prev, Uint16 ch)
+{
+    if (!atlas->kerning || prev == 0) return 0;
+
+    Uint32 key = ((Uint32)prev << 16) | ch;
+
+    auto it = atlas->kerningPairs.find(key);
+    if (it != atlas->kerningPairs.end()) return it->second;
+
+    int kerning = TTF_GetFontKerningSizeGlyphs(atlas->face, prev, ch);
+    atlas->kerningPairs.insert(std::make_pair(key, kerning));
+
+    return kerning;
+}
+
+static SDL_Texture* CreateGlyphPage(S2DGlyphAtlas* atlas)
+{
+    SDL_Texture* page = SDL_CreateTexture(atlas->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, atlas->pageSize, atlas->pageSize);
+    if (!page) return nullptr;
+
+    // Static textures don't have defined contents, clear the page first
+    std::vector<Uint32> clear((size_t)atlas->pageSize * atlas->pageSize, 0);
+    SDL_UpdateTexture(page, NULL, clear.data(), atlas->pageSize * sizeof(Uint32));
+    SDL_SetTextureBlendMode(page, SDL_BLENDMODE_BLEND);
+
+    atlas->pages.push_back(page);
+    atlas->penX = atlas->penY = atlas->rowHeight = 0;
+
+    return page;
+}
+
+static void RasterizeGlyph(S2DGlyphAtlas* atlas, S2DGlyph* glyph, Uint16 ch)
+{
+    glyph->rasterized = true;
+    glyph->page = -1;
+    glyph->rect = { 0, 0, 0, 0 };
+
+    Uint16 ucs2[2] = { ch, 0 };
+    SDL_Surface* rendered = TTF_RenderUNICODE_Blended(atlas->face, ucs2, { 255, 255, 255, 255 });
+    if (!rendered) return;
+
+    SDL_Surface* surface = rendered;
+    if (rendered->format->format != SDL_PIXELFORMAT_ARGB8888)
+    {
+        surface = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(rendered);
+        if (!surface) return;
+    }
+
+    // Trim the transparent border, the surface covers the whole line height
+    int left = surface->w, top = surface->h, right = -1, bottom = -1;
+
+    for (int y = 0; y < surface->h; y++)
+    {
+        const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + y * surface->pitch);
+
+        for (int x = 0; x < surface->w; x++)
+        {
+            if (row[x] & 0xFF000000)
+            {
+                if (x < left) left = x;
+                if (x > right) right = x;
+                if (y < top) top = y;
+                if (y > bottom) bottom = y;
+            }
+        }
+    }
+
+    if (right >= left && bottom >= top)
+    {
+        int w = right - left + 1;
+        int h = bottom - top + 1;
+
+        if (w + S2D_GLYPH_PADDING <= atlas->pageSize && h + S2D_GLYPH_PADDING <= atlas->pageSize)
+        {
+            // Simple shelf packing: fill a row, then start a new one, then start a new page
+            if (atlas->pages.empty() || atlas->penX + w + S2D_GLYPH_PADDING > atlas->pageSize)
+            {
+                atlas->penX = 0;
+                atlas->penY += atlas->rowHeight;
+                atlas->rowHeight = 0;
+            }
+
+            if (Fonts::WaitRenderer) Fonts::WaitRenderer();
+
+            if (atlas->pages.empty() || atlas->penY + h + S2D_GLYPH_PADDING > atlas->pageSize)
+                CreateGlyphPage(atlas);
+
+            if (!atlas->pages.empty())
+            {
+                glyph->page = (int)atlas->pages.size() - 1;
+                glyph->rect = { atlas->penX, atlas->penY, w, h };
+                glyph->offsetX = SDL_min(0, glyph->minX) + left;
+                glyph->offsetY = top;
+
+                const Uint8* pixels = (const Uint8*)surface->pixels + top * surface->pitch + left * sizeof(Uint32);
+                SDL_UpdateTexture(atlas->pages.back(), &glyph->rect, pixels, surface->pitch);
+
+                atlas->penX += w + S2D_GLYPH_PADDING;
+                atlas->rowHeight = SDL_max(atlas->rowHeight, h + S2D_GLYPH_PADDING);
+            }
+        }
+    }
+
+    SDL_FreeSurface(surface);
+}
+
+// Walks the text using cached glyph metrics, calls onLine(width) for every line
+template<typename LineFunc>
+static void WalkLines(S2DGlyphAtlas* atlas, const char* text, LineFunc onLine)
+{
+    int lineWidth = 0;
+    Uint16 prev = 0;
+
+    const char* p = text;
+    while (Uint32 cp = NextCodepoint(p))
+    {
+        if (cp == '\n')
+        {
+            onLine(lineWidth);
+            lineWidth = 0;
+            prev = 0;
+            continue;
+        }
+
+        Uint16 ch = (Uint16)cp;
+
+        lineWidth += GetKerning(atlas, prev, ch) + GetGlyph(atlas, ch)->advance;
+        prev = ch;
+    }
+
+    onLine(lineWidth);
+}
+
+static S2DTextMetrics MeasureText(S2DGlyphAtlas* atlas, const char* text)
+{
+    // FNV-1a hash of the string
+    Uint64 hash = 14695981039346656037ULL;
+    int length = 0;
+
+    for (const char* p = text; *p; p++, length++)
+    {
+        hash ^= (Uint8)*p;
+        hash *= 1099511628211ULL;
+    }
+
+    S2DMeasuredText* set = atlas->measured[hash % S2D_MEASURE_CACHE_SETS];
+    S2DMeasuredText* oldest = &set[0];
+
+    atlas->measureClock++;
+
+    for (int i = 0; i < S2D_MEASURE_CACHE_WAYS; i++)
+    {
+        if (set[i].lastUse != 0 && set[i].hash == hash && set[i].length == length && memcmp(set[i].text.data(), text, length) == 0)
+        {
+            set[i].lastUse = atlas->measureClock;
+            return set[i].metrics;
+        }
+
+        if (set[i].lastUse < oldest->lastUse)
+            oldest = &set[i];
+    }
+
+    S2DTextMetrics metrics;
+    metrics.lineHeight = atlas->lineSkip;
+    metrics.ascent = atlas->ascent;
+    metrics.descent = TTF_FontDescent(atlas->face);
+
+    WalkLines(atlas, text, [&](int lineWidth)
+    {
+        metrics.width = SDL_max(metrics.width, lineWidth);
+        metrics.lines++;
+    });
+
+    metrics.height = atlas->height + (metrics.lines - 1) * atlas->lineSkip;
+
+    // Replace the least recently used entry of the set
+    oldest->hash = hash;
+    oldest->length = length;
+    oldest->text.assign(text, length);
+    oldest->lastUse = atlas->measureClock;
+    oldest->metrics = metrics;
+
+    return metrics;
+}
+
+S2DGlyphAtlas* S2DFont::GetAtlas(int size)
+{
+    for (auto& face : cachedFaces)
+    {
+        if (face.atlas && face.size == size) return face.atlas;
+    }
+
+    S2DGlyphAtlas* atlas = FindGlyphAtlas(ttfFile, size);
+    if (!atlas) return nullptr;
+
+    cachedFaces[nextCachedFace].size = size;
+    cachedFaces[nextCachedFace].atlas = atlas;
+    nextCachedFace = (nextCachedFace + 1) % SDL_arraysize(cachedFaces);
+
+    return atlas;
+}
+
+S2DFont::S2DFont(SDL_Renderer* renderer, const char* path)
+{
+    myRenderer = renderer;
+    ttfFile = std::string(path);
+
+    TTF_Font* fnt = TTF_OpenFontRW(S2DFileSystem::Open(path), 1, 36);
+
+    if (!fnt)
+        S2DFatalErrorFormatted("%s", TTF_GetError());
+
+    Fonts::LoadedFonts.push_back(this);
+
+    TTF_CloseFont(fnt);
+}
+
+Vec2Int S2DFont::GetSize(int size, const char* text)
+{
+    S2DTextMetrics metrics = Measure(size, text);
+
+    return Vec2Int(metrics.width, metrics.height);
+}
+
+S2DTextMetrics S2DFont::Measure(int size, const char* text)
+{
+    if (!text) return S2DTextMetrics();
+
+    S2DGlyphAtlas* atlas = GetAtlas(size);
+    if (!atlas) return S2DTextMetrics();
+
+    return MeasureText(atlas, text);
+}
+
+int S2DFont::MeasureLines(int size, const char* text, Vec2Int* extents, int maxLines)
+{
+    if (!text) return 0;
+
+    S2DGlyphAtlas* atlas = GetAtlas(size);
+    if (!atlas) return 0;
+
+    int lines = 0;
+
+    WalkLines(atlas, text, [&](int lineWidth)
+    {
+        if (lines < maxLines)
+        {
+            extents[lines].x = lineWidth;
+            extents[lines].y = atlas->height;
+        }
+
+        lines++;
+    });
+
+    return lines;
+}
+
+void S2DFont::Render(int size, const char* text, Vec2 pos, Vec2 center, float angle, TexFlipMode flip, Color color, S2DDrawList* list)
+{
+    if (!text || (!Fonts::TextBatch && !list)) return;
+
+    S2DGlyphAtlas* atlas = GetAtlas(size);
+    if (!atlas) return;
+
+    if (atlas->renderer != myRenderer)
+    {
+        ResetGlyphAtlas(atlas);
+        atlas->renderer = myRenderer;
+    }
+
+    S2DTextMetrics metrics = MeasureText(atlas, text);
+    if (metrics.width <= 0) return;
+
+    Vec2Int box = Vec2Int(metrics.width, metrics.height);
+
+    SDL_FRect rect = { pos.x - (box.x * center.x), pos.y - (box.y * center.y), (float)box.x, (float)box.y };
+    SDL_FPoint pivot = { rect.x + rect.w * 0.5f, rect.y + rect.h * 0.5f };
+
+    bool flipH = ((int)flip & SDL_FLIP_HORIZONTAL) != 0;
+    bool flipV = ((int)flip & SDL_FLIP_VERTICAL) != 0;
+
+    int penX = 0, penY = 0;
+    Uint16 prev = 0;
+
+    const char* p = text;
+    while (Uint32 cp = NextCodepoint(p))
+    {
+        if (cp == '\n')
+        {
+            penX = 0;
+            penY += atlas->lineSkip;
+            prev = 0;
+            continue;
+        }
+
+        Uint16 ch = (Uint16)cp;
+
+        penX += GetKerning(atlas, prev, ch);
+
+        S2DGlyph* glyph = GetGlyph(atlas, ch);
+
+        if (!glyph->rasterized)
+            RasterizeGlyph(atlas, glyph, ch);
+
+        if (glyph->page >= 0)
+        {
+            float x = (float)(penX + glyph->offsetX);
+            float y = (float)(penY + glyph->offsetY);
+
+            // Mirror the glyph placement inside the text box
+            if (flipH) x = box.x - x - glyph->rect.w;
+            if (flipV) y = box.y - y - glyph->rect.h;
+
+            SDL_FRect dst = { rect.x + x, rect.y + y, (float)glyph->rect.w, (float)glyph->rect.h };
+            SDL_FPoint glyphCenter = { pivot.x - dst.x, pivot.y - dst.y };
+
+            if (list)
+                list->Draw(atlas->pages[glyph->page], &glyph->rect, dst, angle, &glyphCenter, flip, color);
+            else
+                Fonts::TextBatch->Draw(atlas->pages[glyph->page], &glyph->rect, dst, angle, &glyphCenter, flip, color);
+        }
+
+        penX += glyph->advance;
+        prev = ch;
+    }
+}
+
+S2DTexture* S2DFont::RenderToTexture(int size, const char* text, Color color)
+{
+    TTF_Font* fnt = TTF_OpenFontRW(S2DFileSystem::Open(ttfFile.c_str()), 1, size);
+    SDL_Surface* sur = TTF_RenderText_Blended(fnt, text, { color.r, color.g, color.b, color.a });
+
+    if (Fonts::WaitRenderer) Fonts::WaitRenderer();
+
+    SDL_Texture* tex = SDL_CreateTextureFromSurface(myRenderer, sur);
+
+    SDL_FreeSurface(sur);
+    TTF_CloseFont(fnt);
+
+    return new S2DTexture(tex, "");
+}
+
+void S2DFont::UpdateRenderer(SDL_Renderer* renderer)
+{
+    myRenderer = renderer;
+}
@@ -0,0 +1,333 @@
+#include "EngineIncludes.h"
+#include <thread>
+#include <algorithm>
+
+struct S2DFrameSystem
+{
+    std::string name;
+    S2DSystemFunction function;
+    std::vector<int> reads, writes;
+    bool mainThread = false;
+    bool enabled = true;
+
+    // Systems this one waits for and the systems waiting for it
+    std::vector<int> dependencies;
+    std::vector<int> dependents;
+
+    // Dependencies that didn't finish yet in the running frame
+    std::atomic<int> waiting{ 0 };
+
+    // Timings of the last run (written by the thread running the system)
+    Uint64 start = 0, end = 0;
+
+    // Statistics (main thread only)
+    float last = 0, max = 0;
+    double total = 0;
+    bool critical = false;
+};
+
+static int GetResourceID(std::unordered_map<std::string, int>& resources, const std::string& name)
+{
+    auto it = resources.find(name);
+    if (it != resources.end()) return it->second;
+
+    int id = (int)resources.size();
+    resources.emplace(name, id);
+
+    return id;
+}
+
+static float CountsToMilliseconds(Uint64 counts)
+{
+    return (float)((double)counts * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+S2DFrameGraph::~S2DFrameGraph()
+{
+    for (auto system : Systems)
+        delete system;
+}
+
+int S2DFrameGraph::AddSystem(const char* name, S2DSystemFunction function, const std::vector<std::string>& reads, const std::vector<std::string>& writes, bool mainThread)
+{
+    S2DFrameSystem* system = new S2DFrameSystem();
+    system->name = name ? name : "";
+    system->function = function;
+    system->mainThread = mainThread;
+
+    for (auto& resource : reads)
+        system->reads.push_back(GetResourceID(Resources, resource));
+
+    for (auto& resource : writes)
+        system->writes.push_back(GetResourceID(Resources, resource));
+
+    Systems.push_back(system);
+    Built = false;
+
+    return (int)Systems.size() - 1;
+}
+
+void S2DFrameGraph::SetSystemEnabled(int system, bool state)
+{
+    if (system < 0 || system >= (int)Systems.size()) return;
+
+    Systems[system]->enabled = state;
+}
+
+bool S2DFrameGraph::IsSystemEnabled(int system)
+{
+    if (system < 0 || system >= (int)Systems.size()) return false;
+
+    return Systems[system]->enabled;
+}
+
+std::vector<int> S2DFrameGraph::GetSystemDependencies(int system)
+{
+    if (system < 0 || system >= (int)Systems.size()) return std::vector<int>();
+
+    if (!Built) Build();
+
+    return Systems[system]->dependencies;
+}
+
+void S2DFrameGraph::Build()
+{
+    S2DProfileZone("Build Frame Graph");
+
+    // Last system writing every resource and the systems reading it since then
+    std::vector<int> lastWriter(Resources.size(), -1);
+    std::vector<std::vector<int>> readers(Resources.size());
+
+    for (int id = 0; id < (int)Systems.size(); id++)
+    {
+        S2DFrameSystem* system = Systems[id];
+
+        system->dependencies.clear();
+        system->dependents.clear();
+
+        auto addDependency = [&](int other)
+        {
+            if (other < 0 || other == id) return;
+
+            for (int dependency : system->dependencies)
+            {
+                if (dependency == other) return;
+            }
+
+            system->dependencies.push_back(other);
+        };
+
+        // Reading waits for the last write, writing waits for the last write and all the reads after it
+        for (int resource : system->reads)
+            addDependency(lastWriter[resource]);
+
+        for (int resource : system->writes)
+        {
+            addDependency(lastWriter[resource]);
+
+            for (int reader : readers[resource])
+                addDependency(reader);
+        }
+
+        for (int resource : system->reads)
+            readers[resource].push_back(id);
+
+        for (int resource : system->writes)
+        {
+            lastWriter[resource] = id;
+            readers[resource].clear();
+        }
+    }
+
+    // The systems only wait for earlier ones, so the graph can't have cycles
+    for (int id = 0; id < (int)Systems.size(); id++)
+    {
+        for (int dependency : Systems[id]->dependencies)
+            Systems[dependency]->dependents.push_back(id);
+    }
+
+    Built = true;
+}
+
+void S2DFrameGraph::Release(int system)
+{
+    if (Jobs && !Systems[system]->mainThread)
+    {
+        Jobs->Schedule([this, system]() { RunSystem(system); });
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(MainLock);
+    MainReady.push_back(system);
+}
+
+void S2DFrameGraph::RunSystem(int id)
+{
+    S2DFrameSystem* system = Systems[id];
+
+    system->start = SDL_GetPerformanceCounter();
+
+    if (system->enabled && system->function) system->function(DeltaTime);
+
+    system->end = SDL_GetPerformanceCounter();
+
+#ifdef S2D_PROFILER_ENABLED
+    // The name lives as long as the system
+    S2DProfiler::RecordZone(system->name.c_str(), system->start, system->end);
+#endif // S2D_PROFILER_ENABLED
+
+    for (int dependent : system->dependents)
+    {
+        if (Systems[dependent]->waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) Release(dependent);
+    }
+
+    Remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void S2DFrameGraph::Run(S2DJobSystem* jobs, float deltaTime)
+{
+    if (Systems.empty()) return;
+
+    if (!Built) Build();
+
+    S2DProfileZone("Frame Graph");
+
+    Jobs = jobs;
+    DeltaTime = deltaTime;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    Remaining.store((int)Systems.size(), std::memory_order_relaxed);
+
+    for (auto system : Systems)
+        system->waiting.store((int)system->dependencies.size(), std::memory_order_relaxed);
+
+    for (int id = 0; id < (int)Systems.size(); id++)
+    {
+        if (Systems[id]->dependencies.empty()) Release(id);
+    }
+
+    while (Remaining.load(std::memory_order_acquire) > 0)
+    {
+        int system = -1;
+
+        {
+            std::lock_guard<std::mutex> lock(MainLock);
+
+            if (!MainReady.empty())
+            {
+                // The earliest added system first, so the graph runs in the added order without a job system
+                auto first = std::min_element(MainReady.begin(), MainReady.end());
+                system = *first;
+                MainReady.erase(first);
+            }
+        }
+
+        if (system >= 0)
+            RunSystem(system);
+        else if (!Jobs || !Jobs->RunPendingJob())
+            std::this_thread::yield();
+    }
+
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    Jobs = nullptr;
+
+    UpdateStats(start, end);
+}
+
+void S2DFrameGraph::UpdateStats(Uint64 start, Uint64 end)
+{
+    // Finish time of the longest chain ending with every system, the systems come in a dependency order
+    std::vector<float> finish(Systems.size());
+    std::vector<int> previous(Systems.size(), -1);
+
+    int last = -1;
+    float work = 0.0f;
+
+    for (int id = 0; id < (int)Systems.size(); id++)
+    {
+        S2DFrameSystem* system = Systems[id];
+
+        system->last = CountsToMilliseconds(system->end - system->start);
+        system->max = SDL_max(system->max, system->last);
+        system->total += system->last;
+        system->critical = false;
+
+        work += system->last;
+
+        float before = 0.0f;
+
+        for (int dependency : system->dependencies)
+        {
+            if (finish[dependency] > before)
+            {
+                before = finish[dependency];
+                previous[id] = dependency;
+            }
+        }
+
+        finish[id] = before + system->last;
+
+        if (last < 0 || finish[id] > finish[last]) last = id;
+    }
+
+    for (int id = last; id >= 0; id = previous[id])
+        Systems[id]->critical = true;
+
+    Frames++;
+
+    LastWall = CountsToMilliseconds(end - start);
+    LastCriticalPath = finish[last];
+    LastWork = work;
+
+    TotalWall += LastWall;
+    TotalCriticalPath += LastCriticalPath;
+    TotalWork += LastWork;
+}
+
+S2DFrameGraphStats S2DFrameGraph::GetStats()
+{
+    S2DFrameGraphStats stats;
+    stats.frames = Frames;
+
+    stats.wall = LastWall;
+    stats.criticalPath = LastCriticalPath;
+    stats.work = LastWork;
+
+    if (Frames > 0)
+    {
+        stats.averageWall = (float)(TotalWall / Frames);
+        stats.averageCriticalPath = (float)(TotalCriticalPath / Frames);
+        stats.averageWork = (float)(TotalWork / Frames);
+    }
+
+    for (auto system : Systems)
+    {
+        S2DSystemStats systemStats;
+        systemStats.name = system->name;
+        systemStats.last = system->last;
+        systemStats.average = Frames > 0 ? (float)(system->total / Frames) : 0.0f;
+        systemStats.max = system->max;
+        systemStats.critical = system->critical;
+
+        stats.systems.push_back(systemStats);
+    }
+
+    return stats;
+}
+
+void S2DFrameGraph::ResetStats()
+{
+    Frames = 0;
+
+    LastWall = LastCriticalPath = LastWork = 0.0f;
+    TotalWall = TotalCriticalPath = TotalWork = 0.0;
+
+    for (auto system : Systems)
+    {
+        system->last = system->max = 0.0f;
+        system->total = 0.0;
+        system->critical = false;
+    }
+}
@@ -0,0 +1,101 @@
+#include "EngineIncludes.h"
+#include <algorithm>
+#include <float.h>
+
+// Upper limits of the hitch histogram buckets (in milliseconds)
+static const float HitchLimits[S2D_HITCH_BUCKETS] = { 16.7f, 33.4f, 50.0f, 100.0f, 250.0f, FLT_MAX };
+
+void S2DFrameHistory::SetSize(int frames)
+{
+    if (frames < 1) frames = 1;
+
+    Size = frames;
+
+    FrameTimes.assign(Size, 0.0f);
+    UpdateTimes.assign(Size, 0.0f);
+    RenderTimes.assign(Size, 0.0f);
+    Sorted.reserve(Size);
+
+    Reset();
+}
+
+void S2DFrameHistory::Reset()
+{
+    Head = 0;
+    Count = 0;
+}
+
+void S2DFrameHistory::Add(float frameMs, float updateMs, float renderMs)
+{
+    FrameTimes[Head] = frameMs;
+    UpdateTimes[Head] = updateMs;
+    RenderTimes[Head] = renderMs;
+
+    Head = (Head + 1) % Size;
+    if (Count < Size) Count++;
+}
+
+void S2DFrameHistory::ComputeTiming(const std::vector<float>& samples, S2DTimingStats& stats)
+{
+    // Until the window fills up only the beginning of the buffer is used
+    Sorted.assign(samples.begin(), samples.begin() + Count);
+    std::sort(Sorted.begin(), Sorted.end());
+
+    double sum = 0.0;
+    for (float sample : Sorted) sum += sample;
+
+    // Nearest-rank percentile
+    auto percentile = [&](float p)
+    {
+        int rank = (int)ceilf(p * Count) - 1;
+        return Sorted[std::min(std::max(rank, 0), Count - 1)];
+    };
+
+    stats.mean = (float)(sum / Count);
+    stats.min = Sorted.front();
+    stats.max = Sorted.back();
+    stats.p50 = percentile(0.50f);
+    stats.p95 = percentile(0.95f);
+    stats.p99 = percentile(0.99f);
+}
+
+S2DFrameStats S2DFrameHistory::Compute()
+{
+    S2DFrameStats stats;
+
+    for (int i = 0; i < S2D_HITCH_BUCKETS; i++)
+        stats.hitchLimits[i] = HitchLimits[i];
+
+    if (Count == 0) return stats;
+
+    stats.frames = Count;
+
+    ComputeTiming(UpdateTimes, stats.update);
+    ComputeTiming(RenderTimes, stats.render);
+
+    // Computed last so the sorted frame times are still around for the rest
+    ComputeTiming(FrameTimes, stats.frame);
+
+    if (stats.frame.mean > 0.0f)
+        stats.averageFps = 1000.0f / stats.frame.mean;
+
+    int slowest = SDL_max(Count / 100, 1);
+    double slowestSum = 0.0;
+
+    for (int i = Count - slowest; i < Count; i++)
+        slowestSum += Sorted[i];
+
+    if (slowestSum > 0.0)
+        stats.onePercentLowFps = (float)(1000.0 * slowest / slowestSum);
+
+    int bucket = 0;
+
+    for (float frameTime : Sorted)
+    {
+        while (bucket < S2D_HITCH_BUCKETS - 1 && frameTime > HitchLimits[bucket]) bucket++;
+
+        stats.hitches[bucket]++;
+    }
+
+    return stats;
+}
@@ -2,13 +2,13 @@
 #include <thread>
 #include <string>
 #include <map>
-
-std::vector<S2DFont*> LoadedFonts;
+#include <algorithm>
 
 std::vector<ScreenResolution> GetResolutions()
 {
     std::vector<ScreenResolution> resolutions;
 
+#ifdef _WIN32
     DEVMODE dm = { 0 };
     dm.dmSize = sizeof(dm);
     for (int iModeNum = 0; EnumDisplaySettings(NULL, iModeNum, &dm) != 0; iModeNum++) {
@@ -16,6 +16,15 @@ std::vector<ScreenResolution> GetResolutions()
 
         resolutions.push_back({ (int)dm.dmPelsWidth, (int)dm.dmPelsHeight });
     }
+#else
+    int numModes = SDL_GetNumDisplayModes(0);
+    for (int iModeNum = 0; iModeNum < numModes; iModeNum++) {
+        SDL_DisplayMode mode;
+        if (SDL_GetDisplayMode(0, iModeNum, &mode) != 0 || mode.refresh_rate != 60) continue;
+
+        resolutions.push_back({ mode.w, mode.h });
+    }
+#endif // _WIN32
 
     return resolutions;
 }
@@ -29,75 +38,6 @@ ScreenResolution* GetResolution(int width, int height)
     }
 }
 
-S2DFont::S2DFont(SDL_Renderer* renderer, const char* path)
-{
-    myRenderer = renderer;
-    ttfFile = std::string(path);
-
-    TTF_Font* fnt = TTF_OpenFont(path, 36);
-
-    if (!fnt)
-        S2DFatalErrorFormatted("%s", TTF_GetError());
-
-    LoadedFonts.push_back(this);
-
-    TTF_CloseFont(fnt);
-}
-
-Vec2Int S2DFont::GetSize(int size, const char* text)
-{
-    TTF_Font* fnt = TTF_OpenFont(ttfFile.c_str(), size);
-    SDL_Surface* sur = TTF_RenderText_Blended(fnt, text, { 255, 255, 255, 255 });
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(myRenderer, sur);
-
-    Vec2Int s;
-
-    SDL_QueryTexture(tex, NULL, NULL, &s.x, &s.y);
-
-    SDL_DestroyTexture(tex);
-    SDL_FreeSurface(sur);
-    TTF_CloseFont(fnt);
-
-    return s;
-}
-
-void S2DFont::Render(int size, const char* text, Vec2 pos, Vec2 center, float angle, TexFlipMode flip, Color color)
-{
-    TTF_Font* fnt = TTF_OpenFont(ttfFile.c_str(), size);
-    SDL_Surface* sur = TTF_RenderText_Blended(fnt, text, { color.r, color.g, color.b, color.a });
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(myRenderer, sur);
-
-    Vec2Int isize = GetSize(size, text);
-
-    Vec2 vsize = Vec2(isize.x, isize.y);
-
-    SDL_FRect rect = { pos.x - (vsize.x * center.x), pos.y - (vsize.y * center.y), vsize.x, vsize.y };
-    SDL_SetTextureColorMod(tex, color.r, color.g, color.b);
-
-    SDL_RenderCopyExF(myRenderer, tex, NULL, &rect, angle, NULL, (SDL_RendererFlip)flip);
-
-    SDL_DestroyTexture(tex);
-    SDL_FreeSurface(sur);
-    TTF_CloseFont(fnt);
-}
-
-S2DTexture* S2DFont::RenderToTexture(int size, const char* text, Color color)
-{
-    TTF_Font* fnt = TTF_OpenFont(ttfFile.c_str(), size);
-    SDL_Surface* sur = TTF_RenderText_Blended(fnt, text, { color.r, color.g, color.b, color.a });
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(myRenderer, sur);
-
-    SDL_FreeSurface(sur);
-    TTF_CloseFont(fnt);
-
-    return new S2DTexture(tex, "");
-}
-
-void S2DFont::UpdateRenderer(SDL_Renderer* renderer)
-{
-    myRenderer = renderer;
-}
-
 S2DSprite::S2DSprite(S2DTexture* tex, Vec2Int sprSize, int frameRate, int numFrames)
 {
     this->texture = tex;
@@ -156,18 +96,35 @@ void S2DSprite::PrevFrame()
         curFrame--;
 }
 
+#ifdef _WIN32
 IDirect3DDevice9* S2DGraphics::GetDX9Device()
 {
+    // The software renderer used in headless mode has no device
+    if (Headless) return NULL;
+
     auto dev = SDL_RenderGetD3D9Device(NativeRenderer);
 
     S2DAssert(dev != NULL);
 
     return dev;
 }
+#endif // _WIN32
 
 Vec2Int S2DGraphics::GetCurrentWindowSize()
 {
-    if (Fullscreen)
+    // Draw calls use the size read at the beginning of the frame
+    if (InFrame) return FrameSize;
+
+    return QueryWindowSize();
+}
+
+Vec2Int S2DGraphics::QueryWindowSize()
+{
+    if (Headless)
+    {
+        return Vec2Int(OffscreenSurface->w, OffscreenSurface->h);
+    }
+    else if (Fullscreen)
     {
         SDL_DisplayMode DM;
         SDL_GetCurrentDisplayMode(GetCurrentScreen(), &DM);
@@ -186,6 +143,9 @@ Vec2Int S2DGraphics::GetCurrentWindowSize()
 
 void S2DGraphics::SetResolution(ScreenResolution* res)
 {
+    // Resizing the window changes the renderer
+    SyncRenderer();
+
     SDL_SetWindowSize(EngineWindow, res->width, res->height);
 
     CurrentResolution = *res;
@@ -193,6 +153,8 @@ void S2DGraphics::SetResolution(ScreenResolution* res)
 
 void S2DGraphics::SetResolution(int w, int h)
 {
+    SyncRenderer();
+
     SDL_SetWindowSize(EngineWindow, w, h);
 
     CurrentResolution = { w, h };
@@ -200,301 +162,625 @@ void S2DGraphics::SetResolution(int w, int h)
 
 void S2DGraphics::SetScreen(int screen)
 {
+    SyncRenderer();
+
     SDL_SetWindowPosition(EngineWindow, SDL_WINDOWPOS_CENTERED_DISPLAY(screen), SDL_WINDOWPOS_CENTERED_DISPLAY(screen));
     CurrentScreen = screen;
 }
 
 void S2DGraphics::SetFullscreen(bool state)
 {
+    // There is no display to switch in headless mode
+    if (Headless) return;
+
+    S2DProfileZone("SetFullscreen");
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
     Fullscreen = state;
 
     Running = false;
 
-    std::map<int, const char*> reloadTexs = GetReloadTextures();
-    //ClearTextures();
-    SDL_DestroyRenderer(NativeRenderer);
+    SyncRenderer();
+
+    LastReset = S2DRendererResetStats();
+
+    // The renderer resets its device on its own when the window changes and keeps the textures,
+    // if the device gets lost SDL sends SDL_RENDER_DEVICE_RESET and ResetDevice uploads them again
+    if (SDL_SetWindowFullscreen(EngineWindow, state ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0) != 0)
+    {
+        S2DDebugOutput(("Cannot switch fullscreen mode: " + std::string(SDL_GetError()) + "\n").c_str());
+    }
+
+    OnRenderReload();
+
+    ReportReset("Fullscreen switch", start);
+
+    Running = true;
+}
+
+void S2DGraphics::ResetDevice()
+{
+    S2DProfileZone("ResetDevice");
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    Running = false;
 
-    int width, height;
+    LastReset = S2DRendererResetStats();
+
+    // The pending sprites, the recorded frames and the glyph pages use the lost textures
+    SpriteBatch.Clear();
+    DropRecordedFrames(NativeRenderer);
+    Fonts::ResetGlyphAtlases();
+
+    // The baked tile map chunks lost their contents
+    TargetGeneration++;
+
+    if (!ReuploadTextures())
+        RecreateRenderer();
+
+    OnRenderReload();
+
+    ReportReset("Device reset", start);
+
+    Running = true;
+}
+
+bool S2DGraphics::ReuploadTextures()
+{
+    S2DProfileZone("Reupload Textures");
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    bool success = true;
+
+    SDL_DestroyTexture(PlaceholderTexture);
+    CreatePlaceholderTexture();
+
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+
+    Textures.ForEach([&](S2DTexture* tex)
+    {
+        if (!success) return;
+
+        // Textures that are still loading get uploaded once they're decoded
+        if (tex->loading)
+        {
+            tex->nativeTexture = PlaceholderTexture;
+            Textures.Update(tex->textureID);
+            return;
+        }
+
+        // Sub-textures are updated after their atlas pages
+        if (tex->page) return;
+
+        SDL_DestroyTexture(tex->nativeTexture);
+        tex->nativeTexture = NULL;
+
+        // Textures without kept pixels have to be read from disk
+        SDL_Surface* surface = tex->pixels;
+
+        if (!surface && tex->GetPath())
+            surface = tex->cooked ? S2DCookedTexture::Load(tex->GetPath(), NULL) : Assets::LoadImageSurface(tex->GetPath());
+
+        if (surface)
+        {
+            if (tex->cooked)
+                tex->nativeTexture = CreateCookedTexture(surface, tex->premultiplied);
+            else
+                tex->nativeTexture = SDL_CreateTextureFromSurface(NativeRenderer, surface);
+
+            if (!tex->nativeTexture) success = false;
+
+            if (surface != tex->pixels) SDL_FreeSurface(surface);
+        }
+
+        Textures.Update(tex->textureID);
+        LastReset.textures++;
+    });
+
+    Textures.ForEach([&](S2DTexture* tex)
+    {
+        if (!tex->page) return;
+
+        tex->nativeTexture = tex->page->nativeTexture;
+        Textures.Update(tex->textureID);
+    });
+
+    LastReset.uploadMs += (float)((double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+
+    return success;
+}
+
+void S2DGraphics::RecreateRenderer()
+{
+    S2DProfileZone("Recreate Renderer");
+
+    SpriteBatch.Clear();
+    DropRecordedFrames(NativeRenderer);
+    Fonts::ResetGlyphAtlases();
+
+    Textures.ForEach([](S2DTexture* tex)
+    {
+        if (!tex->loading && !tex->page) SDL_DestroyTexture(tex->nativeTexture);
+        tex->nativeTexture = NULL;
+    });
+
+    SDL_DestroyTexture(PlaceholderTexture);
+    PlaceholderTexture = NULL;
+
+    // The render targets of the tile maps are destroyed together with the renderer
+    SDL_DestroyRenderer(NativeRenderer);
+    RendererGeneration++;
 
-    SDL_GetWindowSize(EngineWindow, &width, &height);
-    SDL_Surface* surface = SDL_GetWindowSurface(EngineWindow);
-    Uint32 skyblue = SDL_MapRGB(surface->format, 0, 0, 0);
-    SDL_FillRect(surface, NULL, skyblue);
-    SDL_UpdateWindowSurface(EngineWindow);
-    SDL_SetWindowFullscreen(EngineWindow, state ? SDL_WINDOW_FULLSCREEN_DESKTOP : NULL);
     NativeRenderer = SDL_CreateRenderer(EngineWindow, 0, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 
-    for (auto font : LoadedFonts)
+    if (!NativeRenderer) // If the Renderer creation failed
+        S2DFatalErrorFormatted("Cannot create renderer!\n%s", SDL_GetError());
+
+    SpriteBatch.SetRenderer(NativeRenderer);
+    DropRecordedFrames(NativeRenderer);
+
+    // The new renderer doesn't clip to the viewport of the last camera
+    Clipping = false;
+
+    for (auto font : Fonts::LoadedFonts)
     {
         font->UpdateRenderer(NativeRenderer);
     }
 
-    for (auto t : reloadTexs)
-    {
-        LoadTexture(t.second);
-    }
+    LastReset.textures = 0;
+    LastReset.recreatedRenderer = true;
 
-    OnRenderReload();
+    ReuploadTextures();
+}
 
-    Running = true;
+void S2DGraphics::ReportReset(const char* reason, Uint64 start)
+{
+    LastReset.totalMs = (float)((double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+
+    char report[256];
+    snprintf(report, sizeof(report), "%s took %.2f ms (%d textures uploaded in %.2f ms%s)\n", reason, LastReset.totalMs, LastReset.textures, LastReset.uploadMs, LastReset.recreatedRenderer ? ", renderer recreated" : "");
+
+    S2DDebugOutput(report);
 }
 
 S2DTexture* S2DGraphics::GetTextureByID(int texID)
 {
-    return LoadedTextures[texID];
+    return Textures.Get(texID);
 }
 
 void S2DGraphics::RenderSprite(S2DCamera* cam, S2DSprite* sprite, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color)
 {
-    if (sprite->GetTexture()->GetPath() == NULL) return;
+    S2DTexture* tex = sprite->GetTexture();
+    if (!tex || !tex->GetSDLTexture()) return;
 
-    SDL_Rect crop = sprite->GetFrames()[sprite->GetCurFrame()];
+    const SDL_Rect& crop = sprite->GetCurFrameRect();
 
-    Vec2 pixPos = Vec2();
-    Vec2 camPixPos = Vec2();
+    SetDrawCamera(cam);
 
-    Vec2Int scrSize = GetCurrentWindowSize();
-    pixPos.x = (pos.x / 16.0f) * scrSize.x;
-    pixPos.y = (pos.y / 16.0f) * scrSize.y;
+    // Reject the objects out of the view before transforming them
+    if (!IsOnScreen(cam, pos, size, angle)) return;
 
-    camPixPos.x = (cam->Position.x / 16.0f) * scrSize.x;
-    camPixPos.y = (cam->Position.y / 16.0f) * scrSize.y;
+    SDL_FRect rect = GetScreenRect(cam, pos, center, size, angle);
 
-    SDL_FRect rect = { pixPos.x - (size.x * center.x) - camPixPos.x + (scrSize.x / 2), pixPos.y - (size.y * center.y) + camPixPos.y + (scrSize.y / 2), size.x, size.y };
+    // Registered textures have their draw data at hand
+    const S2DTextureInfo* info = Textures.IsValid(tex->textureID) ? Textures.GetInfo(tex->textureID) : nullptr;
 
-    Vec2 dist = Vec2::DistanceVec(pixPos, camPixPos);
+    DrawTextureRegion(info ? *info : tex->GetInfo(), &crop, rect, angle, flip, color);
+}
 
-    if (dist.x > ((scrSize.x / 2) + size.x) || dist.y > ((scrSize.y / 2) + size.y)) return;
+// Get the corners of a rectangle turned by an angle around its center
+static void GetRectCorners(const SDL_FRect& rect, float angle, SDL_FPoint* corners)
+{
+    S2DMatrix2D transform = S2DMatrix2D::Translation(rect.x + rect.w * 0.5f, rect.y + rect.h * 0.5f) * S2DMatrix2D::Rotation(angle);
 
-    SDL_SetTextureColorMod(sprite->GetTexture()->GetSDLTexture(), color.r, color.g, color.b);
+    corners[0] = { -rect.w * 0.5f, -rect.h * 0.5f };
+    corners[1] = { rect.w * 0.5f, -rect.h * 0.5f };
+    corners[2] = { rect.w * 0.5f, rect.h * 0.5f };
+    corners[3] = { -rect.w * 0.5f, rect.h * 0.5f };
 
-    SDL_RenderCopyExF(NativeRenderer, sprite->GetTexture()->GetSDLTexture(), &crop, &rect, angle, NULL, (SDL_RendererFlip)flip);
+    transform.TransformPoints(corners, corners, 4);
 }
 
 void S2DGraphics::RenderFilledBox(S2DCamera* cam, Vec2 pos, Vec2 center, Vec2 size, Color color)
 {
-    Vec2 pixPos = Vec2();
-    Vec2 camPixPos = Vec2();
+    SetDrawCamera(cam);
 
-    Vec2Int scrSize = GetCurrentWindowSize();
-    pixPos.x = (pos.x / 16.0f) * scrSize.x;
-    pixPos.y = (pos.y / 16.0f) * scrSize.y;
+    if (!IsOnScreen(cam, pos, size, 0.0f)) return;
 
-    camPixPos.x = (cam->Position.x / 16.0f) * scrSize.x;
-    camPixPos.y = (cam->Position.y / 16.0f) * scrSize.y;
+    float angle = 0.0f;
+    SDL_FRect rect = GetScreenRect(cam, pos, center, size, angle);
 
-    SDL_FRect rect = { pixPos.x - (size.x * center.x) - camPixPos.x + (scrSize.x / 2), pixPos.y - (size.y * center.y) + camPixPos.y + (scrSize.y / 2), size.x, size.y };
+    if (angle == 0.0f)
+    {
+        SpriteBatch.FillRect(rect, color);
+        return;
+    }
 
-    Vec2 dist = Vec2::DistanceVec(pixPos, camPixPos);
+    // A turned camera fills the box as two triangles
+    SDL_FPoint corners[4];
+    GetRectCorners(rect, angle, corners);
 
-    if (dist.x > ((scrSize.x / 2) + size.x) || dist.y > ((scrSize.y / 2) + size.y)) return;
+    const int quad[6] = { 0, 1, 2, 0, 2, 3 };
 
-    SDL_SetRenderDrawColor(NativeRenderer, color.r, color.g, color.b, color.a);
-    SDL_RenderFillRectF(NativeRenderer, &rect);
+    SpriteBatch.FillTriangles(corners, 4, quad, 6, color);
 }
 
 void S2DGraphics::RenderBox(S2DCamera* cam, Vec2 pos, Vec2 center, Vec2 size, Color color)
 {
-    Vec2 pixPos = Vec2();
-    Vec2 camPixPos = Vec2();
+    SetDrawCamera(cam);
 
-    Vec2Int scrSize = GetCurrentWindowSize();
-    pixPos.x = (pos.x / 16.0f) * scrSize.x;
-    pixPos.y = (pos.y / 16.0f) * scrSize.y;
+    if (!IsOnScreen(cam, pos, size, 0.0f)) return;
 
-    camPixPos.x = (cam->Position.x / 16.0f) * scrSize.x;
-    camPixPos.y = (cam->Position.y / 16.0f) * scrSize.y;
+    float angle = 0.0f;
+    SDL_FRect rect = GetScreenRect(cam, pos, center, size, angle);
 
-    SDL_FRect rect = { pixPos.x - (size.x * center.x) - camPixPos.x + (scrSize.x / 2), pixPos.y - (size.y * center.y) + camPixPos.y + (scrSize.y / 2), size.x, size.y };
+    // Same corners as SDL_RenderDrawRectF, the lines join into a single strip
+    SDL_FPoint corners[4] = { { rect.x, rect.y }, { rect.x + rect.w - 1, rect.y }, { rect.x + rect.w - 1, rect.y + rect.h - 1 }, { rect.x, rect.y + rect.h - 1 } };
 
-    Vec2 dist = Vec2::DistanceVec(pixPos, camPixPos);
+    if (angle != 0.0f)
+        GetRectCorners({ rect.x, rect.y, rect.w - 1, rect.h - 1 }, angle, corners);
 
-    if (dist.x > ((scrSize.x / 2) + size.x) || dist.y > ((scrSize.y / 2) + size.y)) return;
-    
-    SDL_SetRenderDrawColor(NativeRenderer, color.r, color.g, color.b, color.a);
-    SDL_RenderDrawRectF(NativeRenderer, &rect);
+    for (int i = 0; i < 4; i++)
+        SpriteBatch.DrawLine(corners[i], corners[(i + 1) % 4], color);
 }
 
 void S2DGraphics::RenderLine(S2DCamera* cam, Vec2 p1, Vec2 p2, Color color)
 {
-    Vec2 pixPos1 = Vec2();
-    Vec2 pixPos2 = Vec2();
-    Vec2 camPixPos = Vec2();
-
-    Vec2Int scrSize = GetCurrentWindowSize();
-    pixPos1.x = (p1.x / 16.0f) * scrSize.x + (scrSize.x / 2);
-    pixPos1.y = (p2.y / 16.0f) * scrSize.y + (scrSize.x / 2);
-    pixPos2.x = (p1.x / 16.0f) * scrSize.x + (scrSize.x / 2);
-    pixPos2.y = (p2.y / 16.0f) * scrSize.y + (scrSize.x / 2);
+    SetDrawCamera(cam);
 
-    SDL_SetRenderDrawColor(NativeRenderer, color.r, color.g, color.b, color.a);
-    SDL_RenderDrawLineF(NativeRenderer, p1.x, p1.y, p2.x, p2.y);
+    SpriteBatch.DrawLine(cam->Matrix.Transform({ p1.x, p1.y }), cam->Matrix.Transform({ p2.x, p2.y }), color);
 }
 
 void S2DGraphics::RenderPoint(S2DCamera* cam, Vec2 position, Color color)
 {
-    SDL_SetRenderDrawColor(NativeRenderer, color.r, color.g, color.b, color.a);
-    SDL_RenderDrawPointF(NativeRenderer, position.x, position.y);
+    SetDrawCamera(cam);
+
+    SpriteBatch.DrawPoint(cam->Matrix.Transform({ position.x, position.y }), color);
 }
 
-S2DTexture* S2DGraphics::LoadTextureRaw(const char* fileName)
+S2DTexture* S2DGraphics::LoadCachedTexture(const char* fileName)
 {
-    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+    std::string path = S2DTextureCache::NormalizePath(fileName);
+
+    S2DTexture* t = TextureCache.Acquire(path);
+
+    if (t)
+    {
+        // The texture is already being loaded asynchronously
+        if (t->loading) WaitTexture(t->textureID);
+
+        return t;
+    }
+
+    if (S2DCookedTexture::IsCookedPath(path.c_str()))
+    {
+        S2DCookedTextureHeader header;
+
+        SDL_Surface* surface = S2DCookedTexture::Load(path.c_str(), &header);
+        if (!surface) return nullptr;
 
-    auto tex = IMG_LoadTexture(NativeRenderer, fileName);
-    if (!tex) return nullptr;
+        t = new S2DTexture(NULL, NULL);
 
-    S2DTexture* t = new S2DTexture(tex, fileName);
+        if (!UploadCookedTexture(t, surface, header))
+        {
+            SDL_FreeSurface(surface);
+            delete t;
+            return nullptr;
+        }
 
-    t->textureID = -1;
+        if (KeepTexturePixels)
+            t->pixels = surface;
+        else
+            SDL_FreeSurface(surface);
+    }
+    else
+    {
+        t = LoadImageTexture(path.c_str());
+        if (!t) return nullptr;
+    }
+
+    if (Textures.Add(t) == S2D_INVALID_TEXTURE)
+    {
+        DestroyTexture(t);
+        return nullptr;
+    }
+
+    t->texPath = TextureCache.Insert(path, t);
 
     return t;
 }
 
-int S2DGraphics::LoadTexture(const char* fileName)
+S2DTexture* S2DGraphics::LoadImageTexture(const char* path)
 {
+    SDL_Surface* surface = Assets::LoadImageSurface(path);
+    if (!surface) return nullptr;
+
+    if (KeepTexturePixels && surface->format->format != SDL_PIXELFORMAT_ARGB8888)
+    {
+        // Keep the pixels in the usual texture format, so the re-upload doesn't need to convert them
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+
+        if (converted)
+        {
+            SDL_FreeSurface(surface);
+            surface = converted;
+        }
+    }
+
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
 
-    auto tex = IMG_LoadTexture(NativeRenderer, fileName);
-    if (!tex) return -1;
+    WaitRenderThread();
 
-    S2DTexture* t = new S2DTexture(tex, fileName);
+    auto tex = SDL_CreateTextureFromSurface(NativeRenderer, surface);
 
-    size_t index = LoadedTextures.size();
+    if (!tex)
+    {
+        SDL_FreeSurface(surface);
+        return nullptr;
+    }
 
-    t->textureID = index;
+    S2DTexture* t = new S2DTexture(tex, NULL);
 
-    LoadedTextures.push_back(t);
+    if (KeepTexturePixels)
+        t->pixels = surface;
+    else
+        SDL_FreeSurface(surface);
 
-    size_t size = LoadedTextures.size();
+    return t;
+}
 
-    return index;
+S2DTexture* S2DGraphics::LoadTextureRaw(const char* fileName)
+{
+    return LoadCachedTexture(fileName);
+}
+
+int S2DGraphics::LoadTexture(const char* fileName)
+{
+    S2DTexture* t = LoadCachedTexture(fileName);
+
+    return t ? t->textureID : -1;
 }
 
 bool S2DGraphics::UnloadTexture(S2DTexture* texture)
 {
-    auto tex = texture->GetSDLTexture();
-    if (tex)
-    {
-        SDL_DestroyTexture(tex);
-       
-        int index = 0;
-        std::vector<S2DTexture*>::iterator it = std::find(LoadedTextures.begin(), LoadedTextures.end(), texture);
+    if (!texture) return false;
 
-        delete texture;
+    // Loaded textures are owned by the registry and the texture cache
+    if (texture->textureID != S2D_INVALID_TEXTURE && Textures.IsValid(texture->textureID))
+        return UnloadTexture(texture->textureID);
 
-        if (it != LoadedTextures.end())
-            index = std::distance(LoadedTextures.begin(), it);
+    SyncRenderer();
 
-        LoadedTextures.erase(LoadedTextures.begin() + index);
-    }
+    DestroyTexture(texture);
 
-    return false;
+    return true;
 }
 
 bool S2DGraphics::UnloadTexture(int textureID)
 {
-    auto tex = LoadedTextures[textureID]->GetSDLTexture();
-    if (tex)
+    S2DTexture* tex = Textures.Get(textureID);
+    if (!tex) return false;
+
+    // Atlas pages are unloaded together with their last sub-texture
+    if (tex->subTextures > 0) return false;
+
+    // Other references to the texture are still alive
+    if (!TextureCache.Release(tex) && TextureCache.GetReferences(tex) > 0) return true;
+
+    SyncRenderer();
+
+    // The pending load is found by the handle, cancel it before the handle goes stale
+    CancelTextureLoad(tex);
+
+    Textures.Remove(textureID);
+
+    DestroyTexture(tex);
+
+    return true;
+}
+
+void S2DGraphics::DestroyTexture(S2DTexture* tex)
+{
+    CancelTextureLoad(tex);
+
+    if (tex->page)
+    {
+        // The atlas page goes away with its last sub-texture
+        if (--tex->page->subTextures == 0)
+        {
+            Textures.Remove(tex->page->textureID);
+            DestroyTexture(tex->page);
+        }
+    }
+    else
     {
-        SDL_DestroyTexture(LoadedTextures[textureID]->GetSDLTexture());
-        delete LoadedTextures[textureID];
-        LoadedTextures.erase(LoadedTextures.begin() + textureID);
+        SDL_DestroyTexture(tex->nativeTexture);
     }
 
-    return false;
+    if (tex->pixels) SDL_FreeSurface(tex->pixels);
+
+    delete tex;
 }
 
 std::map<int, const char*> S2DGraphics::GetReloadTextures()
 {
     std::map<int, const char*> reloadTexs;
 
-    for (auto tex : LoadedTextures)
+    Textures.ForEach([&](S2DTexture* tex)
     {
-        OutputDebugStringA(("Reloading texture: " + std::string(tex->GetPath()) + "\n").c_str());
-
         reloadTexs.insert(std::pair<int, const char*>(tex->textureID, tex->GetPath()));
-        SDL_DestroyTexture(tex->GetSDLTexture());
-        delete tex;
-        std::vector<S2DTexture*>::iterator position = std::find(LoadedTextures.begin(), LoadedTextures.end(), tex);
-        if (position != LoadedTextures.end())
-            LoadedTextures.erase(position);
-    }
+    });
 
     return reloadTexs;
 }
 
 void S2DGraphics::ClearTextures()
 {
-    for (auto tex : LoadedTextures)
+    SyncRenderer();
+
+    // Sub-textures go first, their atlas pages are destroyed with the last one of them
+    Textures.ForEach([&](S2DTexture* tex)
     {
-        SDL_DestroyTexture(tex->GetSDLTexture());
-        delete tex;
-        std::vector<S2DTexture*>::iterator position = std::find(LoadedTextures.begin(), LoadedTextures.end(), tex);
-        if (position != LoadedTextures.end())
-            LoadedTextures.erase(position);
-    }
+        if (!tex->page) return;
+
+        Textures.Remove(tex->textureID);
+        DestroyTexture(tex);
+    });
+
+    Textures.ForEach([&](S2DTexture* tex)
+    {
+        DestroyTexture(tex);
+    });
+
+    Textures.Clear();
+    TextureCache.Clear();
 }
 
 void S2DGraphics::RenderTexture(S2DCamera* cam, int textureID, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color)
 {
-    auto tex = LoadedTextures[textureID];
-    if (!tex->GetSDLTexture()) return;
+    const S2DTextureInfo* tex = Textures.GetInfo(textureID);
+    if (!tex || !tex->texture) return;
 
-    Vec2 pixPos = Vec2();
-    Vec2 camPixPos = Vec2();
+    SetDrawCamera(cam);
 
-    Vec2Int scrSize = GetCurrentWindowSize();
-    pixPos.x = (pos.x / 16.0f) * scrSize.x;
-    pixPos.y = (pos.y / 16.0f) * scrSize.y;
+    if (!IsOnScreen(cam, pos, size, angle)) return;
 
-    camPixPos.x = (cam->Position.x / 16.0f) * scrSize.x;
-    camPixPos.y = (cam->Position.y / 16.0f) * scrSize.y;
+    SDL_FRect rect = GetScreenRect(cam, pos, center, size, angle);
 
-    SDL_FRect rect = { pixPos.x - (size.x * center.x) - camPixPos.x + (scrSize.x / 2), pixPos.y - (size.y * center.y) + camPixPos.y + (scrSize.y / 2), size.x, size.y };
+    DrawTextureRegion(*tex, NULL, rect, angle, flip, color);
+}
+
+void S2DGraphics::RenderTexture(S2DCamera* cam, S2DTexture* tex, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color)
+{
+    if (!tex->GetSDLTexture()) return;
+
+    SetDrawCamera(cam);
 
-    Vec2 dist = Vec2::DistanceVec(pixPos, camPixPos);
+    if (!IsOnScreen(cam, pos, size, angle)) return;
 
-    if (dist.x > ((scrSize.x / 2) + size.x) || dist.y > ((scrSize.y / 2) + size.y)) return;
+    SDL_FRect rect = GetScreenRect(cam, pos, center, size, angle);
 
-    SDL_SetTextureColorMod(tex->GetSDLTexture(), color.r, color.g, color.b);
+    const S2DTextureInfo* info = Textures.IsValid(tex->textureID) ? Textures.GetInfo(tex->textureID) : nullptr;
 
-    SDL_RenderCopyExF(NativeRenderer, tex->GetSDLTexture(), NULL, &rect, angle, NULL, (SDL_RendererFlip)flip);
+    DrawTextureRegion(info ? *info : tex->GetInfo(), NULL, rect, angle, flip, color);
 }
 
-void S2DGraphics::RenderTexture(S2DCamera* cam, S2DTexture* tex, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color)
+void S2DGraphics::DrawTextureRegion(const S2DTextureInfo& info, const SDL_Rect* frame, const SDL_FRect& dst, float angle, TexFlipMode flip, Color color, S2DDrawList* list)
 {
-    if (!tex->GetSDLTexture()) return;
+    auto draw = [&](const SDL_Rect* src, const SDL_FRect& target, const SDL_FPoint* pivot)
+    {
+        if (list)
+            list->Draw(info.texture, src, target, angle, pivot, flip, color);
+        else
+            SpriteBatch.Draw(info.texture, src, target, angle, pivot, flip, color);
+    };
+
+    // Textures that are still loading draw the whole placeholder
+    if (info.texture == PlaceholderTexture)
+    {
+        draw(NULL, dst, NULL);
+        return;
+    }
+
+    // Part of the untrimmed image to draw and the part of it that has stored pixels
+    SDL_Rect part = frame ? *frame : SDL_Rect{ 0, 0, info.width, info.height };
+    SDL_Rect stored = { info.trimX, info.trimY, info.region.w, info.region.h };
+    SDL_Rect visible;
 
-    Vec2 pixPos = Vec2();
-    Vec2 camPixPos = Vec2();
+    if (part.w <= 0 || part.h <= 0 || !SDL_IntersectRect(&part, &stored, &visible)) return;
 
-    Vec2Int scrSize = GetCurrentWindowSize();
-    pixPos.x = (pos.x / 16.0f) * scrSize.x;
-    pixPos.y = (pos.y / 16.0f) * scrSize.y;
+    SDL_Rect src = { visible.x - info.trimX + info.region.x, visible.y - info.trimY + info.region.y, visible.w, visible.h };
 
-    camPixPos.x = (cam->Position.x / 16.0f) * scrSize.x;
-    camPixPos.y = (cam->Position.y / 16.0f) * scrSize.y;
+    // Whole textures and untrimmed frames map straight onto the destination
+    if (visible.w == part.w && visible.h == part.h)
+    {
+        draw(&src, dst, NULL);
+        return;
+    }
 
-    SDL_FRect rect = { pixPos.x - (size.x * center.x) - camPixPos.x + (scrSize.x / 2), pixPos.y - (size.y * center.y) + camPixPos.y + (scrSize.y / 2), size.x, size.y };
+    // Shrink the destination by the trimmed borders (mirrored when flipped)
+    float scaleX = dst.w / part.w;
+    float scaleY = dst.h / part.h;
 
-    Vec2 dist = Vec2::DistanceVec(pixPos, camPixPos);
+    float left = (visible.x - part.x) * scaleX;
+    float top = (visible.y - part.y) * scaleY;
+    float right = (part.x + part.w - visible.x - visible.w) * scaleX;
+    float bottom = (part.y + part.h - visible.y - visible.h) * scaleY;
 
-    if (dist.x > ((scrSize.x / 2) + size.x) || dist.y > ((scrSize.y / 2) + size.y)) return;
+    if ((int)flip & SDL_FLIP_HORIZONTAL) std::swap(left, right);
+    if ((int)flip & SDL_FLIP_VERTICAL) std::swap(top, bottom);
 
-    SDL_SetTextureColorMod(tex->GetSDLTexture(), color.r, color.g, color.b);
+    SDL_FRect target = { dst.x + left, dst.y + top, visible.w * scaleX, visible.h * scaleY };
 
-    SDL_RenderCopyExF(NativeRenderer, tex->GetSDLTexture(), NULL, &rect, angle, NULL, (SDL_RendererFlip)flip);
+    // Keep rotating around the center of the untrimmed rectangle
+    SDL_FPoint pivot = { dst.x + dst.w * 0.5f - target.x, dst.y + dst.h * 0.5f - target.y };
+
+    draw(&src, target, &pivot);
+}
+
+void S2DGraphics::FlushBatch()
+{
+    SyncRenderer();
+    SDL_RenderFlush(NativeRenderer);
 }
 
 void S2DGraphics::BeginFrame()
 {
+    S2DProfileZone("BeginFrame");
+
+    SpriteBatch.Flush();
+    SpriteBatch.BeginStats();
+
+    FrameNumber++;
+
+    // The window size can't change until the frame is presented
+    FrameSize = QueryWindowSize();
+    InFrame = true;
+
+    // Clear the whole window, the cameras clip to their viewports again
+    if (Clipping)
+    {
+        SetRendererClip(NULL);
+        Clipping = false;
+    }
+
+    // Forget the cameras that weren't used in the last frame
+    VisibleCache.erase(std::remove_if(VisibleCache.begin(), VisibleCache.end(), [&](const VisibleObjects& visible) { return visible.frame + 1 < FrameNumber; }), VisibleCache.end());
+
+    UploadDecodedTextures();
+
+    if (SpriteBatch.GetRecording())
+    {
+        SpriteBatch.GetRecording()->ClearTarget(Color(0, 0, 0, 255));
+        return;
+    }
+
     SDL_SetRenderDrawColor(NativeRenderer, 0, 0, 0, 255);
     SDL_RenderClear(NativeRenderer);
 }
 
 void S2DGraphics::EndFrame()
 {
+    S2DProfileZone("EndFrame");
+
+    // Draw what was queued and not submitted yet
+    SubmitDrawLists();
+
+    SpriteBatch.Flush();
+    SpriteBatch.EndStats();
+
+    InFrame = false;
+
+    if (RenderThread)
+    {
+        FinishRecordedFrame();
+        return;
+    }
+
+    S2DProfileZone("Present");
     SDL_RenderPresent(NativeRenderer);
 }
 
@@ -502,7 +788,9 @@ S2DGraphics::S2DGraphics(EngineInitSettings* settings)
 {
     auto flags = 0;
 
-    if (settings->fullscreen)
+    Headless = settings->headless;
+
+    if (settings->fullscreen && !Headless)
     {
         flags = SDL_WINDOW_FULLSCREEN_DESKTOP;
         Fullscreen = true;
@@ -512,7 +800,10 @@ S2DGraphics::S2DGraphics(EngineInitSettings* settings)
         Fullscreen = false;
     }
 
-    flags |= SDL_WINDOW_OPENGL;
+    if (Headless)
+        flags |= SDL_WINDOW_HIDDEN;
+    else
+        flags |= SDL_WINDOW_OPENGL;
 
     CurrentResolution = *settings->resolution;
     CurrentScreen = settings->screenNum;
@@ -523,20 +814,67 @@ S2DGraphics::S2DGraphics(EngineInitSettings* settings)
     if (!EngineWindow) // If the window wasn't created
         S2DFatalErrorFormatted("Cannot create window!\n%s", SDL_GetError());
 
-    // Create an SDL Renderer using DX9
-    NativeRenderer = SDL_CreateRenderer(EngineWindow, 0, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    // Let SDL merge the draw calls of the sprite batch into bigger vertex buffer uploads
+    SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+
+    if (Headless)
+    {
+        // Render into an offscreen surface using the software renderer
+        OffscreenSurface = SDL_CreateRGBSurfaceWithFormat(0, settings->resolution->width, settings->resolution->height, 32, SDL_PIXELFORMAT_ARGB8888);
+
+        if (!OffscreenSurface) // If the offscreen target wasn't created
+            S2DFatalErrorFormatted("Cannot create offscreen surface!\n%s", SDL_GetError());
+
+        NativeRenderer = SDL_CreateSoftwareRenderer(OffscreenSurface);
+    }
+    else
+    {
+        // Create an SDL Renderer using DX9
+        NativeRenderer = SDL_CreateRenderer(EngineWindow, 0, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    }
 
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "2");
     
     if (!NativeRenderer) // If the Renderer creation failed
         S2DFatalErrorFormatted("Cannot create renderer!\n%s", SDL_GetError());
 
+    SpriteBatch.SetRenderer(NativeRenderer);
+
+    CreatePlaceholderTexture();
+
+    Fonts::TextBatch = &SpriteBatch;
+    Fonts::WaitRenderer = [this]() { WaitRenderThread(); };
+
+    if (settings->renderThread) SetRenderThread(true);
+
     Running = true;
 }
 
 S2DGraphics::~S2DGraphics()
 {
+    // The frames still recorded are drawn before anything gets destroyed
+    SetRenderThread(false);
+
+    if (Fonts::TextBatch == &SpriteBatch)
+    {
+        Fonts::TextBatch = nullptr;
+        Fonts::WaitRenderer = nullptr;
+    }
+
+    ShutdownTextureLoader();
+    SDL_DestroyTexture(PlaceholderTexture);
+
+    for (auto list : DrawLists)
+        delete list;
+
+    if (OwnsJobSystem) delete JobSystem;
+
+    SpriteBatch.SetRenderer(nullptr);
+    Fonts::ResetGlyphAtlases();
+
     // Free up the resources - Destroy the renderer and window
     SDL_DestroyRenderer(NativeRenderer);
     SDL_DestroyWindow(EngineWindow);
+
+    if (OffscreenSurface) SDL_FreeSurface(OffscreenSurface);
 }
\ No newline at end of file
@@ -24,7 +24,14 @@
 
     #include "EngineVersion.h"
     #include "EngineIncludes/S2D_Misc.h"
+    #include "EngineIncludes/S2D_Profiler.h"
+    #include "EngineIncludes/S2D_Assets.h"
+    #include "EngineIncludes/S2D_FileSystem.h"
     #include "EngineIncludes/S2D_Graphics.h"
+    #include "EngineIncludes/S2D_Jobs.h"
+    #include "EngineIncludes/S2D_FrameGraph.h"
+    #include "EngineIncludes/S2D_Tilemap.h"
+    #include "EngineIncludes/S2D_Particles.h"
     #include "EngineIncludes/S2D_Input.h"
     #include <box2d/box2d.h>
 
@@ -41,6 +48,22 @@ namespace Physics
     extern b2World* b2PhysWorld;
 }
 
+namespace Fonts
+{
+    extern std::vector<S2DFont*> LoadedFonts;
+
+    extern S2DSpriteBatch* TextBatch;
+    extern std::function<void()> WaitRenderer;
+
+    extern void ResetGlyphAtlases();
+}
+
+namespace Assets
+{
+    // Loads an image through the filesystem
+    extern SDL_Surface* LoadImageSurface(const char* path);
+}
+
 namespace Input
 {
     extern void ProcessKey(SDL_Scancode key, bool state);
@@ -0,0 +1,209 @@
+/************************************************************\
+      _____ ___  _____    ______             _
+     / ____|__ \|  __ \  |  ____|           (_)
+    | (___    ) | |  | | | |__   _ __   __ _ _ _ __   ___
+     \___ \  / /| |  | | |  __| | '_ \ / _` | | '_ \ / _ \
+     ____) |/ /_| |__| | | |____| | | | (_| | | | | |  __/
+    |_____/|____|_____/  |______|_| |_|\__, |_|_| |_|\___|
+                                        __/ |
+                                       |___/
+    ======================================================
+        S2D Engine - An Open-Source 2D Game Framework
+                    Coded by Sevenisko
+
+    Purpose: Cooked asset formats and the tools to create them
+\************************************************************/
+
+#ifndef S2D_ASSETS_INCLUDED
+#define S2D_ASSETS_INCLUDED
+
+#include <SDL.h>
+#include <vector>
+#include <string>
+
+#if defined(S2D_MAIN_INCLUDED) && defined(_WIN32)
+#define DllExport __declspec(dllexport)
+#else
+#define DllExport
+#endif // S2D_MAIN_INCLUDED
+
+// File extension of cooked textures (LoadTexture loads them transparently)
+#define S2D_COOKED_TEXTURE_EXT ".s2dtex"
+
+#define S2D_COOKED_TEXTURE_MAGIC 0x54443253 // "S2DT"
+#define S2D_COOKED_TEXTURE_VERSION 1
+
+// Flags of an cooked texture
+#define S2D_COOKED_PREMULTIPLIED 0x0001 // Colors are multiplied by the alpha
+#define S2D_COOKED_LZ4 0x0002           // Pixels are compressed as a single LZ4 block
+
+// Header at the beginning of an cooked texture file, the pixels follow right after it
+struct S2DCookedTextureHeader
+{
+    Uint32 magic;
+    Uint16 version;
+    Uint16 flags;
+    Uint32 format;                      // SDL pixel format of the stored pixels
+    Sint32 width, height;               // Size of the whole (untrimmed) image
+    Sint32 trimX, trimY;                // Position of the stored pixels inside the untrimmed image
+    Sint32 storedWidth, storedHeight;   // Size of the stored pixels
+    Uint32 rawSize;                     // Size of the stored pixels in bytes (rows are tightly packed)
+    Uint32 dataSize;                    // Size of the pixel data in the file
+};
+
+// Settings of the texture cooker
+struct S2DCookSettings
+{
+    bool premultiply = true;    // Multiply the colors by the alpha (drawn with an premultiplied blend mode)
+    bool compress = true;       // Compress the pixels with LZ4 (only when it makes them smaller)
+    bool trim = false;          // Cut off the fully transparent borders of the image
+};
+
+// LZ4 block compression (compatible with the reference LZ4 block format)
+class DllExport S2DCompression
+{
+public:
+    // Get the max. size of the compressed data
+    static int Bound(int sourceSize);
+
+    // Compresses the data, returns the compressed size (0 when it doesn't fit into the destination)
+    static int Compress(const void* source, int sourceSize, void* dest, int destCapacity);
+
+    // Decompresses the data, returns the decompressed size (-1 when the data is corrupted or doesn't fit)
+    static int Decompress(const void* source, int sourceSize, void* dest, int destCapacity);
+};
+
+// Creates and reads cooked textures
+class DllExport S2DCookedTexture
+{
+public:
+    // Is the path an cooked texture (checks the extension)
+    static bool IsCookedPath(const char* path);
+
+    // Decodes an image file (PNG, JPG...) into the native texture format, like the regular texture loading does
+    static SDL_Surface* DecodeImage(const char* path);
+
+    // Converts an surface into cooked texture data
+    static bool Cook(SDL_Surface* surface, std::vector<Uint8>& output, const S2DCookSettings& settings = S2DCookSettings());
+
+    // Cooks an image file into an cooked texture file
+    static bool CookFile(const char* input, const char* output, const S2DCookSettings& settings = S2DCookSettings());
+
+    // Reads an cooked texture file into a surface holding the stored pixels as they are (no conversion)
+    static SDL_Surface* Load(const char* path, S2DCookedTextureHeader* header);
+
+    // Reads an cooked texture from a stream (the stream isn't closed)
+    static SDL_Surface* Load(SDL_RWops* rw, S2DCookedTextureHeader* header);
+};
+
+// File extension of asset packs
+#define S2D_PACK_EXT ".s2dpak"
+
+#define S2D_PACK_MAGIC 0x50443253 // "S2DP"
+#define S2D_PACK_VERSION 1
+
+// Flags of an pack entry
+#define S2D_PACK_LZ4 0x0001 // Data is compressed as a single LZ4 block
+
+// Header at the beginning of an pack file
+// (the entry data follows it, then the index and the null-terminated entry paths)
+struct S2DPackHeader
+{
+    Uint32 magic;
+    Uint16 version;
+    Uint16 flags;
+    Uint32 entryCount;
+    Uint32 alignment;   // Alignment of the entry data in the file
+    Uint64 indexOffset; // Array of S2DPackEntry sorted by hash
+    Uint64 namesOffset;
+    Uint64 namesSize;
+};
+
+// Index entry of an pack
+struct S2DPackEntry
+{
+    Uint64 hash;        // Hash of the normalized path
+    Uint64 offset;      // Position of the data in the file
+    Uint64 size;        // Size of the stored data
+    Uint64 rawSize;     // Size of the data once decompressed
+    Uint32 nameOffset;  // Position of the path in the names block
+    Uint32 flags;
+};
+
+// Read-only archive of assets mapped into memory
+class DllExport S2DPack
+{
+public:
+    // Opens an pack file (NULL when it can't be opened or isn't a valid pack)
+    static S2DPack* Open(const char* path);
+
+    ~S2DPack();
+
+    // Normalizes a path inside an pack (separators, "." and ".." parts, lower case)
+    static std::string NormalizePath(const char* path);
+
+    // Get the hash of a normalized path
+    static Uint64 HashPath(const std::string& path);
+
+    // Does the pack contain the path
+    bool Contains(const char* path) { return FindEntry(path) != nullptr; }
+
+    // Opens an entry as a stream (NULL when it's missing), uncompressed entries are read straight
+    // from the mapped file, so the stream can't be used after the pack is closed (or unmounted)
+    SDL_RWops* OpenEntry(const char* path);
+
+    // Get the number of entries
+    int GetEntryCount() { return (int)Header->entryCount; }
+
+    // Get the path of an entry
+    const char* GetEntryPath(int index) { return Names + Entries[index].nameOffset; }
+
+    // Get the path of the pack file
+    const char* GetPath() { return FilePath.c_str(); }
+
+private:
+    S2DPack() {}
+
+    const S2DPackEntry* FindEntry(const char* path);
+
+    std::string FilePath;
+
+    const Uint8* Data = nullptr;
+    Uint64 Size = 0;
+
+    const S2DPackHeader* Header = nullptr;
+    const S2DPackEntry* Entries = nullptr;
+    const char* Names = nullptr;
+
+    // Native file and mapping handles
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+};
+
+// Builds pack files
+class DllExport S2DPackWriter
+{
+public:
+    // Adds an file from disk under a path inside the pack
+    bool AddFile(const char* packPath, const char* filePath);
+
+    // Adds data from memory under a path inside the pack
+    void AddData(const char* packPath, const void* data, size_t size);
+
+    // Get the number of added entries
+    int GetEntryCount() { return (int)Items.size(); }
+
+    // Writes the pack file, entries are compressed with LZ4 when it makes them smaller
+    bool Write(const char* path, bool compress = false, Uint32 alignment = 16);
+
+private:
+    struct Item
+    {
+        std::string path;
+        std::vector<Uint8> data;
+    };
+
+    std::vector<Item> Items;
+};
+
+#endif // !S2D_ASSETS_INCLUDED
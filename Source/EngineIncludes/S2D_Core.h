@@ -17,7 +17,11 @@
 #ifndef S2D_CORE_INCLUDED
 #define S2D_CORE_INCLUDED
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif // _WIN32
+
+class S2DFrameGraph;
 
 struct VersionInfo
 {
@@ -32,6 +36,64 @@ struct GameSplashScreen
     int time;
 };
 
+// Number of buckets of the hitch histogram
+#define S2D_HITCH_BUCKETS 6
+
+// Statistics of a single measured duration (in milliseconds)
+struct S2DTimingStats
+{
+    float mean = 0, min = 0, max = 0;
+    float p50 = 0, p95 = 0, p99 = 0;
+};
+
+// Frame statistics computed over the rolling window of the last frames
+struct S2DFrameStats
+{
+    // Number of frames in the window
+    int frames = 0;
+
+    // Whole frame (time between two frames), update (OnFixedUpdate + OnUpdate) and render (BeginFrame - EndFrame) durations
+    S2DTimingStats frame, update, render;
+
+    float averageFps = 0;
+    // Average framerate of the slowest 1% of the frames
+    float onePercentLowFps = 0;
+
+    // Number of frames taking up to hitchLimits[i] milliseconds (the last bucket counts everything above the previous limit)
+    int hitches[S2D_HITCH_BUCKETS] = {};
+    float hitchLimits[S2D_HITCH_BUCKETS] = {};
+};
+
+// Rolling window of frame timings
+class DllExport S2DFrameHistory
+{
+public:
+    // Set the number of frames kept in the window (clears the history)
+    void SetSize(int frames);
+    int GetSize() { return Size; }
+
+    // Adds the durations of a frame (in milliseconds)
+    void Add(float frameMs, float updateMs, float renderMs);
+
+    // Clears the history
+    void Reset();
+
+    // Computes the statistics over the frames in the window
+    S2DFrameStats Compute();
+
+    S2DFrameHistory() { SetSize(1024); }
+
+private:
+    void ComputeTiming(const std::vector<float>& samples, S2DTimingStats& stats);
+
+    std::vector<float> FrameTimes, UpdateTimes, RenderTimes;
+    std::vector<float> Sorted;
+
+    int Size = 0;
+    int Head = 0;
+    int Count = 0;
+};
+
 // Default Engine Settings
 extern EngineInitSettings* defaultSettings;
 
@@ -42,12 +104,40 @@ public:
     S2DGraphics* Graphics;
     //S2DPhysics* Physics;
 
+    // Job system shared by the engine and the game (created in Run)
+    S2DJobSystem* Jobs = nullptr;
+
+    // Systems run every frame after OnUpdate, ordered by the resources they read and write (created in Run, add them in OnInit)
+    S2DFrameGraph* FrameGraph = nullptr;
+
     float GetDeltaTime();
 
     float GetFrameRate();
 
     float GetFrameTime();
 
+    // Get the statistics of the last frames (see SetFrameStatsWindow)
+    S2DFrameStats GetFrameStats() { return FrameHistory.Compute(); }
+
+    // Set the number of frames the statistics are computed from (1024 by default)
+    void SetFrameStatsWindow(int frames) { FrameHistory.SetSize(frames); }
+
+    // Clears the collected frame statistics
+    void ResetFrameStats() { FrameHistory.Reset(); }
+
+    // Enable/Disable the fixed time step (OnFixedUpdate is called updatesPerSecond times per second)
+    void SetFixedTimeStep(bool state, float updatesPerSecond = 60.0f);
+    bool GetFixedTimeStep() { return FixedTimeStep; }
+
+    // Get the time between two fixed updates (in seconds)
+    float GetFixedDeltaTime() { return FixedDeltatime; }
+
+    // Set the max. number of fixed updates per frame (the rest of the time is dropped when the game can't keep up)
+    void SetMaxFixedSteps(int steps) { MaxFixedSteps = steps > 0 ? steps : 1; }
+
+    // Get the progress between the last and the next fixed update (0-1), use it to interpolate in OnRender
+    float GetInterpolationAlpha() { return InterpolationAlpha; }
+
     VersionInfo GetEngineVersion();
     const char* GetBuildDate();
     const char* GetBuildTime();
@@ -67,9 +157,12 @@ public:
     // This function is called when focus is lost
     virtual void OnFocusLost() {}
 
-    // This function is called every frame and updates the game logic
+    // This function is called every frame and updates the game logic (before the systems of the frame graph)
     virtual void OnUpdate() {}
 
+    // This function is called at a fixed rate when the fixed time step is enabled (zero or more times per frame)
+    virtual void OnFixedUpdate() {}
+
     // This function is called every frame and draws things into the buffer
     virtual void OnRender() {}
 
@@ -91,7 +184,9 @@ public:
     Vec2 Gravity = Vec2(0, -10.0f);
 
 private:
-    HANDLE MutexHandle;
+#ifdef _WIN32
+    HANDLE MutexHandle = NULL;
+#endif // _WIN32
 
     EngineInitSettings* CurrentSettings;
 
@@ -100,6 +195,14 @@ private:
     void HandleEvents(SDL_Event& e);
 
     float Framerate, Frametime, Deltatime;
+
+    bool FixedTimeStep = false;
+    float FixedDeltatime = 1.0f / 60.0f;
+    float FixedAccumulator = 0.0f;
+    float InterpolationAlpha = 0.0f;
+    int MaxFixedSteps = 5;
+
+    S2DFrameHistory FrameHistory;
 };
 
 #endif // !S2D_CORE_INCLUDED
@@ -0,0 +1,99 @@
+/************************************************************\
+      _____ ___  _____    ______             _
+     / ____|__ \|  __ \  |  ____|           (_)
+    | (___    ) | |  | | | |__   _ __   __ _ _ _ __   ___
+     \___ \  / /| |  | | |  __| | '_ \ / _` | | '_ \ / _ \
+     ____) |/ /_| |__| | | |____| | | | (_| | | | | |  __/
+    |_____/|____|_____/  |______|_| |_|\__, |_|_| |_|\___|
+                                        __/ |
+                                       |___/
+    ======================================================
+        S2D Engine - An Open-Source 2D Game Framework
+                    Coded by Sevenisko
+
+    Purpose: Virtual filesystem shared by all the asset loaders
+\************************************************************/
+
+#ifndef S2D_FILESYSTEM_INCLUDED
+#define S2D_FILESYSTEM_INCLUDED
+
+#include <SDL.h>
+#include <vector>
+#include <string>
+
+#if defined(S2D_MAIN_INCLUDED) && defined(_WIN32)
+#define DllExport __declspec(dllexport)
+#else
+#define DllExport
+#endif // S2D_MAIN_INCLUDED
+
+enum class MountType
+{
+    Directory,  // Files of a directory on disk
+    Pack,       // Entries of an asset pack
+    Memory      // A single file in memory
+};
+
+// I/O counters of a mount
+struct S2DFileStats
+{
+    Uint64 opens = 0;       // Number of opened files
+    Uint64 bytesRead = 0;   // Number of bytes read from them
+    float openMs = 0.0f;    // Time spent opening them
+    float readMs = 0.0f;    // Time spent reading them
+};
+
+// Description of a mount
+struct S2DMountInfo
+{
+    int id = 0;
+    MountType type = MountType::Directory;
+    std::string source;         // Directory, pack file or the path of the memory file
+    std::string mountPoint;     // Virtual directory the files appear in
+    int files = 0;
+    S2DFileStats stats;
+};
+
+// Virtual filesystem used by all the asset loaders, paths are looked up in the mounts (later mounts override earlier ones)
+// and the files that aren't mounted are opened from disk
+class DllExport S2DFileSystem
+{
+public:
+    // Mounts the files of a directory (they're indexed right away, call Rescan after adding files), returns the mountID or -1
+    static int MountDirectory(const char* directory, const char* mountPoint = "");
+
+    // Mounts the entries of an pack file, returns the mountID or -1
+    static int MountPack(const char* path, const char* mountPoint = "");
+
+    // Mounts a block of memory as a file (the data has to stay valid while it's mounted), returns the mountID or -1
+    static int MountMemory(const char* path, const void* data, size_t size);
+
+    // Unmounts a mount (files opened from it can't be used anymore)
+    static bool Unmount(int mountID);
+
+    // Unmounts everything
+    static void UnmountAll();
+
+    // Indexes the files of the mounted directories again
+    static void Rescan();
+
+    // Does the file exist in the mounts or on disk
+    static bool Exists(const char* path);
+
+    // Opens a file for reading from the mounts or from disk (NULL when it doesn't exist)
+    static SDL_RWops* Open(const char* path);
+
+    // Get all the mounts in their search order (the last one is searched first)
+    static std::vector<S2DMountInfo> GetMounts();
+
+    // Get the I/O counters of the files opened straight from disk
+    static S2DFileStats GetDiskStats();
+
+    // Resets the I/O counters of all the mounts
+    static void ResetStats();
+
+    // Writes the I/O counters of all the mounts into the debug output
+    static void DumpStats();
+};
+
+#endif // !S2D_FILESYSTEM_INCLUDED
@@ -0,0 +1,127 @@
+/************************************************************\
+      _____ ___  _____    ______             _
+     / ____|__ \|  __ \  |  ____|           (_)
+    | (___    ) | |  | | | |__   _ __   __ _ _ _ __   ___
+     \___ \  / /| |  | | |  __| | '_ \ / _` | | '_ \ / _ \
+     ____) |/ /_| |__| | | |____| | | | (_| | | | | |  __/
+    |_____/|____|_____/  |______|_| |_|\__, |_|_| |_|\___|
+                                        __/ |
+                                       |___/
+    ======================================================
+        S2D Engine - An Open-Source 2D Game Framework
+                    Coded by Sevenisko
+
+    Purpose: Frame graph of systems ordered by the resources they use
+\************************************************************/
+
+#ifndef S2D_FRAMEGRAPH_INCLUDED
+#define S2D_FRAMEGRAPH_INCLUDED
+
+#include <SDL.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(S2D_MAIN_INCLUDED) && defined(_WIN32)
+#define DllExport __declspec(dllexport)
+#else
+#define DllExport
+#endif // S2D_MAIN_INCLUDED
+
+class S2DJobSystem;
+struct S2DFrameSystem;
+
+// Function of a system, called with the time since the last frame (in seconds)
+typedef std::function<void(float deltaTime)> S2DSystemFunction;
+
+// Timings of a single system (in milliseconds)
+struct S2DSystemStats
+{
+	std::string name;
+	float last = 0, average = 0, max = 0;
+	// Was the system on the critical path of the last frame
+	bool critical = false;
+};
+
+// Timings of the frame graph (in milliseconds)
+struct S2DFrameGraphStats
+{
+	// Number of frames the averages are computed from
+	int frames = 0;
+
+	// Time from the start of the graph to the end of its last system
+	float wall = 0, averageWall = 0;
+	// Longest chain of dependent systems, the graph can't run faster than this with any number of threads
+	float criticalPath = 0, averageCriticalPath = 0;
+	// Sum of the times of all the systems
+	float work = 0, averageWork = 0;
+
+	std::vector<S2DSystemStats> systems;
+};
+
+// Runs the systems of a frame in parallel, every system declares the resources it reads and writes
+// and runs after the earlier added systems that write what it uses or read what it writes
+class DllExport S2DFrameGraph
+{
+public:
+	S2DFrameGraph() {}
+	~S2DFrameGraph();
+
+	// Adds a system and returns its ID, resources are any names shared between the systems
+	// (main thread systems never run on the job workers, e.g. the ones using the renderer)
+	int AddSystem(const char* name, S2DSystemFunction function, const std::vector<std::string>& reads, const std::vector<std::string>& writes, bool mainThread = false);
+
+	// Enable/Disable a system (disabled systems are skipped, the systems after them still wait for their dependencies)
+	void SetSystemEnabled(int system, bool state);
+	bool IsSystemEnabled(int system);
+
+	// Get the number of systems
+	int GetSystemCount() { return (int)Systems.size(); }
+
+	// Get the systems the system waits for (their IDs)
+	std::vector<int> GetSystemDependencies(int system);
+
+	// Runs all the systems once, the calling thread runs the main thread systems and helps with the others
+	// (without a job system all the systems run on the calling thread in the order they were added)
+	void Run(S2DJobSystem* jobs, float deltaTime);
+
+	// Get the timings of the last frame and the averages since the last reset
+	S2DFrameGraphStats GetStats();
+
+	// Clears the collected timings
+	void ResetStats();
+
+private:
+	// Builds the dependency graph of the systems
+	void Build();
+
+	// Hands a system with all dependencies finished to a worker or the main thread
+	void Release(int system);
+
+	// Runs a system and releases the systems waiting for it
+	void RunSystem(int system);
+
+	// Adds the timings of the finished frame to the statistics
+	void UpdateStats(Uint64 start, Uint64 end);
+
+	std::vector<S2DFrameSystem*> Systems;
+	std::unordered_map<std::string, int> Resources;
+
+	bool Built = false;
+
+	// State of the running frame
+	S2DJobSystem* Jobs = nullptr;
+	float DeltaTime = 0.0f;
+	std::atomic<int> Remaining{ 0 };	// Systems that didn't finish yet
+	std::mutex MainLock;
+	std::vector<int> MainReady;
+
+	int Frames = 0;
+	float LastWall = 0, LastCriticalPath = 0, LastWork = 0;
+	double TotalWall = 0, TotalCriticalPath = 0, TotalWork = 0;
+};
+
+#endif // !S2D_FRAMEGRAPH_INCLUDED
@@ -18,11 +18,15 @@
 #define S2D_GFX_INCLUDED
 
 #include <SDL.h>
+#ifdef _WIN32
 #include <Windows.h>
+#endif // _WIN32
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <stdio.h>
+#include <math.h>
 #include <functional>
 
 struct Color
@@ -62,8 +66,6 @@ public:
 		float b3 = (1 - f) * b1 + f * b2;
 		float a3 = (1 - f) * a1 + f * a2;
 
-		OutputDebugStringA(("Color: {" + std::to_string(r3) + ", " + std::to_string(g3) + ", " + std::to_string(b3) + ", " + std::to_string(a3) + "}\n").c_str());
-
 		Uint8 r = (int)r3;
 		Uint8 g = (int)g3;
 		Uint8 b = (int)b3;
@@ -157,10 +159,10 @@ public:
 		return sqrtf((diffY * diffY) + (diffX * diffX));
 	}
 
-	Vec2 operator =(Vec2 a)
+	Vec2& operator =(Vec2 a)
 	{
-		this->x = a.y;
-		this->x = a.y;
+		this->x = a.x;
+		this->y = a.y;
 		return *this;
 	}
 
@@ -193,10 +195,10 @@ public:
 		return Vec2Int((int)x, (int)y);
 	}
 
-	Vec2Int operator =(Vec2Int a)
+	Vec2Int& operator =(Vec2Int a)
 	{
-		this->x = a.y;
-		this->x = a.y;
+		this->x = a.x;
+		this->y = a.y;
 		return *this;
 	}
 
@@ -228,6 +230,15 @@ struct EngineInitSettings
     int screenNum;
     ScreenResolution* resolution;
     bool fullscreen;
+    // Run without a visible window (dummy video/audio drivers and an offscreen software renderer)
+    bool headless = false;
+    // Number of frames to run in headless mode before quitting (0 = run until Quit is called)
+    int headlessFrames = 0;
+    // Draw on a separate render thread (OnRender records the draw calls, the render thread submits them while the next frame updates),
+    // ignored for renderers that can't be used from another thread (see S2DGraphics::SetRenderThread)
+    bool renderThread = false;
+    // Number of job worker threads (0 = one per CPU core besides the main thread)
+    int jobWorkers = 0;
 };
 
 #define S2DWorldPosToPixels(relX, relY, X, Y) Vec2Int scrSize = Graphics->GetCurrentWindowSize(); \
@@ -238,16 +249,76 @@ struct EngineInitSettings
 	relX = (float)(X / (scrSize.x - (scrSize.x / 2))) * 16.0f; \
 	relY = (float)(Y / (scrSize.y - (scrSize.y / 2))) * 16.0f; 
 	
-#ifdef S2D_MAIN_INCLUDED
+#if defined(S2D_MAIN_INCLUDED) && defined(_WIN32)
 #define DllExport __declspec(dllexport)
 #else
 #define DllExport
 #endif // S2D_MAIN_INCLUDED
 
+// 2D affine transform (x' = a * x + c * y + tx, y' = b * x + d * y + ty)
+struct DllExport S2DMatrix2D
+{
+	float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+	float tx = 0.0f, ty = 0.0f;
+
+	static S2DMatrix2D Translation(float x, float y);
+	// Rotation in degrees (clockwise on the screen, same as the sprite angles)
+	static S2DMatrix2D Rotation(float angle);
+	static S2DMatrix2D Scale(float x, float y);
+
+	// Combines the transforms, the right one is applied first
+	S2DMatrix2D operator*(const S2DMatrix2D& other) const;
+
+	// Get the inverse transform (identity when the matrix can't be inverted)
+	S2DMatrix2D Inverse() const;
+
+	SDL_FPoint Transform(SDL_FPoint point) const { return { a * point.x + c * point.y + tx, b * point.x + d * point.y + ty }; }
+
+	// Transforms an array of points (in and out can be the same array), four points at a time with SSE2/NEON
+	void TransformPoints(const SDL_FPoint* in, SDL_FPoint* out, int count) const;
+	// Transforms points stored as separate X and Y arrays
+	void TransformPoints(const float* x, const float* y, SDL_FPoint* out, int count) const;
+};
+
 class DllExport S2DCamera
 {
 public:
 	Vec2 Position;
+	float Zoom = 1.0f;									// Scale of the view (2 shows everything twice as big)
+	float Rotation = 0.0f;								// Rotation of the camera in degrees (the world turns the other way)
+	SDL_FRect Viewport = { 0.0f, 0.0f, 1.0f, 1.0f };	// Part of the window the camera draws into (relative to the window size)
+
+private:
+	friend class S2DGraphics;
+	friend class S2DDrawList;
+
+	// World to screen transform and the camera state it was computed from
+	S2DMatrix2D Matrix, InverseMatrix;
+	SDL_Rect ViewportRect = { 0, 0, 0, 0 };		// Viewport in pixels
+	float Scale = 1.0f;							// Zoom applied to the pixel sizes
+	float ScreenCos = 1.0f, ScreenSin = 0.0f;	// Rotation of the world on the screen
+
+	Vec2 MatrixPosition;
+	float MatrixZoom = 0.0f, MatrixRotation = 0.0f;
+	SDL_FRect MatrixViewport = { 0.0f, 0.0f, 0.0f, 0.0f };
+	Vec2Int MatrixScreen;
+	bool MatrixValid = false;
+};
+
+// Texture handles keep the slot index in the low bits and the slot generation in the high bits
+#define S2D_TEXTURE_INDEX_BITS 20
+#define S2D_TEXTURE_INDEX_MASK ((1 << S2D_TEXTURE_INDEX_BITS) - 1)
+#define S2D_TEXTURE_GENERATION_MASK 0x7FF
+#define S2D_INVALID_TEXTURE -1
+
+// Per-texture data used on the draw path
+struct S2DTextureInfo
+{
+	SDL_Texture* texture = nullptr;
+	int width = 0, height = 0;			// Size of the whole (untrimmed) image
+	SDL_Rect region = { 0, 0, 0, 0 };	// Stored pixels inside the SDL texture
+	int trimX = 0, trimY = 0;			// Position of the stored pixels inside the untrimmed image
+	int sortID = 0;						// Registry slot of the SDL texture (sub-textures share the one of their atlas page)
 };
 
 class DllExport S2DTexture
@@ -257,26 +328,213 @@ public:
     SDL_Texture* GetSDLTexture() { return nativeTexture; }
 	const char* GetPath() { return texPath; }
 
+	// Is this texture packed into an atlas page
+	bool IsSubTexture() { return page != nullptr; }
+
+	// Get the draw data of the texture
+	S2DTextureInfo GetInfo()
+	{
+		S2DTextureInfo info;
+		info.texture = nativeTexture;
+		info.width = width;
+		info.height = height;
+		info.region = region.w > 0 ? region : SDL_Rect{ 0, 0, width, height };
+		info.trimX = trimX;
+		info.trimY = trimY;
+		return info;
+	}
+
 	S2DTexture(SDL_Texture* tex, const char* path)
 	{
 		width = height = 0;
+		textureID = S2D_INVALID_TEXTURE;
 		texPath = path;
 		nativeTexture = tex;
 		SDL_QueryTexture(tex, NULL, NULL, &width, &height);
 	}
 private:
+	friend class S2DGraphics;
+	friend class S2DTextureRegistry;
+
 	const char* texPath;
     SDL_Texture* nativeTexture;
+	// Decoded pixels kept for re-uploading the texture after a device reset (can be NULL)
+	SDL_Surface* pixels = nullptr;
+	// The texture is being loaded asynchronously (a placeholder is drawn until then)
+	bool loading = false;
+
+	// The texture was loaded from an cooked texture file
+	bool cooked = false;
+	// The colors are multiplied by the alpha (drawn with the premultiplied blend mode)
+	bool premultiplied = false;
+
+	// Atlas page of a sub-texture
+	S2DTexture* page = nullptr;
+	// Number of sub-textures living in an atlas page
+	int subTextures = 0;
+	// Stored pixels of a sub-texture inside its page (or of a trimmed cooked texture)
+	SDL_Rect region = { 0, 0, 0, 0 };
+	// Position of the stored pixels inside the untrimmed image
+	int trimX = 0, trimY = 0;
+};
+
+// Settings of the texture atlas builder
+struct S2DAtlasSettings
+{
+	int pageSize = 2048;	// Width and height of the atlas pages
+	int padding = 1;		// Empty pixels between the packed images
+	bool trim = false;		// Cut off the fully transparent borders of the images
+};
+
+// Loading state of an texture
+enum class TextureState
+{
+	Invalid,	// The handle doesn't point to a loaded texture
+	Loading,	// The texture is being decoded or waits for the upload
+	Ready,		// The texture can be drawn
+	Failed		// The file couldn't be loaded
 };
 
+// Called on the main thread when an asynchronously loaded texture is ready (or failed to load)
+typedef std::function<void(int textureID, bool loaded)> S2DTextureCallback;
+
+struct S2DTextureLoader;
+struct S2DRenderThread;
+struct S2DTextureRequest;
+struct S2DCookedTextureHeader;
+
+// Slot map of the loaded textures, handles of unloaded textures never point to another texture
+class DllExport S2DTextureRegistry
+{
+public:
+	// Adds an texture and returns its handle (S2D_INVALID_TEXTURE when the registry is full)
+	int Add(S2DTexture* texture);
+
+	// Removes an texture from the registry (the texture itself is not destroyed)
+	bool Remove(int handle);
+
+	// Updates the draw data of an texture (e.g. after it was reloaded)
+	void Update(int handle);
+
+	// Is the handle pointing to a loaded texture
+	bool IsValid(int handle);
+
+	// Get an texture by its handle (NULL for stale handles)
+	S2DTexture* Get(int handle);
+
+	// Get the draw data of an texture by its handle (NULL for stale handles)
+	const S2DTextureInfo* GetInfo(int handle);
+
+	// Get the number of loaded textures
+	int GetCount() { return Count; }
+
+	// Calls the function for every loaded texture
+	template<typename Func>
+	void ForEach(Func func)
+	{
+		for (size_t i = 0; i < Objects.size(); i++)
+		{
+			if (Objects[i]) func(Objects[i]);
+		}
+	}
+
+	// Removes all the textures
+	void Clear();
+
+private:
+	// Get the slot index of an handle (-1 for stale handles)
+	int GetSlot(int handle);
+
+	std::vector<S2DTextureInfo> Infos;
+	std::vector<S2DTexture*> Objects;
+	std::vector<Uint16> Generations;
+	std::vector<int> FreeSlots;
+
+	int Count = 0;
+};
+
+// Texture cache statistics
+struct S2DTextureCacheStats
+{
+	int hits = 0;			// Loads served by an already loaded texture
+	int misses = 0;			// Loads that had to decode the file
+	int textures = 0;		// Number of cached textures
+	int references = 0;		// Number of references held to the cached textures
+};
+
+// Textures loaded from files, shared by their path and kept alive by reference counting
+class DllExport S2DTextureCache
+{
+public:
+	// Normalizes a file path (separators, "." and ".." parts, case on Windows)
+	static std::string NormalizePath(const char* path);
+
+	// Get a cached texture and add a reference to it (NULL when the texture isn't cached)
+	S2DTexture* Acquire(const std::string& path);
+
+	// Is an texture with this path cached (doesn't add a reference)
+	bool Contains(const std::string& path) { return Entries.find(path) != Entries.end(); }
+
+	// Adds a newly loaded texture with one reference, returns the interned path the texture should keep
+	const char* Insert(const std::string& path, S2DTexture* texture);
+
+	// Removes a reference, returns true when it was the last one and the texture was removed from the cache
+	bool Release(S2DTexture* texture);
+
+	// Get the number of references held to an texture
+	int GetReferences(S2DTexture* texture);
+
+	S2DTextureCacheStats GetStats();
+	void ResetStats() { Hits = Misses = 0; }
+
+	// Removes all the textures (the textures themselves are not destroyed)
+	void Clear();
+
+private:
+	struct Entry
+	{
+		S2DTexture* texture;
+		int references;
+	};
+
+	// The keys are never moved, so they are used as the interned texture paths
+	std::unordered_map<std::string, Entry> Entries;
+
+	int Hits = 0, Misses = 0, References = 0;
+};
+
+struct S2DGlyphAtlas;
+class S2DTilemap;
+class S2DParticleSystem;
+class S2DJobSystem;
+
+// Metrics of a measured text block
+struct S2DTextMetrics
+{
+	int width = 0, height = 0;	// Size of the whole text block
+	int lineHeight = 0;			// Distance between the tops of two lines
+	int ascent = 0;				// Distance from the top of a line to its baseline
+	int descent = 0;			// Distance from the baseline to the bottom of a line (negative)
+	int lines = 0;				// Number of lines
+};
+
+class S2DDrawList;
+
 class DllExport S2DFont
 {
 public:
 	Vec2Int GetSize(int size, const char* text);
 
+	// Measures an UTF-8 text without rasterizing it
+	S2DTextMetrics Measure(int size, const char* text);
+
+	// Fills the extents of each line (up to maxLines), returns the number of lines
+	int MeasureLines(int size, const char* text, Vec2Int* extents, int maxLines);
+
 	void UpdateRenderer(SDL_Renderer* renderer);
 
-	void Render(int size, const char* text, Vec2 pos, Vec2 center, float angle, TexFlipMode flip, Color color);
+	// Draws an text in screen coordinates (records its glyphs into the draw list instead when one is given)
+	void Render(int size, const char* text, Vec2 pos, Vec2 center, float angle, TexFlipMode flip, Color color, S2DDrawList* list = nullptr);
 
 	S2DTexture* RenderToTexture(int size, const char* text, Color color);
 
@@ -284,8 +542,19 @@ public:
 
 	S2DFont(SDL_Renderer* renderer, const char* path);
 private:
+	// Get the cached face (with its glyph atlas) for the pixel size
+	S2DGlyphAtlas* GetAtlas(int size);
+
 	std::string ttfFile;
 	SDL_Renderer* myRenderer;
+
+	// Faces looked up most recently, saves the lookup in the shared face cache
+	struct CachedFace
+	{
+		int size = 0;
+		S2DGlyphAtlas* atlas = nullptr;
+	} cachedFaces[4];
+	int nextCachedFace = 0;
 };
 
 class DllExport S2DSprite
@@ -296,6 +565,7 @@ public:
 	int GetCurFrame() { return curFrame; }
 	int GetFrameRate() { return framerate; }
 	std::vector<SDL_Rect> GetFrames() { return frames; }
+	const SDL_Rect& GetCurFrameRect() { return frames[curFrame]; }
 	void SetFrame(int frame);
 	void NextFrame();
 	void PrevFrame();
@@ -312,6 +582,411 @@ private:
     int framerate;
 };
 
+// Filled shape tessellated into triangles once, its points are in pixels around the position it's drawn at
+class DllExport S2DShape
+{
+public:
+	// Creates an filled circle (the number of segments is picked from the radius when zero)
+	static S2DShape Circle(float radius, int segments = 0);
+
+	// Creates an filled polygon (convex or concave, but the edges must not cross)
+	static S2DShape Polygon(const std::vector<Vec2>& points);
+
+	// Creates thick lines connecting the points
+	static S2DShape ThickLines(const std::vector<Vec2>& points, float thickness, bool closed);
+
+	const std::vector<SDL_FPoint>& GetPoints() { return Points; }
+	const std::vector<int>& GetIndices() { return Indices; }
+
+	// Get the distance of the farthest point from the origin
+	float GetRadius() { return Radius; }
+
+	S2DShape() {}
+
+private:
+	friend class S2DGraphics;
+
+	// Computes the radius from the points
+	void UpdateRadius();
+
+	std::vector<SDL_FPoint> Points;
+	std::vector<int> Indices;
+	float Radius = 0.0f;
+};
+
+// Vertex used by the sprite batch (same layout as SDL_Vertex)
+struct S2DVertex
+{
+	SDL_FPoint position;
+	SDL_Color color;
+	SDL_FPoint texCoord;
+};
+
+// Sprite batch statistics of a single frame
+struct S2DBatchStats
+{
+	int sprites = 0;
+	int primitives = 0;
+	int vertices = 0;
+	int drawCalls = 0;
+	int flushes = 0;
+	// The quads of a run go in a single draw call, false with SDL older than 2.0.18 (every sprite is then its own draw call)
+	bool geometry = false;
+};
+
+// Timings of the last renderer reset (fullscreen switch or device reset)
+struct S2DRendererResetStats
+{
+	float totalMs = 0;				// Duration of the whole reset
+	float uploadMs = 0;				// Time spent re-uploading the textures
+	int textures = 0;				// Number of re-uploaded textures
+	bool recreatedRenderer = false;	// The renderer couldn't be kept and had to be created again
+};
+
+// Kind of the geometry recorded by the sprite batch
+enum class S2DBatchPrimitive
+{
+	Quads,		// Textured quads or filled rectangles
+	Triangles,	// Filled triangles
+	Lines,		// Line segments
+	Points
+};
+
+class S2DRenderCommandBuffer;
+
+// Records textured quads and primitives and submits them grouped by texture and blend mode.
+// Merging the quads of a texture into one draw call needs SDL_RenderGeometry (SDL 2.0.18 and newer), with the bundled
+// SDL 2.0.12 every sprite is still copied with its own SDL_RenderCopyExF and only the untextured primitives get merged
+class DllExport S2DSpriteBatch
+{
+public:
+	// Records an textured quad (same parameters as SDL_RenderCopyExF), copied right away without SDL_RenderGeometry
+	void Draw(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, float angle, const SDL_FPoint* center, TexFlipMode flip, Color color);
+
+	// Records an filled rectangle
+	void FillRect(const SDL_FRect& rect, Color color);
+
+	// Records an line
+	void DrawLine(SDL_FPoint p1, SDL_FPoint p2, Color color);
+
+	// Records an single point
+	void DrawPoint(SDL_FPoint point, Color color);
+
+	// Records filled triangles (every three indices into the points make a triangle)
+	void FillTriangles(const SDL_FPoint* points, int pointCount, const int* indices, int indexCount, Color color);
+
+	// Reserves vertices for quads of a texture (NULL for filled quads), the caller writes four corners per quad
+	// in clockwise order and then records the quads actually written with CommitQuads
+	S2DVertex* ReserveQuads(SDL_Texture* texture, SDL_BlendMode blendMode, int count);
+	void CommitQuads(int count);
+
+	// Submits all recorded quads to the renderer (or moves them into the command buffer when recording)
+	void Flush();
+
+	// Moves the flushed quads into a command buffer instead of submitting them (NULL submits them again)
+	void SetRecording(S2DRenderCommandBuffer* buffer);
+	S2DRenderCommandBuffer* GetRecording() { return Recording; }
+
+	// Submits the commands of a buffer to the renderer (the buffer keeps them)
+	void Replay(S2DRenderCommandBuffer& buffer);
+
+	// Throws away all recorded quads without drawing them
+	void Clear();
+
+	void SetRenderer(SDL_Renderer* renderer);
+
+	// Enable/Disable batching (when disabled, every quad is submitted immediately)
+	void SetEnabled(bool state) { Flush(); Enabled = state; }
+	bool IsEnabled() { return Enabled; }
+
+	// Starts collecting statistics for a new frame
+	void BeginStats();
+	// Stores statistics of the finished frame
+	void EndStats();
+
+	S2DBatchStats GetStats() { return LastStats; }
+
+	// Get the blend mode of textures with premultiplied alpha (their vertex colors get premultiplied too)
+	static SDL_BlendMode GetPremultipliedBlendMode();
+
+	// Blend mode of the boxes, lines, points and shapes (the default draw blend mode of SDL they were always drawn with)
+	static const SDL_BlendMode PrimitiveBlendMode = SDL_BLENDMODE_NONE;
+
+	// Whether triangles are submitted in a single call (SDL_RenderGeometry needs SDL 2.0.18),
+	// otherwise untextured quads are filled in groups of the same color
+	static bool HasGeometry();
+
+	// Computes the four corners of an textured quad (same parameters as Draw, the size is of the whole texture)
+	static void BuildQuad(S2DVertex* vertices, int textureWidth, int textureHeight, SDL_BlendMode blendMode, const SDL_Rect* src, const SDL_FRect& dst, float angle, const SDL_FPoint* center, TexFlipMode flip, Color color);
+
+	S2DSpriteBatch() {}
+
+private:
+	friend class S2DRenderCommandBuffer;
+
+	struct BatchRun
+	{
+		SDL_Texture* texture;
+		SDL_BlendMode blendMode;
+		S2DBatchPrimitive primitive;
+		int textureWidth, textureHeight;
+		int firstVertex, vertexCount;
+		int firstIndex, indexCount;
+	};
+
+	// Get the last run when it can take the geometry, starts a new one otherwise (NULL when the texture is unusable)
+	BatchRun* GetRun(SDL_Texture* texture, SDL_BlendMode blendMode, S2DBatchPrimitive primitive);
+
+	// Adds an untextured vertex to the last run
+	void AddVertex(SDL_FPoint position, Color color);
+
+	// Flushes the batch when it grew too big
+	void CheckSize();
+
+	void SubmitRun(BatchRun& run);
+
+	// Submits the primitives of an untextured run
+	void SubmitPrimitives(BatchRun& run);
+
+	std::vector<S2DVertex> Vertices;
+	std::vector<int> Indices;
+	std::vector<BatchRun> Runs;
+
+	// First reserved vertex (-1 when no quads are reserved)
+	int ReservedVertex = -1;
+
+	// Scratch buffers of the primitive submission
+	std::vector<SDL_FPoint> Points;
+	std::vector<SDL_FRect> Rects;
+
+	SDL_Renderer* Renderer = nullptr;
+	S2DRenderCommandBuffer* Recording = nullptr;
+	bool Enabled = true;
+
+	S2DBatchStats CurrentStats, LastStats;
+};
+
+// Kind of the commands recorded for the render thread
+enum class S2DRenderCommandType
+{
+	Batch,		// Runs of the sprite batch
+	ClipRect,	// Sets or disables the clip rectangle
+	Clear		// Fills the render target with a color
+};
+
+// Draw commands of a frame recorded for the render thread, the memory is kept for the next frames
+class DllExport S2DRenderCommandBuffer
+{
+public:
+	// Records setting of the clip rectangle (NULL disables clipping)
+	void SetClipRect(const SDL_Rect* rect);
+
+	// Records clearing of the render target
+	void ClearTarget(Color color);
+
+	// Removes all the commands
+	void Clear();
+
+	bool IsEmpty() { return Commands.empty(); }
+
+	// Get the memory reserved by the buffer (in bytes)
+	size_t GetMemorySize();
+
+private:
+	friend class S2DSpriteBatch;
+
+	// Moves the runs of the sprite batch into the buffer
+	void AddRuns(S2DSpriteBatch& batch);
+
+	struct Command
+	{
+		S2DRenderCommandType type;
+		bool clip;
+		SDL_Color color;
+		SDL_Rect rect;
+		int firstRun, runCount;
+	};
+
+	std::vector<Command> Commands;
+	std::vector<S2DVertex> Vertices;
+	std::vector<int> Indices;
+	std::vector<S2DSpriteBatch::BatchRun> Runs;
+};
+
+// Entry of the draw order sort (the list and the item point to the sorted quad)
+struct S2DSortEntry
+{
+	Uint64 key;
+	int list, item;
+};
+
+// Sorts the entries by their keys and keeps the order of the entries with equal keys,
+// big arrays are sorted in parallel when a job system is given (scratch keeps its memory for the next sorts)
+DllExport void S2DRadixSort(std::vector<S2DSortEntry>& entries, std::vector<S2DSortEntry>& scratch, S2DJobSystem* jobs = nullptr);
+
+// Sorts entries that are almost in order (by their keys, then the lists, then the items) with an insertion sort,
+// gives up and returns false once more than maxMoves entries were moved (the entries are then partially sorted)
+DllExport bool S2DSortAlmostSorted(std::vector<S2DSortEntry>& entries, int maxMoves);
+
+// Builds the sort key of an quad: layer, then depth, then blend mode, then texture
+DllExport Uint64 S2DMakeSortKey(int layer, float depth, SDL_BlendMode blendMode, int textureSortID);
+
+class S2DGraphics;
+
+// Quads recorded by a single thread with the sort keys of their draw order, the memory is kept for the next frames
+// (the textures can't be loaded or unloaded and the camera can't change while the lists are recorded)
+class DllExport S2DDrawList
+{
+public:
+	// Records an texture (layers from -128 to 127 are drawn in ascending order, then the depths inside a layer)
+	void RenderTexture(int textureID, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color, int layer, float depth);
+
+	// Records the current frame of an sprite
+	void RenderSprite(S2DSprite* sprite, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color, int layer, float depth);
+
+	// Records an filled box
+	void RenderFilledBox(Vec2 pos, Vec2 center, Vec2 size, Color color, int layer, float depth);
+
+	// Records an line
+	void RenderLine(Vec2 p1, Vec2 p2, Color color, int layer, float depth);
+
+	// Get the number of recorded quads
+	int GetCount() { return (int)Items.size(); }
+
+	// Removes all the quads
+	void Clear();
+
+	// Get the camera of the list (NULL for screen coordinates)
+	S2DCamera* GetCamera() { return Camera; }
+
+private:
+	friend class S2DGraphics;
+	friend class S2DFont;
+
+	struct Item
+	{
+		Uint64 key;
+		SDL_Texture* texture;
+		SDL_BlendMode blendMode;
+		S2DBatchPrimitive primitive;
+		int vertex, vertexCount;
+		int index, indexCount;		// Triangles only, the indices are relative to the first vertex
+	};
+
+	// Adds an untextured item and returns its vertices
+	S2DVertex* AddPrimitive(S2DBatchPrimitive primitive, int vertexCount, Color color, int layer, float depth);
+
+	// Records an textured quad with the layer and the depth of the object being recorded
+	void Draw(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, float angle, const SDL_FPoint* center, TexFlipMode flip, Color color);
+
+	S2DGraphics* Owner = nullptr;
+	S2DCamera* Camera = nullptr;
+
+	// The list belongs to the render queue (recorded on the main thread)
+	bool Queue = false;
+
+	// Order of the object being recorded
+	int Layer = 0;
+	float Depth = 0.0f;
+	int SortID = 0;
+
+	std::vector<Item> Items;
+	std::vector<S2DVertex> Vertices;
+	std::vector<int> Indices;
+};
+
+// Statistics of the last sorted submission of the draw lists and the render queue
+struct S2DRenderQueueStats
+{
+	int objects = 0;			// Sorted quads and primitives
+	int lists = 0;				// Draw lists they came from
+	int batches = 0;			// Runs of the same texture handed to the sprite batch
+	bool reusedOrder = false;	// The order of the frame before only needed a few fixes (the radix sort was skipped)
+	float sortMs = 0;			// Time spent collecting and sorting the entries
+};
+
+// Records the quads of the objects [begin, end) into the list
+typedef std::function<void(S2DDrawList& list, int begin, int end)> S2DDrawListFunction;
+
+// Objects of the spatial index are kept in the cell of a loose grid containing their center,
+// objects bigger than a cell are kept in a separate list that every query checks
+class DllExport S2DSpatialIndex
+{
+public:
+	// Creates an empty index (cellSize is in world units, it should be about the size of the usual object)
+	S2DSpatialIndex(float cellSize = 2.0f);
+
+	// Set the cell size (all the objects are sorted into the new cells)
+	void SetCellSize(float size);
+	float GetCellSize() { return CellSize; }
+
+	// Adds an object with its world bounds (x and y is the top-left corner) and returns its ID
+	int Insert(const SDL_FRect& bounds, void* userData = nullptr);
+
+	// Moves an object, it only changes cells when its center leaves the current one
+	bool Update(int id, const SDL_FRect& bounds);
+
+	// Removes an object (its ID can be reused by the next inserted object)
+	bool Remove(int id);
+
+	// Is the ID pointing to an inserted object
+	bool Contains(int id) { return id >= 0 && id < (int)Objects.size() && Objects[id].alive; }
+
+	// Get the bounds of an object (an empty rectangle for unknown IDs)
+	SDL_FRect GetBounds(int id);
+	// Get the user data of an object (NULL for unknown IDs)
+	void* GetUserData(int id);
+
+	// Appends the IDs of the objects overlapping a rectangle, returns the number of found objects
+	int QueryRect(const SDL_FRect& rect, std::vector<int>& results);
+	// Appends the IDs of the objects overlapping a circle, returns the number of found objects
+	int QueryRadius(Vec2 center, float radius, std::vector<int>& results);
+	// Appends the IDs of the objects containing a point, returns the number of found objects
+	int QueryPoint(Vec2 point, std::vector<int>& results);
+
+	// Get the number of inserted objects
+	int GetCount() { return Count; }
+
+	// Get the number of changes made to the index (query results stay valid while it doesn't change)
+	Uint32 GetVersion() { return Version; }
+
+	// Removes all the objects
+	void Clear();
+
+private:
+	struct Object
+	{
+		SDL_FRect bounds;
+		void* userData;
+		Sint64 cell;	// Key of the cell (S2D_SPATIAL_LARGE for the objects bigger than a cell)
+		int slot;		// Position in the list of the cell
+		bool alive;
+	};
+
+	// Get the key of the cell an object belongs to
+	Sint64 GetCellKey(const SDL_FRect& bounds);
+
+	// Get the object list of a cell
+	std::vector<int>& GetCellObjects(Sint64 key);
+
+	void Link(int id);
+	void Unlink(int id);
+
+	// Appends the objects of the cells near the area passing the test
+	template<typename Test>
+	int Query(const SDL_FRect& area, Test test, std::vector<int>& results);
+
+	std::unordered_map<Sint64, std::vector<int>> Cells;
+	std::vector<int> LargeObjects;
+
+	std::vector<Object> Objects;
+	std::vector<int> FreeIDs;
+
+	float CellSize;
+	int Count = 0;
+	Uint32 Version = 0;
+};
+
 // Class containing the Graphics Subsystem
 class DllExport S2DGraphics
 {
@@ -321,7 +996,7 @@ public:
 	// Get current screen resolution
 	ScreenResolution* GetCurrentResolution() { return &CurrentResolution; }
 
-	// Get current window size
+	// Get current window size (the size is read once per frame while rendering)
 	Vec2Int GetCurrentWindowSize();
 
 	// Get current screen (useful when using more screens)
@@ -331,8 +1006,16 @@ public:
     SDL_Window* GetWindow() { return EngineWindow; }
     // Get a SDL Renderer instance
     SDL_Renderer* GetRenderer() { return NativeRenderer; }
-    // Get an Direct3D9 Graphics Device created by SDL Renderer
+#ifdef _WIN32
+    // Get an Direct3D9 Graphics Device created by SDL Renderer (NULL in headless mode)
 	IDirect3DDevice9* GetDX9Device();
+#endif // _WIN32
+
+	// Is the engine rendering offscreen without a visible window
+	bool IsHeadless() { return Headless; }
+
+	// Get the surface the headless software renderer draws into (NULL when not headless)
+	SDL_Surface* GetOffscreenSurface() { return OffscreenSurface; }
 
 	// Set screen for window (useful when using more screens)
 	void SetScreen(int screen);
@@ -344,6 +1027,19 @@ public:
 	// Enable/Disable fullscreen
     void SetFullscreen(bool state);
 
+	// Re-uploads all the textures after the graphics device was lost (called on SDL_RENDER_DEVICE_RESET)
+	void ResetDevice();
+
+	// Bakes the render targets again after their contents were lost (called on SDL_RENDER_TARGETS_RESET)
+	void ResetRenderTargets() { TargetGeneration++; }
+
+	// Keep the decoded pixels of textures loaded from now on, so a device reset doesn't read them from disk again
+	void SetKeepTexturePixels(bool state) { KeepTexturePixels = state; }
+	bool GetKeepTexturePixels() { return KeepTexturePixels; }
+
+	// Get the timings of the last fullscreen switch or device reset
+	S2DRendererResetStats GetLastResetStats() { return LastReset; }
+
 	// Draws an filled box
 	void RenderFilledBox(S2DCamera* cam, Vec2 pos, Vec2 center, Vec2 size, Color color);
 
@@ -356,6 +1052,21 @@ public:
 	// Draws an single point
 	void RenderPoint(S2DCamera* cam, Vec2 position, Color color);
 
+	// Draws an line with a thickness (in pixels)
+	void RenderThickLine(S2DCamera* cam, Vec2 p1, Vec2 p2, float thickness, Color color);
+
+	// Draws an circle (radius in pixels)
+	void RenderCircle(S2DCamera* cam, Vec2 pos, float radius, Color color, bool filled = true);
+
+	// Draws an filled polygon (points in world units, the edges must not cross)
+	void RenderPolygon(S2DCamera* cam, const std::vector<Vec2>& points, Color color);
+
+	// Draws an tessellated shape (angle in degrees)
+	void RenderShape(S2DCamera* cam, S2DShape* shape, Vec2 pos, float angle, Color color);
+
+	// Draws the living particles of an particle system
+	void RenderParticles(S2DCamera* cam, S2DParticleSystem* particles);
+
 	// Draws an sprite
 	void RenderSprite(S2DCamera* cam, S2DSprite* sprite, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color);
 
@@ -365,13 +1076,100 @@ public:
 	// Draws an texture
 	void RenderTexture(S2DCamera* cam, S2DTexture* tex, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color);
 
-	// Loads an texture from file
+	// Draws an tile map (only its chunks overlapping the camera view)
+	void RenderTilemap(S2DCamera* cam, S2DTilemap* map, Color color);
+
+	// Records the objects [0, count) into draw lists in parallel, every chunk of chunkSize objects fills its own list
+	// (the function runs on the job system, the call returns when all the lists are recorded)
+	void RecordDrawLists(S2DCamera* cam, int count, int chunkSize, S2DDrawListFunction function);
+
+	// Sorts everything recorded by RecordDrawLists and queued since the last submit and draws it (EndFrame submits
+	// the rest), the order only depends on the sort keys, then on the order of the recorded lists and quads
+	void SubmitDrawLists();
+
+	// Queues an texture drawn by SubmitDrawLists in the order of the layers (-128 to 127), then the depths inside a layer,
+	// objects of a layer with the same depth are grouped by their textures
+	void QueueTexture(S2DCamera* cam, int textureID, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color, int layer, float depth);
+
+	// Queues the current frame of an sprite
+	void QueueSprite(S2DCamera* cam, S2DSprite* sprite, Vec2 pos, Vec2 center, Vec2 size, float angle, TexFlipMode flip, Color color, int layer, float depth);
+
+	// Queues an filled box
+	void QueueFilledBox(S2DCamera* cam, Vec2 pos, Vec2 center, Vec2 size, Color color, int layer, float depth);
+
+	// Queues an line
+	void QueueLine(S2DCamera* cam, Vec2 p1, Vec2 p2, Color color, int layer, float depth);
+
+	// Queues an text in screen coordinates (same parameters as S2DFont::Render)
+	void QueueText(S2DFont* font, int size, const char* text, Vec2 pos, Vec2 center, float angle, TexFlipMode flip, Color color, int layer, float depth);
+
+	// Get the statistics of the last submission
+	S2DRenderQueueStats GetRenderQueueStats() { return QueueStats; }
+
+	// Get the part of the world seen by the camera (x and y is the top-left corner, in world units)
+	SDL_FRect GetCameraView(S2DCamera* cam);
+
+	// Get the world to screen transform of the camera (computed again only when the camera or the window changes)
+	const S2DMatrix2D& GetViewMatrix(S2DCamera* cam);
+
+	// Get the position of a world point on the screen (in pixels)
+	SDL_FPoint WorldToScreen(S2DCamera* cam, Vec2 pos);
+	// Transforms an array of world points to the screen at once
+	void WorldToScreen(S2DCamera* cam, const SDL_FPoint* points, SDL_FPoint* out, int count);
+
+	// Get the world position under a point of the screen (in pixels)
+	Vec2 ScreenToWorld(S2DCamera* cam, Vec2 pos);
+
+	// Get the spatial index of the world objects (shared by the render culling and the gameplay queries)
+	S2DSpatialIndex* GetSpatialIndex() { return &SpatialIndex; }
+
+	// Get the objects of the spatial index seen by the camera, the index is queried once per camera per frame
+	const std::vector<int>& GetVisibleObjects(S2DCamera* cam);
+
+	// Loads an texture from file (textures are shared by path, every load needs its own UnloadTexture),
+	// cooked textures (S2D_COOKED_TEXTURE_EXT) are uploaded without any conversion
 	int LoadTexture(const char* fileName);
-	// Loads an texture from file
+	// Loads an texture from file (textures are shared by path, every load needs its own UnloadTexture)
 	S2DTexture* LoadTextureRaw(const char* fileName);
 
-	// Get an texture from textureID
+	// Starts loading an texture on the job system and returns its textureID immediately,
+	// a placeholder is drawn until the texture is uploaded at the beginning of a frame
+	int LoadTextureAsync(const char* fileName, S2DTextureCallback callback = nullptr);
+
+	// Get the loading state of an texture
+	TextureState GetTextureState(int textureID);
+
+	// Blocks until an asynchronously loaded texture is ready, returns false when it failed to load
+	bool WaitTexture(int textureID);
+
+	// Set the max. time spent uploading asynchronously loaded textures per frame (in milliseconds)
+	void SetTextureUploadBudget(float milliseconds) { UploadBudget = milliseconds; }
+	float GetTextureUploadBudget() { return UploadBudget; }
+
+	// Get the number of textures still being loaded asynchronously
+	int GetPendingTextureCount();
+
+	// Set the job system used for texture decoding and the other engine work (the game sets its own one)
+	void SetJobSystem(S2DJobSystem* jobs);
+
+	// Get the job system (a private one is started on the first use when none was set)
+	S2DJobSystem* GetJobSystem();
+
+	// Packs images into atlas pages and returns their textureIDs (-1 for images that can't be loaded or don't fit a page),
+	// sub-textures are drawn like normal textures and loading their paths afterwards returns the packed ones
+	std::vector<int> BuildAtlas(const std::vector<const char*>& paths, const S2DAtlasSettings& settings = S2DAtlasSettings());
+	// Packs surfaces into atlas pages and returns their textureIDs (the surfaces aren't freed)
+	std::vector<int> BuildAtlas(const std::vector<SDL_Surface*>& surfaces, const S2DAtlasSettings& settings = S2DAtlasSettings());
+
+	// Get an texture from textureID (NULL when the texture was unloaded)
 	S2DTexture* GetTextureByID(int texID);
+
+	// Get the number of loaded textures
+	int GetTextureCount() { return Textures.GetCount(); }
+
+	// Get the texture cache hit/miss statistics
+	S2DTextureCacheStats GetTextureCacheStats() { return TextureCache.GetStats(); }
+	void ResetTextureCacheStats() { TextureCache.ResetStats(); }
 	
 	// Unloads an specific texture
 	bool UnloadTexture(int textureID);
@@ -384,6 +1182,30 @@ public:
 	// Unload all the loaded textures
 	void ClearTextures();
 
+	// Submits all batched sprites to the renderer (call it before drawing directly through SDL or Direct3D,
+	// with the render thread it draws the recorded commands and waits until the renderer is free)
+	void FlushBatch();
+
+	// Enable/Disable sprite batching
+	void SetSpriteBatching(bool state) { SpriteBatch.SetEnabled(state); }
+	bool GetSpriteBatching() { return SpriteBatch.IsEnabled(); }
+
+	// Get sprite batch statistics of the last rendered frame (with the render thread the vertices and draw calls are from the frame before)
+	S2DBatchStats GetBatchStats();
+
+	// Enable/Disable the render thread, OnRender then only records the draw calls and the render thread submits them
+	// and presents the frame while the game updates the next one. Returns false when the renderer can't be used from
+	// another thread (only the Direct3D and software renderers can, OpenGL contexts belong to the creating thread)
+	bool SetRenderThread(bool state);
+	bool GetRenderThread() { return RenderThread != nullptr; }
+
+	// Starts drawing the frame finished by EndFrame on the render thread (S2DGame calls it after handling the events,
+	// SDL changes the renderer when it handles window events)
+	void SubmitFrame();
+
+	// Get the memory of the recorded command buffers (in bytes)
+	size_t GetCommandMemory();
+
     // Starts the rendering frame sequence
     void BeginFrame();
     // Ends the rendering frame sequence and draws the buffer to screen
@@ -402,7 +1224,175 @@ public:
 	bool IsRunning() { return Running; }
 
 private:
-	std::vector<S2DTexture*> LoadedTextures;
+	// Loads an texture through the texture cache
+	S2DTexture* LoadCachedTexture(const char* fileName);
+
+	// Decodes and uploads an image file (PNG, JPG...)
+	S2DTexture* LoadImageTexture(const char* path);
+
+	// Destroys an texture with its kept pixels
+	void DestroyTexture(S2DTexture* tex);
+
+	// Uploads the stored pixels of an cooked texture as they are (premultiplied ones are converted back when the renderer can't blend them)
+	SDL_Texture* CreateCookedTexture(SDL_Surface* surface, bool premultiplied);
+
+	// Uploads an loaded cooked texture and fills in its image data, returns false when the upload failed
+	bool UploadCookedTexture(S2DTexture* tex, SDL_Surface* surface, const S2DCookedTextureHeader& header);
+
+	// Packs the converted images into atlas pages (the images are freed)
+	std::vector<int> PackAtlas(std::vector<SDL_Surface*>& images, const std::vector<std::string>& paths, const S2DAtlasSettings& settings);
+
+	// Draws a part of an texture (a frame rectangle in the untrimmed image or the whole image when NULL),
+	// records it into the draw list instead when one is given (safe to call from the recording threads)
+	void DrawTextureRegion(const S2DTextureInfo& info, const SDL_Rect* frame, const SDL_FRect& dst, float angle, TexFlipMode flip, Color color, S2DDrawList* list = nullptr);
+
+	friend class S2DDrawList;
+
+	// Draw lists of the running frame (the lists before UsedDrawLists are recorded) and the buffers of their sort
+	std::vector<S2DDrawList*> DrawLists;
+	int UsedDrawLists = 0;
+	std::vector<S2DSortEntry> DrawOrder, DrawOrderScratch;
+
+	// Sorted order of the last submission (positions of the entries in the recorded order)
+	std::vector<int> LastDrawOrder;
+	std::vector<int> DrawListOffsets;
+
+	S2DRenderQueueStats QueueStats;
+
+	// Get the render queue list of a camera (NULL for screen coordinates)
+	S2DDrawList* GetQueueList(S2DCamera* cam);
+
+	// Get an unused draw list
+	S2DDrawList* AddDrawList(S2DCamera* cam, bool queue);
+
+	friend class S2DTilemap;
+
+	// Whether the renderer can draw with the premultiplied blend mode (checked once per renderer)
+	bool CanBlendPremultiplied();
+	Uint32 PremultipliedBlendGeneration = 0;
+	bool PremultipliedBlend = false;
+
+	// Bakes the tiles of a chunk into its render target, returns false when the renderer can't bake it
+	bool BakeTilemapChunk(S2DTilemap* map, int chunk, const S2DTextureInfo& tileset);
+
+	// Draws the tiles of a chunk scaled into a rectangle (turned by an angle around its center)
+	void DrawTilemapTiles(S2DTilemap* map, int chunk, const S2DTextureInfo& tileset, const SDL_FRect& dst, float angle, Color color);
+
+	// Destroys the render targets of a tile map
+	void DestroyTilemapChunks(S2DTilemap* map);
+
+	// Increased when the render targets lose their contents or the renderer is recreated
+	Uint32 TargetGeneration = 1;
+	Uint32 RendererGeneration = 1;
+
+	// Get the unit circle with its fan triangles for a number of segments
+	const S2DShape& GetUnitCircle(int segments);
+
+	// Circles tessellated so far by their number of segments
+	std::unordered_map<int, S2DShape> CircleCache;
+
+	// Scratch buffers of the primitives
+	std::vector<SDL_FPoint> ShapePoints;
+	std::vector<int> ShapeIndices;
+
+	// Screen positions of the particles being drawn and the quads written by every chunk of them
+	std::vector<SDL_FPoint> ParticlePoints;
+	std::vector<int> ParticleChunkQuads;
+	// Buckets and scratch quads of the particles grouped by color
+	std::vector<int> ParticleColorCounts;
+	std::vector<S2DVertex> ParticleSortScratch;
+
+	// Computes the transform of the camera when it or the window changed
+	void UpdateCamera(S2DCamera* cam);
+
+	// Updates the camera and clips the drawing to its viewport
+	void SetDrawCamera(S2DCamera* cam);
+
+	// Is a rectangle (size in pixels, position in world units) near enough to the camera to be seen
+	bool IsOnScreen(S2DCamera* cam, Vec2 pos, Vec2 size, float angle);
+
+	// Get the screen rectangle of an object (size in pixels, center relative to the size), the angle is turned with the camera
+	SDL_FRect GetScreenRect(S2DCamera* cam, Vec2 pos, Vec2 center, Vec2 size, float& angle);
+
+	// Viewport the drawing is clipped to (none when a camera covers the whole window)
+	SDL_Rect ClipRect = { 0, 0, 0, 0 };
+	bool Clipping = false;
+
+	// Visible objects of a camera in the current frame
+	struct VisibleObjects
+	{
+		S2DCamera* camera;
+		SDL_FRect view;
+		Uint32 version;
+		Uint64 frame;
+		std::vector<int> objects;
+	};
+
+	S2DSpatialIndex SpatialIndex;
+	std::vector<VisibleObjects> VisibleCache;
+	Uint64 FrameNumber = 0;
+
+	// Uploads all the loaded textures again, returns false when the renderer failed to create them
+	bool ReuploadTextures();
+
+	// Destroys the renderer and creates a new one with all the textures
+	void RecreateRenderer();
+
+	// Writes the timings of the last reset into the debug output
+	void ReportReset(const char* reason, Uint64 start);
+
+	bool KeepTexturePixels = true;
+	S2DRendererResetStats LastReset;
+
+	// Creates the texture drawn in place of textures that are still loading
+	void CreatePlaceholderTexture();
+
+	// Uploads decoded textures until the upload budget is used up
+	void UploadDecodedTextures();
+
+	// Uploads a decoded texture and calls its callbacks
+	void FinishTextureRequest(S2DTextureRequest* request);
+
+	// Drops the pending load of an texture that is being unloaded
+	void CancelTextureLoad(S2DTexture* tex);
+
+	// Waits until all the decoding jobs are done
+	void WaitTextureDecodes();
+
+	// Waits for the decoding jobs and drops all the pending loads
+	void ShutdownTextureLoader();
+
+	// Shuts the loader down when quitting
+	friend class S2DGame;
+
+	// Waits until the render thread finished its frame, the renderer can create resources until the next frame is submitted
+	void WaitRenderThread();
+
+	// Draws everything recorded so far and waits for the render thread, the renderer can be used directly afterwards
+	void SyncRenderer();
+
+	// Queues the recorded frame for the render thread and starts recording the next one
+	void FinishRecordedFrame();
+
+	// Throws away the frames recorded for the render thread and gives it the renderer (after the textures were lost)
+	void DropRecordedFrames(SDL_Renderer* renderer);
+
+	// Sets the clip rectangle of the renderer (recorded with the render thread)
+	void SetRendererClip(const SDL_Rect* rect);
+
+	S2DRenderThread* RenderThread = nullptr;
+
+	S2DJobSystem* JobSystem = nullptr;
+	bool OwnsJobSystem = false;
+
+	S2DTextureLoader* Loader = nullptr;
+	SDL_Texture* PlaceholderTexture = nullptr;
+	float UploadBudget = 2.0f;
+
+	S2DTextureRegistry Textures;
+	S2DTextureCache TextureCache;
+
+	S2DSpriteBatch SpriteBatch;
 
 	bool Running;
 
@@ -411,6 +1401,16 @@ private:
 	ScreenResolution CurrentResolution;
 	int CurrentScreen;
     bool Fullscreen;
+
+	bool Headless = false;
+	SDL_Surface* OffscreenSurface = nullptr;
+
+	// Reads the window size from SDL (the display mode in fullscreen)
+	Vec2Int QueryWindowSize();
+
+	// Window size of the frame being rendered
+	Vec2Int FrameSize;
+	bool InFrame = false;
 };
 
 #endif // !S2D_GFX_INCLUDED
@@ -0,0 +1,95 @@
+/************************************************************\
+      _____ ___  _____    ______             _
+     / ____|__ \|  __ \  |  ____|           (_)
+    | (___    ) | |  | | | |__   _ __   __ _ _ _ __   ___
+     \___ \  / /| |  | | |  __| | '_ \ / _` | | '_ \ / _ \
+     ____) |/ /_| |__| | | |____| | | | (_| | | | | |  __/
+    |_____/|____|_____/  |______|_| |_|\__, |_|_| |_|\___|
+                                        __/ |
+                                       |___/
+    ======================================================
+        S2D Engine - An Open-Source 2D Game Framework
+                    Coded by Sevenisko
+
+    Purpose: Work-stealing job system
+\************************************************************/
+
+#ifndef S2D_JOBS_INCLUDED
+#define S2D_JOBS_INCLUDED
+
+#include <SDL.h>
+#include <functional>
+
+#if defined(S2D_MAIN_INCLUDED) && defined(_WIN32)
+#define DllExport __declspec(dllexport)
+#else
+#define DllExport
+#endif // S2D_MAIN_INCLUDED
+
+// Max. number of jobs scheduled and not finished at the same time
+#define S2D_MAX_JOBS 4096
+
+struct S2DJob;
+struct S2DJobSystemData;
+
+typedef std::function<void()> S2DJobFunction;
+
+// Function of the ParallelFor chunks, called with a range of indices [begin, end)
+typedef std::function<void(int begin, int end)> S2DJobRangeFunction;
+
+// Reference to a scheduled job (empty handles count as finished)
+struct S2DJobHandle
+{
+	S2DJob* job = nullptr;
+	Uint32 generation = 0;
+
+	bool IsValid() const { return job != nullptr; }
+};
+
+// Pool of worker threads running small jobs, every thread has its own job queue and idle threads steal jobs from the others
+class DllExport S2DJobSystem
+{
+public:
+	// Starts the worker threads (0 starts one worker per CPU core besides the calling thread),
+	// the calling thread becomes the main thread of the system
+	S2DJobSystem(int workers = 0);
+
+	// Stops the worker threads (the jobs that haven't started yet are dropped)
+	~S2DJobSystem();
+
+	// Schedules a job, it runs once all its dependencies finished
+	S2DJobHandle Schedule(S2DJobFunction function);
+	S2DJobHandle Schedule(S2DJobFunction function, S2DJobHandle dependency);
+	S2DJobHandle Schedule(S2DJobFunction function, const S2DJobHandle* dependencies, int dependencyCount);
+
+	// Calls the function over the range [0, count) split into chunks running in parallel, the handle finishes with the last chunk
+	// (chunks have at least minChunk indices, 0 picks a size giving every thread a few chunks, an empty range returns the dependency)
+	S2DJobHandle ParallelFor(int count, int minChunk, S2DJobRangeFunction function, S2DJobHandle dependency = S2DJobHandle());
+
+	// Is the job finished
+	bool IsFinished(S2DJobHandle handle);
+
+	// Waits until the job finishes, the waiting thread runs other jobs meanwhile
+	void Wait(S2DJobHandle handle);
+
+	// Runs a single queued job on the calling thread, returns false when there was none
+	bool RunPendingJob();
+
+	// Queues a function called on the main thread by RunMainThreadCallbacks (any thread can post)
+	void PostToMainThread(S2DJobFunction function);
+
+	// Calls the functions posted to the main thread and returns their number (the game calls it every frame)
+	int RunMainThreadCallbacks();
+
+	// Get the number of worker threads (without the main thread)
+	int GetWorkerCount() { return WorkerCount; }
+
+	// Get the number of jobs finished since the start
+	Uint64 GetFinishedJobCount();
+
+private:
+	S2DJobSystemData* Data;
+	int WorkerCount;
+};
+
+#endif // !S2D_JOBS_INCLUDED
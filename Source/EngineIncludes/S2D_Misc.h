@@ -17,15 +17,22 @@
 #ifndef S2D_MISC_INCLUDED
 #define S2D_MISC_INCLUDED
 
+#ifdef _WIN32
 #include <Windows.h>
 #include <ImageHlp.h>
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#endif // _WIN32
 
-#ifdef S2D_MAIN_INCLUDED
+#if defined(S2D_MAIN_INCLUDED) && defined(_WIN32)
 #define DllExport __declspec(dllexport)
 #else
 #define DllExport
 #endif // S2D_MAIN_INCLUDED
 
+#ifdef _WIN32
+
 #define S2DAssert(expression) if(!expression) { if(IsConsoleApp()) {printf("File: %s\nLine: %d\n\t %s", __FILE__, __LINE__, #expression); abort(); } else { char msg[128]; sprintf(msg, "File: %s\nLine: %d\n\t %s", __FILE__, __LINE__, #expression);  MessageBoxA(NULL, msg, "S2D Assert Failure", MB_OK | MB_ICONERROR); ExitProcess(1); } }
 
 #define S2DFatalError(message) if(IsConsoleApp()) {printf("Fatal Error: %s", message); abort(); } else { char msg[128]; sprintf(msg, "Fatal Error: %s", message);  MessageBoxA(NULL, msg, "Error", MB_OK | MB_ICONERROR); ExitProcess(1); }
@@ -37,6 +44,24 @@ char msg[256];\
 sprintf(msg, message, ##__VA_ARGS__);\
 MessageBoxA(NULL, msg, "S2D Game Engine", MB_OK | MB_ICONINFORMATION);
 
+// Writes a message into the debugger output
+#define S2DDebugOutput(text) OutputDebugStringA(text)
+
+#else
+
+#define S2DAssert(expression) if(!(expression)) { fprintf(stderr, "File: %s\nLine: %d\n\t %s\n", __FILE__, __LINE__, #expression); abort(); }
+
+#define S2DFatalError(message) { fprintf(stderr, "Fatal Error: %s\n", message); abort(); }
+
+#define S2DFatalErrorFormatted(message, ...) { char msg[256]; snprintf(msg, sizeof(msg), message, ##__VA_ARGS__); fprintf(stderr, "Fatal Error: %s\n", msg); abort(); }
+
+#define S2DMsgBox(message, ...) printf(message, ##__VA_ARGS__);
+
+// Writes a message into the debugger output
+#define S2DDebugOutput(text) fputs(text, stderr)
+
+#endif // _WIN32
+
 extern bool IsConsoleApp();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+/************************************************************\
+      _____ ___  _____    ______             _
+     / ____|__ \|  __ \  |  ____|           (_)
+    | (___    ) | |  | | | |__   _ __   __ _ _ _ __   ___
+     \___ \  / /| |  | | |  __| | '_ \ / _` | | '_ \ / _ \
+     ____) |/ /_| |__| | | |____| | | | (_| | | | | |  __/
+    |_____/|____|_____/  |______|_| |_|\__, |_|_| |_|\___|
+                                        __/ |
+                                       |___/
+    ======================================================
+        S2D Engine - An Open-Source 2D Game Framework
+                    Coded by Sevenisko
+
+    Purpose: Data-oriented particle system
+\************************************************************/
+
+#ifndef S2D_PARTICLES_INCLUDED
+#define S2D_PARTICLES_INCLUDED
+
+// Spawning settings of a particle emitter
+struct S2DParticleEmitter
+{
+	Vec2 position;					// Position of the emitter (in world units)
+	Vec2 area;						// Size of the rectangle around the position particles spawn in (in world units)
+	float rate = 100.0f;			// Particles spawned per second
+	float angle = 90.0f;			// Direction of the particles (in degrees, 90 is up)
+	float spread = 360.0f;			// Range of the directions around the angle (in degrees)
+	float minSpeed = 1.0f;			// Speed range of the particles (in world units per second)
+	float maxSpeed = 2.0f;
+	float minLifetime = 1.0f;		// Lifetime range of the particles (in seconds)
+	float maxLifetime = 2.0f;
+	float minSize = 4.0f;			// Size range of the particles (in pixels)
+	float maxSize = 8.0f;
+	bool enabled = true;			// Spawn particles in Update
+};
+
+// Pool of particles kept as arrays of their attributes, updated with SIMD and drawn as a single batch of quads
+class DllExport S2DParticleSystem
+{
+public:
+	// Creates an system holding up to maxParticles particles
+	S2DParticleSystem(int maxParticles);
+
+	// Set the texture of the particles (S2D_INVALID_TEXTURE draws colored squares)
+	void SetTexture(int textureID) { Texture = textureID; }
+	int GetTexture() { return Texture; }
+
+	// Set the acceleration applied to all the particles (in world units per second squared)
+	void SetGravity(Vec2 gravity) { GravityX = gravity.x; GravityY = gravity.y; }
+
+	// Set how fast the particles slow down (the velocity decays by exp(-drag * seconds))
+	void SetDrag(float drag) { Drag = drag > 0.0f ? drag : 0.0f; }
+
+	// Set the color of the particles at their birth and their death (the color is blended in between)
+	void SetColors(Color start, Color end);
+
+	// Set the scale of the particle size at their birth and their death
+	void SetSizeOverLife(float start, float end) { StartScale = start; EndScale = end; }
+
+	// Adds an emitter and returns its index
+	int AddEmitter(const S2DParticleEmitter& emitter);
+
+	// Get an emitter to change its settings (NULL for invalid indices)
+	S2DParticleEmitter* GetEmitter(int index);
+	int GetEmitterCount() { return (int)Emitters.size(); }
+
+	// Removes all the emitters (the living particles stay)
+	void ClearEmitters();
+
+	// Spawns particles of an emitter at once
+	void Burst(int emitter, int count);
+
+	// Spawns new particles, moves the living ones and removes the dead ones
+	// (large systems are moved in parallel when a job system is passed)
+	void Update(float deltaTime, S2DJobSystem* jobs = nullptr);
+
+	// Removes all the particles
+	void Clear() { Count = 0; }
+
+	// Get the number of living particles
+	int GetCount() { return Count; }
+	int GetMaxCount() { return MaxCount; }
+
+	// Enable/Disable the SIMD update (for comparing it with the scalar one)
+	void SetSIMD(bool state) { UseSIMD = state; }
+	bool GetSIMD() { return UseSIMD; }
+
+private:
+	friend class S2DGraphics;
+
+	// Spawns a single particle of an emitter
+	void Spawn(const S2DParticleEmitter& emitter);
+
+	// Random number in a range
+	float Random(float min, float max);
+
+	// Moves the particles in the range [first, last) and updates their colors
+	void Integrate(int first, int last, float deltaTime);
+	// Same as Integrate, four particles at a time
+	void IntegrateSIMD(int first, int last, float deltaTime);
+
+	// Removes the particles that outlived their lifetime
+	void RemoveDead();
+
+	// Attributes of the particles (the first Count items are alive)
+	std::vector<float> PosX, PosY;
+	std::vector<float> VelX, VelY;
+	std::vector<float> Age;				// Fraction of the lifetime that passed (dead at 1)
+	std::vector<float> AgeRate;			// 1 / lifetime
+	std::vector<float> Size;
+	std::vector<Uint32> Colors;			// Current colors with SDL_Color byte order
+
+	int Count = 0;
+	int MaxCount;
+
+	std::vector<S2DParticleEmitter> Emitters;
+	std::vector<float> SpawnAccumulators;
+
+	int Texture = S2D_INVALID_TEXTURE;
+
+	float GravityX = 0.0f, GravityY = 0.0f;
+	float Drag = 0.0f;
+	float StartColor[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+	float EndColor[4] = { 255.0f, 255.0f, 255.0f, 0.0f };
+	float StartScale = 1.0f, EndScale = 1.0f;
+
+	Uint32 RandomState = 0x9E3779B9;
+	bool UseSIMD = true;
+};
+
+#endif // !S2D_PARTICLES_INCLUDED
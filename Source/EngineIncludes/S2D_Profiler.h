@@ -0,0 +1,82 @@
+/************************************************************\
+      _____ ___  _____    ______             _
+     / ____|__ \|  __ \  |  ____|           (_)
+    | (___    ) | |  | | | |__   _ __   __ _ _ _ __   ___
+     \___ \  / /| |  | | |  __| | '_ \ / _` | | '_ \ / _ \
+     ____) |/ /_| |__| | | |____| | | | (_| | | | | |  __/
+    |_____/|____|_____/  |______|_| |_|\__, |_|_| |_|\___|
+                                        __/ |
+                                       |___/
+    ======================================================
+        S2D Engine - An Open-Source 2D Game Framework
+                    Coded by Sevenisko
+
+    Purpose: Implementation of the frame profiler
+\************************************************************/
+
+#ifndef S2D_PROFILER_INCLUDED
+#define S2D_PROFILER_INCLUDED
+
+#include <SDL.h>
+
+#if defined(S2D_MAIN_INCLUDED) && defined(_WIN32)
+#define DllExport __declspec(dllexport)
+#else
+#define DllExport
+#endif // S2D_MAIN_INCLUDED
+
+// Collects timed zones of all threads and exports them as Chrome trace events
+class DllExport S2DProfiler
+{
+public:
+    // Enable/Disable recording of zones (enabled by default)
+    static void SetEnabled(bool state);
+    static bool IsEnabled();
+
+    // Marks the start of a new frame (called by the engine)
+    static void MarkFrame();
+
+    // Sets the name of the calling thread shown in the trace
+    static void SetThreadName(const char* name);
+
+    // Records a zone of the calling thread, name has to be a string literal
+    static void RecordZone(const char* name, Uint64 start, Uint64 end);
+
+    // Writes the last N frames as Chrome trace_event JSON (open it in chrome://tracing)
+    static bool DumpChromeTrace(const char* path, int frames);
+};
+
+// Records a zone from its construction to its destruction
+class DllExport S2DProfileScope
+{
+public:
+    S2DProfileScope(const char* name)
+    {
+        zoneName = name;
+        zoneStart = SDL_GetPerformanceCounter();
+    }
+
+    ~S2DProfileScope()
+    {
+        S2DProfiler::RecordZone(zoneName, zoneStart, SDL_GetPerformanceCounter());
+    }
+
+private:
+    const char* zoneName;
+    Uint64 zoneStart;
+};
+
+#define S2D_PROFILE_CONCAT_INNER(a, b) a##b
+#define S2D_PROFILE_CONCAT(a, b) S2D_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef S2D_PROFILER_ENABLED
+// Profiles the rest of the current scope
+#define S2DProfileZone(name) S2DProfileScope S2D_PROFILE_CONCAT(s2dProfileZone, __LINE__)(name)
+// Marks the start of a new frame
+#define S2DProfileFrame() S2DProfiler::MarkFrame()
+#else
+#define S2DProfileZone(name)
+#define S2DProfileFrame()
+#endif // S2D_PROFILER_ENABLED
+
+#endif // !S2D_PROFILER_INCLUDED
@@ -0,0 +1,133 @@
+/************************************************************\
+      _____ ___  _____    ______             _
+     / ____|__ \|  __ \  |  ____|           (_)
+    | (___    ) | |  | | | |__   _ __   __ _ _ _ __   ___
+     \___ \  / /| |  | | |  __| | '_ \ / _` | | '_ \ / _ \
+     ____) |/ /_| |__| | | |____| | | | (_| | | | | |  __/
+    |_____/|____|_____/  |______|_| |_|\__, |_|_| |_|\___|
+                                        __/ |
+                                       |___/
+    ======================================================
+        S2D Engine - An Open-Source 2D Game Framework
+                    Coded by Sevenisko
+
+    Purpose: Chunked tile maps baked into render targets
+\************************************************************/
+
+#ifndef S2D_TILEMAP_INCLUDED
+#define S2D_TILEMAP_INCLUDED
+
+// Default width and height of the chunks (in tiles)
+#define S2D_TILEMAP_CHUNK_SIZE 32
+
+// Tiles store their index in the tileset + 1, so zero is an empty tile
+#define S2D_TILE_EMPTY 0
+
+// Tile map statistics of the last draw
+struct S2DTilemapStats
+{
+	int visibleChunks = 0;	// Chunks overlapping the camera view
+	int bakedChunks = 0;	// Chunks baked again because their tiles changed
+	int directChunks = 0;	// Chunks drawn tile by tile (the renderer can't bake them)
+	int chunkTextures = 0;	// Render targets held by the chunks
+};
+
+// Tile layers split into chunks, every chunk is baked into a render target once and redrawn only when its tiles change
+// (renderers without render targets or the premultiplied blend mode draw the tiles directly)
+class DllExport S2DTilemap
+{
+public:
+	// Position of the top-left corner of the map (in world units)
+	Vec2 Position;
+
+	// Creates an empty map of width x height tiles (tileSize is in world units)
+	S2DTilemap(int width, int height, Vec2 tileSize, int chunkSize = S2D_TILEMAP_CHUNK_SIZE);
+
+	// Destroys the map with its chunk render targets (do it before the engine is destroyed)
+	~S2DTilemap();
+
+	// Set the tileset texture, tiles are read left to right in rows of tilePixels sized cells
+	// with spacing pixels between them and margin pixels around them
+	void SetTileset(int textureID, Vec2Int tilePixels, int spacing = 0, int margin = 0);
+
+	// Adds an empty layer on top of the others and returns its index
+	int AddLayer();
+	int GetLayerCount() { return (int)Layers.size(); }
+
+	// Show/Hide a layer
+	void SetLayerVisible(int layer, bool state);
+	bool IsLayerVisible(int layer);
+
+	// Set a tile (S2D_TILE_EMPTY clears it), only its chunk gets baked again
+	void SetTile(int layer, int x, int y, Uint16 tile);
+	// Get a tile (S2D_TILE_EMPTY outside the map)
+	Uint16 GetTile(int layer, int x, int y);
+
+	// Fills a rectangle of tiles
+	void Fill(int layer, int x, int y, int w, int h, Uint16 tile);
+
+	// Get the tile containing a world position, returns false when it's outside the map
+	bool WorldToTile(Vec2 position, int* x, int* y);
+
+	int GetWidth() { return Width; }
+	int GetHeight() { return Height; }
+	int GetChunkSize() { return ChunkSize; }
+	Vec2 GetTileSize() { return TileSize; }
+
+	// Bakes all the chunks again (e.g. after the tileset texture was changed)
+	void Invalidate();
+
+	// Destroys the chunk render targets, they're baked again once they get visible
+	void ReleaseChunks();
+
+	// Set the number of draws a chunk out of the view keeps its render target
+	void SetChunkLifetime(int draws) { ChunkLifetime = draws > 0 ? draws : 1; }
+
+	S2DTilemapStats GetStats() { return Stats; }
+
+private:
+	friend class S2DGraphics;
+
+	struct Layer
+	{
+		std::vector<Uint16> tiles;
+		bool visible = true;
+	};
+
+	struct Chunk
+	{
+		SDL_Texture* texture = nullptr;
+		bool dirty = true;
+		bool empty = false;
+		Uint64 lastDrawn = 0;
+	};
+
+	// Marks the chunks overlapping a rectangle of tiles to be baked again
+	void MarkDirty(int x, int y, int w, int h);
+
+	std::vector<Layer> Layers;
+	std::vector<Chunk> Chunks;
+	// Indices of the chunks holding a render target
+	std::vector<int> BakedChunks;
+
+	int Width, Height;
+	int ChunkSize;
+	int ChunksX, ChunksY;
+	Vec2 TileSize;
+
+	int Tileset = S2D_INVALID_TEXTURE;
+	Vec2Int TilePixels;
+	int Spacing = 0, Margin = 0;
+
+	// Graphics the render targets were created by and the generations they are valid for
+	S2DGraphics* Owner = nullptr;
+	Uint32 TargetGeneration = 0;
+	Uint32 RendererGeneration = 0;
+
+	Uint64 Draws = 0;
+	int ChunkLifetime = 120;
+
+	S2DTilemapStats Stats;
+};
+
+#endif // !S2D_TILEMAP_INCLUDED
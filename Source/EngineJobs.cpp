@@ -0,0 +1,559 @@
+#include "EngineIncludes.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+// Capacity of the job queue of every thread (power of two)
+#define S2D_JOB_QUEUE_SIZE 4096
+
+// Number of empty searches before an idle worker goes to sleep
+#define S2D_JOB_SPINS 64
+
+struct S2DJob
+{
+    S2DJobFunction function;
+
+    // ParallelFor roots keep the range function, their chunks point to them
+    S2DJobRangeFunction range;
+    S2DJob* parent = nullptr;
+    int begin = 0, end = 0, chunk = 0;
+
+    std::atomic<int> unfinished{ 0 };       // The job itself and its unfinished chunks
+    std::atomic<int> dependencies{ 0 };     // Unfinished dependencies (+1 while the job is being scheduled)
+    std::atomic<Uint32> generation{ 0 };
+    std::atomic<bool> finished{ false };
+    std::atomic<bool> used{ false };
+
+    // Jobs waiting for this one, protected by the lock (so is the generation change on reuse)
+    std::mutex lock;
+    std::vector<S2DJob*> continuations;
+};
+
+// Work-stealing queue (Chase-Lev), the owner pushes and pops at the bottom, the other threads steal from the top
+struct S2DJobQueue
+{
+    std::atomic<Sint64> top{ 0 };
+    std::atomic<Sint64> bottom{ 0 };
+    std::atomic<S2DJob*> items[S2D_JOB_QUEUE_SIZE];
+
+    bool Push(S2DJob* job)
+    {
+        Sint64 b = bottom.load(std::memory_order_relaxed);
+        Sint64 t = top.load(std::memory_order_acquire);
+
+        if (b - t >= S2D_JOB_QUEUE_SIZE) return false;
+
+        items[b & (S2D_JOB_QUEUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    S2DJob* Pop()
+    {
+        Sint64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        Sint64 t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        S2DJob* job = items[b & (S2D_JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+
+        // The last job can be stolen at the same time
+        if (t == b)
+        {
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    S2DJob* Steal()
+    {
+        Sint64 t = top.load(std::memory_order_acquire);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        Sint64 b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return nullptr;
+
+        S2DJob* job = items[t & (S2D_JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+
+        return job;
+    }
+};
+
+// Function posted to the main thread, linked into a lock-free queue with many producers and a single consumer
+struct S2DMainThreadCall
+{
+    S2DJobFunction function;
+    std::atomic<S2DMainThreadCall*> next{ nullptr };
+};
+
+struct S2DJobSystemData
+{
+    S2DJob jobs[S2D_MAX_JOBS];
+    std::atomic<Uint32> nextJob{ 0 };
+
+    // Queue 0 belongs to the main thread, the rest to the workers
+    std::vector<S2DJobQueue*> queues;
+    std::vector<std::thread> workers;
+
+    // Jobs scheduled by threads that don't belong to the system
+    std::mutex injectedLock;
+    std::deque<S2DJob*> injected;
+
+    // Queued jobs of all the queues (sleeping workers wait for it)
+    std::atomic<int> queued{ 0 };
+    std::atomic<int> sleeping{ 0 };
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<bool> quit{ false };
+
+    std::atomic<Uint64> finishedJobs{ 0 };
+
+    // Main thread calls, pushed at the head and taken at the tail
+    std::atomic<S2DMainThreadCall*> callHead{ nullptr };
+    S2DMainThreadCall* callTail = nullptr;
+};
+
+// Queue of the calling thread (-1 for threads that don't belong to the system)
+static thread_local S2DJobSystemData* CurrentSystem = nullptr;
+static thread_local int CurrentQueue = -1;
+
+static int GetThreadQueue(S2DJobSystemData* data)
+{
+    return CurrentSystem == data ? CurrentQueue : -1;
+}
+
+static S2DJob* FindJob(S2DJobSystemData* data);
+
+static void RunJob(S2DJobSystemData* data, S2DJob* job);
+
+static S2DJob* AllocateJob(S2DJobSystemData* data)
+{
+    for (;;)
+    {
+        for (int i = 0; i < S2D_MAX_JOBS; i++)
+        {
+            S2DJob* job = &data->jobs[data->nextJob.fetch_add(1, std::memory_order_relaxed) & (S2D_MAX_JOBS - 1)];
+
+            bool expected = false;
+            if (job->used.load(std::memory_order_relaxed) || !job->used.compare_exchange_strong(expected, true, std::memory_order_acquire)) continue;
+
+            {
+                // Old handles see the new generation and treat the job as finished
+                std::lock_guard<std::mutex> lock(job->lock);
+                job->generation.fetch_add(1, std::memory_order_release);
+                job->finished.store(false, std::memory_order_release);
+                job->continuations.clear();
+            }
+
+            job->parent = nullptr;
+            job->unfinished.store(1, std::memory_order_relaxed);
+            job->dependencies.store(1, std::memory_order_relaxed);
+
+            return job;
+        }
+
+        // All the jobs are in use, help finishing them (every thread could be waiting here otherwise)
+        S2DJob* pending = FindJob(data);
+
+        if (pending)
+            RunJob(data, pending);
+        else
+            std::this_thread::yield();
+    }
+}
+
+static void PushJob(S2DJobSystemData* data, S2DJob* job);
+
+static void FinishJob(S2DJobSystemData* data, S2DJob* job)
+{
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    S2DJob* parent = job->parent;
+    std::vector<S2DJob*> continuations;
+
+    {
+        std::lock_guard<std::mutex> lock(job->lock);
+        job->finished.store(true, std::memory_order_release);
+        continuations.swap(job->continuations);
+    }
+
+    for (S2DJob* next : continuations)
+    {
+        if (next->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            PushJob(data, next);
+    }
+
+    job->function = nullptr;
+    job->range = nullptr;
+    job->used.store(false, std::memory_order_release);
+
+    data->finishedJobs.fetch_add(1, std::memory_order_relaxed);
+
+    if (parent) FinishJob(data, parent);
+}
+
+static void PushJob(S2DJobSystemData* data, S2DJob* job)
+{
+    int queue = GetThreadQueue(data);
+
+    data->queued.fetch_add(1, std::memory_order_seq_cst);
+
+    if (queue >= 0)
+    {
+        if (!data->queues[queue]->Push(job))
+        {
+            // The queue is full, run the job right away
+            data->queued.fetch_sub(1, std::memory_order_relaxed);
+            RunJob(data, job);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(data->injectedLock);
+        data->injected.push_back(job);
+    }
+
+    if (data->sleeping.load(std::memory_order_seq_cst) > 0)
+    {
+        // Taking the lock makes sure the worker is either waiting already or sees the queued job
+        { std::lock_guard<std::mutex> lock(data->sleepLock); }
+        data->wake.notify_one();
+    }
+}
+
+static S2DJob* FindJob(S2DJobSystemData* data)
+{
+    int queue = GetThreadQueue(data);
+    S2DJob* job = nullptr;
+
+    if (queue >= 0)
+        job = data->queues[queue]->Pop();
+
+    if (!job)
+    {
+        std::lock_guard<std::mutex> lock(data->injectedLock);
+
+        if (!data->injected.empty())
+        {
+            job = data->injected.front();
+            data->injected.pop_front();
+        }
+    }
+
+    // Steal from the other queues, starting after our own one so the thieves spread out
+    int count = (int)data->queues.size();
+
+    for (int i = 1; i <= count && !job; i++)
+    {
+        int victim = (queue + i + count) % count;
+        if (victim == queue) continue;
+
+        job = data->queues[victim]->Steal();
+    }
+
+    if (job) data->queued.fetch_sub(1, std::memory_order_relaxed);
+
+    return job;
+}
+
+static void SpawnChunks(S2DJobSystemData* data, S2DJob* root)
+{
+    for (int begin = 0; begin < root->end; begin += root->chunk)
+    {
+        S2DJob* chunk = AllocateJob(data);
+        chunk->parent = root;
+        chunk->begin = begin;
+        chunk->end = SDL_min(begin + root->chunk, root->end);
+        chunk->dependencies.store(0, std::memory_order_relaxed);
+
+        root->unfinished.fetch_add(1, std::memory_order_relaxed);
+
+        PushJob(data, chunk);
+    }
+}
+
+static void RunJob(S2DJobSystemData* data, S2DJob* job)
+{
+    if (job->parent)
+        job->parent->range(job->begin, job->end);
+    else if (job->range)
+        SpawnChunks(data, job);
+    else if (job->function)
+        job->function();
+
+    FinishJob(data, job);
+}
+
+static void JobWorker(S2DJobSystemData* data, int queue)
+{
+    CurrentSystem = data;
+    CurrentQueue = queue;
+
+    S2DProfiler::SetThreadName(("Job Worker " + std::to_string(queue)).c_str());
+
+    int spins = 0;
+
+    while (!data->quit.load(std::memory_order_relaxed))
+    {
+        S2DJob* job = FindJob(data);
+
+        if (job)
+        {
+            RunJob(data, job);
+            spins = 0;
+            continue;
+        }
+
+        if (++spins < S2D_JOB_SPINS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(data->sleepLock);
+
+        data->sleeping.fetch_add(1, std::memory_order_seq_cst);
+        data->wake.wait(lock, [&]() { return data->quit.load() || data->queued.load(std::memory_order_seq_cst) > 0; });
+        data->sleeping.fetch_sub(1, std::memory_order_seq_cst);
+
+        spins = 0;
+    }
+}
+
+S2DJobSystem::S2DJobSystem(int workers)
+{
+    if (workers <= 0) workers = SDL_max(SDL_GetCPUCount() - 1, 1);
+
+    WorkerCount = workers;
+
+    Data = new S2DJobSystemData();
+
+    for (int i = 0; i <= workers; i++)
+        Data->queues.push_back(new S2DJobQueue());
+
+    S2DMainThreadCall* stub = new S2DMainThreadCall();
+    Data->callHead.store(stub);
+    Data->callTail = stub;
+
+    CurrentSystem = Data;
+    CurrentQueue = 0;
+
+    for (int i = 1; i <= workers; i++)
+        Data->workers.emplace_back(JobWorker, Data, i);
+}
+
+S2DJobSystem::~S2DJobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(Data->sleepLock);
+        Data->quit.store(true);
+    }
+
+    Data->wake.notify_all();
+
+    for (auto& worker : Data->workers)
+        worker.join();
+
+    for (auto queue : Data->queues)
+        delete queue;
+
+    while (Data->callTail)
+    {
+        S2DMainThreadCall* next = Data->callTail->next.load();
+        delete Data->callTail;
+        Data->callTail = next;
+    }
+
+    if (CurrentSystem == Data)
+    {
+        CurrentSystem = nullptr;
+        CurrentQueue = -1;
+    }
+
+    delete Data;
+}
+
+S2DJobHandle S2DJobSystem::Schedule(S2DJobFunction function)
+{
+    return Schedule(std::move(function), nullptr, 0);
+}
+
+S2DJobHandle S2DJobSystem::Schedule(S2DJobFunction function, S2DJobHandle dependency)
+{
+    return Schedule(std::move(function), &dependency, 1);
+}
+
+// Makes the job wait for a dependency that hasn't finished yet
+static void AddDependency(S2DJob* job, S2DJobHandle dependency)
+{
+    S2DJob* other = dependency.job;
+    if (!other) return;
+
+    std::lock_guard<std::mutex> lock(other->lock);
+
+    if (other->generation.load(std::memory_order_relaxed) != dependency.generation || other->finished.load(std::memory_order_relaxed)) return;
+
+    job->dependencies.fetch_add(1, std::memory_order_relaxed);
+    other->continuations.push_back(job);
+}
+
+S2DJobHandle S2DJobSystem::Schedule(S2DJobFunction function, const S2DJobHandle* dependencies, int dependencyCount)
+{
+    S2DJob* job = AllocateJob(Data);
+    job->function = std::move(function);
+
+    S2DJobHandle handle;
+    handle.job = job;
+    handle.generation = job->generation.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < dependencyCount; i++)
+        AddDependency(job, dependencies[i]);
+
+    // Drop the scheduling reference, the last finished dependency pushes the job otherwise
+    if (job->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        PushJob(Data, job);
+
+    return handle;
+}
+
+S2DJobHandle S2DJobSystem::ParallelFor(int count, int minChunk, S2DJobRangeFunction function, S2DJobHandle dependency)
+{
+    // Nothing to run, jobs scheduled after it still wait for the dependency
+    if (count <= 0 || !function) return dependency;
+
+    // A few chunks per thread balance the uneven ones
+    int chunk = count / ((WorkerCount + 1) * 4);
+    chunk = SDL_max(chunk, SDL_max(minChunk, 1));
+
+    S2DJob* root = AllocateJob(Data);
+    root->range = std::move(function);
+    root->end = count;
+    root->chunk = chunk;
+
+    S2DJobHandle handle;
+    handle.job = root;
+    handle.generation = root->generation.load(std::memory_order_relaxed);
+
+    AddDependency(root, dependency);
+
+    // The root spawns the chunks when it runs
+    if (root->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        PushJob(Data, root);
+
+    return handle;
+}
+
+bool S2DJobSystem::IsFinished(S2DJobHandle handle)
+{
+    if (!handle.job) return true;
+
+    if (handle.job->generation.load(std::memory_order_acquire) != handle.generation) return true;
+
+    return handle.job->finished.load(std::memory_order_acquire);
+}
+
+void S2DJobSystem::Wait(S2DJobHandle handle)
+{
+    if (IsFinished(handle)) return;
+
+    S2DProfileZone("Wait Job");
+
+    while (!IsFinished(handle))
+    {
+        if (!RunPendingJob()) std::this_thread::yield();
+    }
+}
+
+bool S2DJobSystem::RunPendingJob()
+{
+    S2DJob* job = FindJob(Data);
+    if (!job) return false;
+
+    RunJob(Data, job);
+
+    return true;
+}
+
+void S2DJobSystem::PostToMainThread(S2DJobFunction function)
+{
+    S2DMainThreadCall* call = new S2DMainThreadCall();
+    call->function = std::move(function);
+
+    S2DMainThreadCall* previous = Data->callHead.exchange(call, std::memory_order_acq_rel);
+    previous->next.store(call, std::memory_order_release);
+}
+
+int S2DJobSystem::RunMainThreadCallbacks()
+{
+    int count = 0;
+
+    for (;;)
+    {
+        S2DMainThreadCall* tail = Data->callTail;
+        S2DMainThreadCall* next = tail->next.load(std::memory_order_acquire);
+
+        if (!next) break;
+
+        // The taken call becomes the new empty tail
+        Data->callTail = next;
+        delete tail;
+
+        S2DJobFunction function = std::move(next->function);
+        next->function = nullptr;
+
+        if (function) function();
+        count++;
+    }
+
+    return count;
+}
+
+Uint64 S2DJobSystem::GetFinishedJobCount()
+{
+    return Data->finishedJobs.load(std::memory_order_relaxed);
+}
+
+void S2DGraphics::SetJobSystem(S2DJobSystem* jobs)
+{
+    if (jobs == JobSystem) return;
+
+    // The decodes in flight still run on the old system
+    if (JobSystem) WaitTextureDecodes();
+
+    if (OwnsJobSystem) delete JobSystem;
+
+    JobSystem = jobs;
+    OwnsJobSystem = false;
+}
+
+S2DJobSystem* S2DGraphics::GetJobSystem()
+{
+    if (!JobSystem)
+    {
+        JobSystem = new S2DJobSystem();
+        OwnsJobSystem = true;
+    }
+
+    return JobSystem;
+}
@@ -0,0 +1,391 @@
+#include "EngineIncludes.h"
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // !_WIN32
+
+static_assert(sizeof(S2DPackHeader) == 40, "S2DPackHeader must not have padding");
+static_assert(sizeof(S2DPackEntry) == 40, "S2DPackEntry must not have padding");
+
+std::string S2DPack::NormalizePath(const char* path)
+{
+    std::string result = S2DTextureCache::NormalizePath(path);
+
+    // Packs are built on any platform, so their paths ignore the case everywhere
+    for (auto& c : result)
+        c = (char)tolower((unsigned char)c);
+
+    return result;
+}
+
+Uint64 S2DPack::HashPath(const std::string& path)
+{
+    // FNV-1a
+    Uint64 hash = 14695981039346656037ULL;
+
+    for (unsigned char c : path)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// Maps a whole file into memory
+static const Uint8* MapFile(const char* path, Uint64* size, void** fileHandle, void** mappingHandle)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    const Uint8* data = (const Uint8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (!data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    *size = (Uint64)fileSize.QuadPart;
+    *fileHandle = file;
+    *mappingHandle = mapping;
+
+    return data;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) return nullptr;
+
+    struct stat info;
+
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        close(file);
+        return nullptr;
+    }
+
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping stays valid after the file is closed
+    close(file);
+
+    if (data == MAP_FAILED) return nullptr;
+
+    *size = (Uint64)info.st_size;
+    *fileHandle = nullptr;
+    *mappingHandle = nullptr;
+
+    return (const Uint8*)data;
+#endif // _WIN32
+}
+
+static void UnmapFile(const Uint8* data, Uint64 size, void* fileHandle, void* mappingHandle)
+{
+    if (!data) return;
+
+#ifdef _WIN32
+    (void)size;
+
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+#else
+    (void)fileHandle;
+    (void)mappingHandle;
+
+    munmap((void*)data, (size_t)size);
+#endif // _WIN32
+}
+
+S2DPack* S2DPack::Open(const char* path)
+{
+    if (!path) return nullptr;
+
+    S2DPack* pack = new S2DPack();
+    pack->FilePath = path;
+    pack->Data = MapFile(path, &pack->Size, &pack->FileHandle, &pack->MappingHandle);
+
+    if (!pack->Data)
+    {
+        SDL_SetError("Cannot open pack %s", path);
+        delete pack;
+        return nullptr;
+    }
+
+    const S2DPackHeader* header = (const S2DPackHeader*)pack->Data;
+
+    bool valid = pack->Size >= sizeof(S2DPackHeader) &&
+                 header->magic == S2D_PACK_MAGIC && header->version == S2D_PACK_VERSION &&
+                 header->indexOffset <= pack->Size && (Uint64)header->entryCount * sizeof(S2DPackEntry) <= pack->Size - header->indexOffset &&
+                 header->namesOffset <= pack->Size && header->namesSize <= pack->Size - header->namesOffset &&
+                 header->indexOffset % alignof(S2DPackEntry) == 0;
+
+    // The paths have to be null-terminated
+    if (valid && header->entryCount > 0)
+        valid = header->namesSize > 0 && pack->Data[header->namesOffset + header->namesSize - 1] == 0;
+
+    if (valid)
+    {
+        pack->Header = header;
+        pack->Entries = (const S2DPackEntry*)(pack->Data + header->indexOffset);
+        pack->Names = (const char*)(pack->Data + header->namesOffset);
+
+        for (Uint32 i = 0; i < header->entryCount && valid; i++)
+        {
+            const S2DPackEntry& entry = pack->Entries[i];
+
+            // Entries are opened as memory streams, so they can't be bigger than 2 GB
+            valid = entry.offset <= pack->Size && entry.size <= pack->Size - entry.offset && entry.nameOffset < header->namesSize &&
+                    entry.rawSize <= SDL_MAX_SINT32 && ((entry.flags & S2D_PACK_LZ4) || entry.rawSize == entry.size);
+        }
+    }
+
+    if (!valid)
+    {
+        SDL_SetError("Corrupted pack %s", path);
+        delete pack;
+        return nullptr;
+    }
+
+    return pack;
+}
+
+S2DPack::~S2DPack()
+{
+    UnmapFile(Data, Size, FileHandle, MappingHandle);
+}
+
+const S2DPackEntry* S2DPack::FindEntry(const char* path)
+{
+    if (!path) return nullptr;
+
+    std::string normalized = NormalizePath(path);
+    Uint64 hash = HashPath(normalized);
+
+    const S2DPackEntry* end = Entries + Header->entryCount;
+    const S2DPackEntry* entry = std::lower_bound(Entries, end, hash, [](const S2DPackEntry& e, Uint64 h) { return e.hash < h; });
+
+    // Different paths can share a hash
+    for (; entry != end && entry->hash == hash; entry++)
+    {
+        if (normalized == Names + entry->nameOffset) return entry;
+    }
+
+    return nullptr;
+}
+
+// Frees the decompressed data together with the stream
+static int SDLCALL CloseDecompressedEntry(SDL_RWops* rw)
+{
+    SDL_free(rw->hidden.mem.base);
+    SDL_FreeRW(rw);
+
+    return 0;
+}
+
+SDL_RWops* S2DPack::OpenEntry(const char* path)
+{
+    const S2DPackEntry* entry = FindEntry(path);
+
+    if (!entry)
+    {
+        SDL_SetError("%s is not in pack %s", path, FilePath.c_str());
+        return nullptr;
+    }
+
+    const Uint8* data = Data + entry->offset;
+
+    if (!(entry->flags & S2D_PACK_LZ4))
+        return SDL_RWFromConstMem(data, (int)entry->size);
+
+    S2DProfileZone("Decompress Pack Entry");
+
+    Uint8* buffer = (Uint8*)SDL_malloc(entry->rawSize ? (size_t)entry->rawSize : 1);
+    if (!buffer) return nullptr;
+
+    if (S2DCompression::Decompress(data, (int)entry->size, buffer, (int)entry->rawSize) != (int)entry->rawSize)
+    {
+        SDL_SetError("Corrupted entry %s in pack %s", path, FilePath.c_str());
+        SDL_free(buffer);
+        return nullptr;
+    }
+
+    SDL_RWops* rw = SDL_RWFromConstMem(buffer, (int)entry->rawSize);
+
+    if (!rw)
+    {
+        SDL_free(buffer);
+        return nullptr;
+    }
+
+    rw->close = CloseDecompressedEntry;
+
+    return rw;
+}
+
+bool S2DPackWriter::AddFile(const char* packPath, const char* filePath)
+{
+    SDL_RWops* file = SDL_RWFromFile(filePath, "rb");
+    if (!file) return false;
+
+    Sint64 size = SDL_RWsize(file);
+
+    std::vector<Uint8> data(size > 0 ? (size_t)size : 0);
+
+    bool read = size >= 0 && (size == 0 || SDL_RWread(file, data.data(), (size_t)size, 1) == 1);
+
+    SDL_RWclose(file);
+
+    if (!read) return false;
+
+    AddData(packPath, data.data(), data.size());
+
+    return true;
+}
+
+void S2DPackWriter::AddData(const char* packPath, const void* data, size_t size)
+{
+    std::string path = S2DPack::NormalizePath(packPath);
+
+    // Adding a path again replaces its data
+    for (auto& item : Items)
+    {
+        if (item.path == path)
+        {
+            item.data.assign((const Uint8*)data, (const Uint8*)data + size);
+            return;
+        }
+    }
+
+    Item item;
+    item.path = path;
+    item.data.assign((const Uint8*)data, (const Uint8*)data + size);
+    Items.push_back(item);
+}
+
+// Writes zeros up to the next aligned position
+static bool WritePadding(SDL_RWops* file, Uint64& position, Uint32 alignment)
+{
+    static const Uint8 zeros[256] = {};
+
+    while (position % alignment)
+    {
+        size_t count = (size_t)SDL_min(alignment - position % alignment, (Uint64)sizeof(zeros));
+
+        if (SDL_RWwrite(file, zeros, 1, count) != count) return false;
+
+        position += count;
+    }
+
+    return true;
+}
+
+bool S2DPackWriter::Write(const char* path, bool compress, Uint32 alignment)
+{
+    // The index has to stay aligned for reading it in place
+    alignment = SDL_max(alignment, (Uint32)alignof(S2DPackEntry));
+
+    SDL_RWops* file = SDL_RWFromFile(path, "wb");
+    if (!file) return false;
+
+    S2DPackHeader header = {};
+    header.magic = S2D_PACK_MAGIC;
+    header.version = S2D_PACK_VERSION;
+    header.entryCount = (Uint32)Items.size();
+    header.alignment = alignment;
+
+    std::vector<S2DPackEntry> entries;
+    std::string names;
+
+    Uint64 position = sizeof(header);
+    bool success = SDL_RWwrite(file, &header, sizeof(header), 1) == 1;
+
+    for (size_t i = 0; i < Items.size() && success; i++)
+    {
+        const Item& item = Items[i];
+
+        S2DPackEntry entry = {};
+        entry.hash = S2DPack::HashPath(item.path);
+        entry.rawSize = item.data.size();
+        entry.nameOffset = (Uint32)names.size();
+
+        names += item.path;
+        names += '\0';
+
+        const Uint8* data = item.data.data();
+        entry.size = item.data.size();
+
+        std::vector<Uint8> compressed;
+
+        if (compress && !item.data.empty() && item.data.size() <= SDL_MAX_SINT32)
+        {
+            compressed.resize(S2DCompression::Bound((int)item.data.size()));
+
+            int size = S2DCompression::Compress(item.data.data(), (int)item.data.size(), compressed.data(), (int)compressed.size());
+
+            // Keep the data as it is when it doesn't compress
+            if (size > 0 && (size_t)size < item.data.size())
+            {
+                entry.flags |= S2D_PACK_LZ4;
+                entry.size = size;
+                data = compressed.data();
+            }
+        }
+
+        success = WritePadding(file, position, alignment);
+
+        entry.offset = position;
+
+        if (success && entry.size)
+            success = SDL_RWwrite(file, data, (size_t)entry.size, 1) == 1;
+
+        position += entry.size;
+
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const S2DPackEntry& a, const S2DPackEntry& b) { return a.hash < b.hash; });
+
+    if (success) success = WritePadding(file, position, alignment);
+
+    header.indexOffset = position;
+
+    if (success && !entries.empty())
+        success = SDL_RWwrite(file, entries.data(), sizeof(S2DPackEntry), entries.size()) == entries.size();
+
+    position += entries.size() * sizeof(S2DPackEntry);
+
+    header.namesOffset = position;
+    header.namesSize = names.size();
+
+    if (success && !names.empty())
+        success = SDL_RWwrite(file, names.data(), 1, names.size()) == names.size();
+
+    // Write the header again with the offsets
+    if (success)
+        success = SDL_RWseek(file, 0, RW_SEEK_SET) == 0 && SDL_RWwrite(file, &header, sizeof(header), 1) == 1;
+
+    if (SDL_RWclose(file) != 0) success = false;
+
+    return success;
+}
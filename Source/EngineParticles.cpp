@@ -0,0 +1,435 @@
+#include "EngineIncludes.h"
+#include <cmath>
+#include <string.h>
+
+// Min. number of particles moved by a single job
+#define S2D_PARTICLES_JOB_SIZE 8192
+
+// Number of particles drawn by a single job
+#define S2D_PARTICLES_RENDER_CHUNK 8192
+
+// Bits kept of every color channel when the untextured particles are grouped by color
+#define S2D_PARTICLES_COLOR_BITS 4
+
+// SSE2 is always there on x64 (and on x86 builds targeting it)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define S2D_PARTICLES_SSE2
+#include <emmintrin.h>
+#endif
+
+// Packs a color with the byte order of SDL_Color
+static inline Uint32 PackColor(SDL_Color color)
+{
+    Uint32 packed;
+    memcpy(&packed, &color, sizeof(packed));
+    return packed;
+}
+
+S2DParticleSystem::S2DParticleSystem(int maxParticles)
+{
+    MaxCount = SDL_max(maxParticles, 0);
+
+    PosX.resize(MaxCount);
+    PosY.resize(MaxCount);
+    VelX.resize(MaxCount);
+    VelY.resize(MaxCount);
+    Age.resize(MaxCount);
+    AgeRate.resize(MaxCount);
+    Size.resize(MaxCount);
+    Colors.resize(MaxCount);
+}
+
+void S2DParticleSystem::SetColors(Color start, Color end)
+{
+    StartColor[0] = start.r;
+    StartColor[1] = start.g;
+    StartColor[2] = start.b;
+    StartColor[3] = start.a;
+
+    EndColor[0] = end.r;
+    EndColor[1] = end.g;
+    EndColor[2] = end.b;
+    EndColor[3] = end.a;
+}
+
+int S2DParticleSystem::AddEmitter(const S2DParticleEmitter& emitter)
+{
+    Emitters.push_back(emitter);
+    SpawnAccumulators.push_back(0.0f);
+
+    return (int)Emitters.size() - 1;
+}
+
+S2DParticleEmitter* S2DParticleSystem::GetEmitter(int index)
+{
+    if (index < 0 || index >= (int)Emitters.size()) return nullptr;
+
+    return &Emitters[index];
+}
+
+void S2DParticleSystem::ClearEmitters()
+{
+    Emitters.clear();
+    SpawnAccumulators.clear();
+}
+
+float S2DParticleSystem::Random(float min, float max)
+{
+    // xorshift32
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 17;
+    RandomState ^= RandomState << 5;
+
+    return min + (max - min) * ((RandomState >> 8) * (1.0f / 16777216.0f));
+}
+
+void S2DParticleSystem::Spawn(const S2DParticleEmitter& emitter)
+{
+    if (Count >= MaxCount) return;
+
+    int i = Count++;
+
+    float angle = (emitter.angle + Random(-0.5f, 0.5f) * emitter.spread) * ((float)M_PI / 180.0f);
+    float speed = Random(emitter.minSpeed, emitter.maxSpeed);
+    float lifetime = Random(emitter.minLifetime, emitter.maxLifetime);
+
+    PosX[i] = emitter.position.x + Random(-0.5f, 0.5f) * emitter.area.x;
+    PosY[i] = emitter.position.y + Random(-0.5f, 0.5f) * emitter.area.y;
+
+    // The Y axis of the world points down on the screen
+    VelX[i] = cosf(angle) * speed;
+    VelY[i] = -sinf(angle) * speed;
+
+    Age[i] = 0.0f;
+    AgeRate[i] = lifetime > 0.0f ? 1.0f / lifetime : 1e9f;
+    Size[i] = Random(emitter.minSize, emitter.maxSize);
+
+    SDL_Color color = { (Uint8)StartColor[0], (Uint8)StartColor[1], (Uint8)StartColor[2], (Uint8)StartColor[3] };
+    Colors[i] = PackColor(color);
+}
+
+void S2DParticleSystem::Burst(int emitter, int count)
+{
+    if (emitter < 0 || emitter >= (int)Emitters.size()) return;
+
+    for (int i = 0; i < count && Count < MaxCount; i++)
+        Spawn(Emitters[emitter]);
+}
+
+void S2DParticleSystem::Integrate(int first, int last, float deltaTime)
+{
+    float damping = expf(-Drag * deltaTime);
+    float gravityX = GravityX * deltaTime;
+    float gravityY = GravityY * deltaTime;
+
+    for (int i = first; i < last; i++)
+    {
+        VelX[i] = (VelX[i] + gravityX) * damping;
+        VelY[i] = (VelY[i] + gravityY) * damping;
+
+        PosX[i] += VelX[i] * deltaTime;
+        PosY[i] += VelY[i] * deltaTime;
+
+        Age[i] += AgeRate[i] * deltaTime;
+
+        float t = SDL_min(Age[i], 1.0f);
+
+        SDL_Color color;
+        color.r = (Uint8)(StartColor[0] + (EndColor[0] - StartColor[0]) * t + 0.5f);
+        color.g = (Uint8)(StartColor[1] + (EndColor[1] - StartColor[1]) * t + 0.5f);
+        color.b = (Uint8)(StartColor[2] + (EndColor[2] - StartColor[2]) * t + 0.5f);
+        color.a = (Uint8)(StartColor[3] + (EndColor[3] - StartColor[3]) * t + 0.5f);
+
+        Colors[i] = PackColor(color);
+    }
+}
+
+void S2DParticleSystem::IntegrateSIMD(int first, int last, float deltaTime)
+{
+#ifdef S2D_PARTICLES_SSE2
+    int end = first + ((last - first) & ~3);
+
+    __m128 dt = _mm_set1_ps(deltaTime);
+    __m128 damping = _mm_set1_ps(expf(-Drag * deltaTime));
+    __m128 gravityX = _mm_set1_ps(GravityX * deltaTime);
+    __m128 gravityY = _mm_set1_ps(GravityY * deltaTime);
+    __m128 one = _mm_set1_ps(1.0f);
+
+    // The start colors include the rounding, the conversion truncates
+    __m128 start[4], range[4];
+
+    for (int c = 0; c < 4; c++)
+    {
+        start[c] = _mm_set1_ps(StartColor[c] + 0.5f);
+        range[c] = _mm_set1_ps(EndColor[c] - StartColor[c]);
+    }
+
+    for (int i = first; i < end; i += 4)
+    {
+        __m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&VelX[i]), gravityX), damping);
+        __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&VelY[i]), gravityY), damping);
+
+        _mm_storeu_ps(&VelX[i], vx);
+        _mm_storeu_ps(&VelY[i], vy);
+
+        _mm_storeu_ps(&PosX[i], _mm_add_ps(_mm_loadu_ps(&PosX[i]), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(&PosY[i], _mm_add_ps(_mm_loadu_ps(&PosY[i]), _mm_mul_ps(vy, dt)));
+
+        __m128 age = _mm_add_ps(_mm_loadu_ps(&Age[i]), _mm_mul_ps(_mm_loadu_ps(&AgeRate[i]), dt));
+        _mm_storeu_ps(&Age[i], age);
+
+        // Blend the colors and pack the channels with the SDL_Color byte order
+        __m128 t = _mm_min_ps(age, one);
+
+        __m128i r = _mm_cvttps_epi32(_mm_add_ps(start[0], _mm_mul_ps(range[0], t)));
+        __m128i g = _mm_cvttps_epi32(_mm_add_ps(start[1], _mm_mul_ps(range[1], t)));
+        __m128i b = _mm_cvttps_epi32(_mm_add_ps(start[2], _mm_mul_ps(range[2], t)));
+        __m128i a = _mm_cvttps_epi32(_mm_add_ps(start[3], _mm_mul_ps(range[3], t)));
+
+        __m128i packed = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+
+        _mm_storeu_si128((__m128i*)&Colors[i], packed);
+    }
+
+    // The last few particles go through the scalar path
+    Integrate(end, last, deltaTime);
+#else
+    Integrate(first, last, deltaTime);
+#endif
+}
+
+void S2DParticleSystem::RemoveDead()
+{
+    for (int i = 0; i < Count;)
+    {
+        if (Age[i] < 1.0f)
+        {
+            i++;
+            continue;
+        }
+
+        // Move the last particle into the free place
+        int last = --Count;
+
+        PosX[i] = PosX[last];
+        PosY[i] = PosY[last];
+        VelX[i] = VelX[last];
+        VelY[i] = VelY[last];
+        Age[i] = Age[last];
+        AgeRate[i] = AgeRate[last];
+        Size[i] = Size[last];
+        Colors[i] = Colors[last];
+    }
+}
+
+void S2DParticleSystem::Update(float deltaTime, S2DJobSystem* jobs)
+{
+    S2DProfileZone("Particles Update");
+
+    auto integrate = [&](int first, int last)
+    {
+        if (UseSIMD)
+            IntegrateSIMD(first, last, deltaTime);
+        else
+            Integrate(first, last, deltaTime);
+    };
+
+    // The particles don't depend on each other, so the ranges can move at the same time
+    if (jobs && Count > S2D_PARTICLES_JOB_SIZE)
+        jobs->Wait(jobs->ParallelFor(Count, S2D_PARTICLES_JOB_SIZE, integrate));
+    else
+        integrate(0, Count);
+
+    RemoveDead();
+
+    for (size_t i = 0; i < Emitters.size(); i++)
+    {
+        if (!Emitters[i].enabled) continue;
+
+        SpawnAccumulators[i] += Emitters[i].rate * deltaTime;
+
+        int count = (int)SpawnAccumulators[i];
+        SpawnAccumulators[i] -= count;
+
+        for (int j = 0; j < count && Count < MaxCount; j++)
+            Spawn(Emitters[i]);
+    }
+}
+
+// Quantized color of a quad, the key of its color group
+static inline int GetColorBucket(SDL_Color color)
+{
+    const int shift = 8 - S2D_PARTICLES_COLOR_BITS;
+
+    int bucket = color.r >> shift;
+    bucket = (bucket << S2D_PARTICLES_COLOR_BITS) | (color.g >> shift);
+    bucket = (bucket << S2D_PARTICLES_COLOR_BITS) | (color.b >> shift);
+    bucket = (bucket << S2D_PARTICLES_COLOR_BITS) | (color.a >> shift);
+
+    return bucket;
+}
+
+// Cuts a channel down to the kept bits, scaled back so full and zero values stay the same
+static inline Uint8 QuantizeChannel(Uint8 value)
+{
+    int kept = value >> (8 - S2D_PARTICLES_COLOR_BITS);
+
+    return (Uint8)(kept * 255 / ((1 << S2D_PARTICLES_COLOR_BITS) - 1));
+}
+
+// Counting sort of the quads by their color bucket
+static void SortQuadsByColor(S2DVertex* vertices, int count, std::vector<int>& counts, std::vector<S2DVertex>& scratch)
+{
+    counts.assign((size_t)1 << (S2D_PARTICLES_COLOR_BITS * 4), 0);
+
+    for (int i = 0; i < count; i++)
+        counts[GetColorBucket(vertices[i * 4].color)]++;
+
+    int offset = 0;
+
+    for (auto& bucket : counts)
+    {
+        int size = bucket;
+        bucket = offset;
+        offset += size;
+    }
+
+    scratch.resize((size_t)count * 4);
+
+    for (int i = 0; i < count; i++)
+    {
+        int target = counts[GetColorBucket(vertices[i * 4].color)]++;
+        memcpy(&scratch[(size_t)target * 4], &vertices[i * 4], 4 * sizeof(S2DVertex));
+    }
+
+    memcpy(vertices, scratch.data(), (size_t)count * 4 * sizeof(S2DVertex));
+}
+
+void S2DGraphics::RenderParticles(S2DCamera* cam, S2DParticleSystem* particles)
+{
+    if (particles->Count == 0) return;
+
+    S2DProfileZone("Render Particles");
+
+    SDL_Texture* texture = NULL;
+    SDL_BlendMode blendMode = SDL_BLENDMODE_BLEND;
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+
+    if (particles->Texture != S2D_INVALID_TEXTURE)
+    {
+        const S2DTextureInfo* info = Textures.GetInfo(particles->Texture);
+        if (!info || !info->texture) return;
+
+        texture = info->texture;
+        SDL_GetTextureBlendMode(texture, &blendMode);
+
+        // Sub-textures use their part of the atlas page (placeholders are drawn whole)
+        int width = 0, height = 0;
+        SDL_QueryTexture(texture, NULL, NULL, &width, &height);
+
+        if (texture != PlaceholderTexture && width > 0 && height > 0)
+        {
+            u0 = (float)info->region.x / width;
+            v0 = (float)info->region.y / height;
+            u1 = (float)(info->region.x + info->region.w) / width;
+            v1 = (float)(info->region.y + info->region.h) / height;
+        }
+    }
+
+    bool premultiply = blendMode == S2DSpriteBatch::GetPremultipliedBlendMode();
+
+    // Without SDL_RenderGeometry the untextured quads are filled once per color, with colors changing over
+    // the life that would be about a call per particle, so the colors are quantized and grouped
+    bool groupColors = !texture && !S2DSpriteBatch::HasGeometry();
+
+    SetDrawCamera(cam);
+
+    S2DVertex* vertices = SpriteBatch.ReserveQuads(texture, blendMode, particles->Count);
+    if (!vertices) return;
+
+    ParticlePoints.resize(particles->Count);
+
+    int chunks = (particles->Count + S2D_PARTICLES_RENDER_CHUNK - 1) / S2D_PARTICLES_RENDER_CHUNK;
+    ParticleChunkQuads.resize(chunks);
+
+    const SDL_Rect& viewport = cam->ViewportRect;
+
+    float startScale = particles->StartScale * cam->Scale * 0.5f;
+    float scaleRange = (particles->EndScale - particles->StartScale) * cam->Scale * 0.5f;
+
+    // Every chunk writes its quads from the place of its first particle, the gaps are closed afterwards
+    auto buildChunks = [&](int firstChunk, int lastChunk)
+    {
+        for (int chunk = firstChunk; chunk < lastChunk; chunk++)
+        {
+            int first = chunk * S2D_PARTICLES_RENDER_CHUNK;
+            int last = SDL_min(first + S2D_PARTICLES_RENDER_CHUNK, particles->Count);
+
+            // The particles of the chunk are moved onto the screen at once
+            cam->Matrix.TransformPoints(particles->PosX.data() + first, particles->PosY.data() + first, ParticlePoints.data() + first, last - first);
+
+            S2DVertex* q = vertices + first * 4;
+
+            for (int i = first; i < last; i++)
+            {
+                float half = particles->Size[i] * (startScale + scaleRange * SDL_min(particles->Age[i], 1.0f));
+                float x = ParticlePoints[i].x;
+                float y = ParticlePoints[i].y;
+
+                if (x + half < viewport.x || y + half < viewport.y || x - half > viewport.x + viewport.w || y - half > viewport.y + viewport.h) continue;
+
+                SDL_Color color;
+                memcpy(&color, &particles->Colors[i], sizeof(color));
+
+                if (premultiply && color.a != 255)
+                {
+                    color.r = (Uint8)((color.r * color.a + 127) / 255);
+                    color.g = (Uint8)((color.g * color.a + 127) / 255);
+                    color.b = (Uint8)((color.b * color.a + 127) / 255);
+                }
+
+                if (groupColors)
+                {
+                    color.r = QuantizeChannel(color.r);
+                    color.g = QuantizeChannel(color.g);
+                    color.b = QuantizeChannel(color.b);
+                    color.a = QuantizeChannel(color.a);
+                }
+
+                q[0] = { { x - half, y - half }, color, { u0, v0 } };
+                q[1] = { { x + half, y - half }, color, { u1, v0 } };
+                q[2] = { { x + half, y + half }, color, { u1, v1 } };
+                q[3] = { { x - half, y + half }, color, { u0, v1 } };
+
+                q += 4;
+            }
+
+            ParticleChunkQuads[chunk] = (int)(q - (vertices + first * 4)) / 4;
+        }
+    };
+
+    if (chunks > 1)
+    {
+        S2DJobSystem* jobs = GetJobSystem();
+        jobs->Wait(jobs->ParallelFor(chunks, 1, buildChunks));
+    }
+    else
+    {
+        buildChunks(0, chunks);
+    }
+
+    int written = ParticleChunkQuads[0];
+
+    for (int chunk = 1; chunk < chunks; chunk++)
+    {
+        int quads = ParticleChunkQuads[chunk];
+
+        memmove(vertices + written * 4, vertices + chunk * S2D_PARTICLES_RENDER_CHUNK * 4, quads * 4 * sizeof(S2DVertex));
+        written += quads;
+    }
+
+    // The pool isn't ordered anyway, so the particles can be reordered by color
+    if (groupColors && written > 1) SortQuadsByColor(vertices, written, ParticleColorCounts, ParticleSortScratch);
+
+    SpriteBatch.CommitQuads(written);
+}
@@ -0,0 +1,276 @@
+#include "EngineIncludes.h"
+#include <cmath>
+
+// Number of circle segments keeping the edges within a quarter of a pixel from the real circle
+static int GetCircleSegments(float radius)
+{
+    if (radius <= 1.0f) return 8;
+
+    int segments = (int)ceilf((float)M_PI / acosf(1.0f - 0.25f / radius));
+
+    // Rounded up, so circles of similar sizes share the tessellation
+    segments = (segments + 7) & ~7;
+
+    return SDL_max(8, SDL_min(segments, 256));
+}
+
+// Splits a polygon into triangles by clipping its ears
+static void TriangulatePolygon(const SDL_FPoint* points, int count, std::vector<int>& indices)
+{
+    if (count < 3) return;
+
+    // The winding decides which corners are convex
+    float area = 0.0f;
+
+    for (int i = 0; i < count; i++)
+    {
+        const SDL_FPoint& a = points[i];
+        const SDL_FPoint& b = points[(i + 1) % count];
+        area += a.x * b.y - b.x * a.y;
+    }
+
+    float winding = area < 0.0f ? -1.0f : 1.0f;
+
+    auto cross = [&](int a, int b, int c)
+    {
+        return ((points[b].x - points[a].x) * (points[c].y - points[a].y) - (points[b].y - points[a].y) * (points[c].x - points[a].x)) * winding;
+    };
+
+    std::vector<int> remaining(count);
+
+    for (int i = 0; i < count; i++)
+        remaining[i] = i;
+
+    while (remaining.size() > 3)
+    {
+        int size = (int)remaining.size();
+        bool clipped = false;
+
+        for (int i = 0; i < size && !clipped; i++)
+        {
+            int a = remaining[(i + size - 1) % size];
+            int b = remaining[i];
+            int c = remaining[(i + 1) % size];
+
+            if (cross(a, b, c) <= 0.0f) continue;
+
+            // An ear doesn't contain any other corner
+            bool ear = true;
+
+            for (int j = 0; j < size && ear; j++)
+            {
+                int p = remaining[j];
+                if (p == a || p == b || p == c) continue;
+
+                ear = !(cross(a, b, p) >= 0.0f && cross(b, c, p) >= 0.0f && cross(c, a, p) >= 0.0f);
+            }
+
+            if (!ear) continue;
+
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+
+            remaining.erase(remaining.begin() + i);
+            clipped = true;
+        }
+
+        // Crossing edges have no ears left, fill the rest as a fan
+        if (!clipped) break;
+    }
+
+    for (size_t i = 1; i + 1 < remaining.size(); i++)
+    {
+        indices.push_back(remaining[0]);
+        indices.push_back(remaining[i]);
+        indices.push_back(remaining[i + 1]);
+    }
+}
+
+// Adds an quad around a line segment
+static void AddThickSegment(SDL_FPoint a, SDL_FPoint b, float thickness, std::vector<SDL_FPoint>& points, std::vector<int>& indices)
+{
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    float length = sqrtf(dx * dx + dy * dy);
+
+    if (length <= 0.0f) return;
+
+    float nx = -dy / length * thickness * 0.5f;
+    float ny = dx / length * thickness * 0.5f;
+
+    int base = (int)points.size();
+
+    points.push_back({ a.x + nx, a.y + ny });
+    points.push_back({ b.x + nx, b.y + ny });
+    points.push_back({ b.x - nx, b.y - ny });
+    points.push_back({ a.x - nx, a.y - ny });
+
+    const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+
+    for (int i = 0; i < 6; i++)
+        indices.push_back(base + quad[i]);
+}
+
+S2DShape S2DShape::Circle(float radius, int segments)
+{
+    if (segments < 3) segments = GetCircleSegments(radius);
+
+    S2DShape shape;
+    shape.Points.reserve(segments + 1);
+    shape.Points.push_back({ 0.0f, 0.0f });
+
+    for (int i = 0; i < segments; i++)
+    {
+        float angle = 2.0f * (float)M_PI * i / segments;
+        shape.Points.push_back({ cosf(angle) * radius, sinf(angle) * radius });
+
+        shape.Indices.push_back(0);
+        shape.Indices.push_back(i + 1);
+        shape.Indices.push_back((i + 1) % segments + 1);
+    }
+
+    shape.UpdateRadius();
+
+    return shape;
+}
+
+S2DShape S2DShape::Polygon(const std::vector<Vec2>& points)
+{
+    S2DShape shape;
+
+    for (auto& point : points)
+        shape.Points.push_back({ point.x, point.y });
+
+    TriangulatePolygon(shape.Points.data(), (int)shape.Points.size(), shape.Indices);
+
+    shape.UpdateRadius();
+
+    return shape;
+}
+
+S2DShape S2DShape::ThickLines(const std::vector<Vec2>& points, float thickness, bool closed)
+{
+    S2DShape shape;
+
+    int count = (int)points.size();
+    int segments = closed && count > 2 ? count : count - 1;
+
+    for (int i = 0; i < segments; i++)
+    {
+        const Vec2& a = points[i];
+        const Vec2& b = points[(i + 1) % count];
+
+        AddThickSegment({ a.x, a.y }, { b.x, b.y }, thickness, shape.Points, shape.Indices);
+    }
+
+    shape.UpdateRadius();
+
+    return shape;
+}
+
+void S2DShape::UpdateRadius()
+{
+    Radius = 0.0f;
+
+    for (auto& point : Points)
+        Radius = SDL_max(Radius, sqrtf(point.x * point.x + point.y * point.y));
+}
+
+const S2DShape& S2DGraphics::GetUnitCircle(int segments)
+{
+    auto it = CircleCache.find(segments);
+
+    if (it == CircleCache.end())
+        it = CircleCache.emplace(segments, S2DShape::Circle(1.0f, segments)).first;
+
+    return it->second;
+}
+
+void S2DGraphics::RenderThickLine(S2DCamera* cam, Vec2 p1, Vec2 p2, float thickness, Color color)
+{
+    SetDrawCamera(cam);
+
+    SDL_FPoint a = cam->Matrix.Transform({ p1.x, p1.y });
+    SDL_FPoint b = cam->Matrix.Transform({ p2.x, p2.y });
+
+    thickness *= cam->Scale;
+
+    if (thickness <= 1.0f)
+    {
+        SpriteBatch.DrawLine(a, b, color);
+        return;
+    }
+
+    ShapePoints.clear();
+    ShapeIndices.clear();
+
+    AddThickSegment(a, b, thickness, ShapePoints, ShapeIndices);
+
+    SpriteBatch.FillTriangles(ShapePoints.data(), (int)ShapePoints.size(), ShapeIndices.data(), (int)ShapeIndices.size(), color);
+}
+
+void S2DGraphics::RenderCircle(S2DCamera* cam, Vec2 pos, float radius, Color color, bool filled)
+{
+    SetDrawCamera(cam);
+
+    if (radius <= 0.0f || !IsOnScreen(cam, pos, Vec2(radius, radius), 0.0f)) return;
+
+    float pixels = radius * cam->Scale;
+
+    const S2DShape& circle = GetUnitCircle(GetCircleSegments(pixels));
+    SDL_FPoint center = cam->Matrix.Transform({ pos.x, pos.y });
+
+    S2DMatrix2D transform = S2DMatrix2D::Translation(center.x, center.y) * S2DMatrix2D::Scale(pixels, pixels);
+
+    ShapePoints.resize(circle.Points.size());
+    transform.TransformPoints(circle.Points.data(), ShapePoints.data(), (int)ShapePoints.size());
+
+    if (filled)
+    {
+        SpriteBatch.FillTriangles(ShapePoints.data(), (int)ShapePoints.size(), circle.Indices.data(), (int)circle.Indices.size(), color);
+        return;
+    }
+
+    // The outline goes around the points after the center
+    int segments = (int)ShapePoints.size() - 1;
+
+    for (int i = 0; i < segments; i++)
+        SpriteBatch.DrawLine(ShapePoints[i + 1], ShapePoints[(i + 1) % segments + 1], color);
+}
+
+void S2DGraphics::RenderPolygon(S2DCamera* cam, const std::vector<Vec2>& points, Color color)
+{
+    if (points.size() < 3) return;
+
+    SetDrawCamera(cam);
+
+    ShapePoints.clear();
+    ShapeIndices.clear();
+
+    for (auto& point : points)
+        ShapePoints.push_back({ point.x, point.y });
+
+    cam->Matrix.TransformPoints(ShapePoints.data(), ShapePoints.data(), (int)ShapePoints.size());
+
+    TriangulatePolygon(ShapePoints.data(), (int)ShapePoints.size(), ShapeIndices);
+
+    SpriteBatch.FillTriangles(ShapePoints.data(), (int)ShapePoints.size(), ShapeIndices.data(), (int)ShapeIndices.size(), color);
+}
+
+void S2DGraphics::RenderShape(S2DCamera* cam, S2DShape* shape, Vec2 pos, float angle, Color color)
+{
+    SetDrawCamera(cam);
+
+    if (shape->Points.empty() || !IsOnScreen(cam, pos, Vec2(shape->Radius, shape->Radius), 0.0f)) return;
+
+    SDL_FPoint center = cam->Matrix.Transform({ pos.x, pos.y });
+
+    // The points are in pixels around the position, turned by the angle and the camera
+    S2DMatrix2D transform = S2DMatrix2D::Translation(center.x, center.y) * S2DMatrix2D::Rotation(angle - cam->Rotation) * S2DMatrix2D::Scale(cam->Scale, cam->Scale);
+
+    ShapePoints.resize(shape->Points.size());
+    transform.TransformPoints(shape->Points.data(), ShapePoints.data(), (int)ShapePoints.size());
+
+    SpriteBatch.FillTriangles(ShapePoints.data(), (int)ShapePoints.size(), shape->Indices.data(), (int)shape->Indices.size(), color);
+}
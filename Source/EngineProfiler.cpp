@@ -0,0 +1,188 @@
+#include "EngineIncludes.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+
+// Number of zones kept per thread (has to be a power of two)
+#define S2D_PROFILER_THREAD_ZONES 65536
+// Number of frame starts kept for the trace export
+#define S2D_PROFILER_FRAMES 512
+
+struct S2DProfileZoneData
+{
+    const char* name;
+    Uint64 start, end;
+};
+
+// Ring buffer of zones written by a single thread
+struct S2DProfileThread
+{
+    int id = 0;
+    std::string name;
+    std::atomic<Uint64> head{ 0 }; // Number of zones ever written
+    S2DProfileZoneData zones[S2D_PROFILER_THREAD_ZONES];
+};
+
+namespace Profiler
+{
+    std::atomic<bool> enabled{ true };
+
+    std::mutex threadsLock;
+    std::vector<S2DProfileThread*> threads;
+
+    thread_local S2DProfileThread* currentThread = nullptr;
+
+    Uint64 frameStarts[S2D_PROFILER_FRAMES];
+    std::atomic<Uint64> frameCount{ 0 };
+
+    S2DProfileThread* GetThread()
+    {
+        if (!currentThread)
+        {
+            S2DProfileThread* thread = new S2DProfileThread();
+
+            std::lock_guard<std::mutex> lock(threadsLock);
+            thread->id = (int)threads.size() + 1;
+            thread->name = "Thread " + std::to_string(thread->id);
+            threads.push_back(thread);
+
+            currentThread = thread;
+        }
+
+        return currentThread;
+    }
+}
+
+void S2DProfiler::SetEnabled(bool state)
+{
+    Profiler::enabled.store(state, std::memory_order_relaxed);
+}
+
+bool S2DProfiler::IsEnabled()
+{
+    return Profiler::enabled.load(std::memory_order_relaxed);
+}
+
+void S2DProfiler::MarkFrame()
+{
+    Uint64 frame = Profiler::frameCount.load(std::memory_order_relaxed);
+    Profiler::frameStarts[frame % S2D_PROFILER_FRAMES] = SDL_GetPerformanceCounter();
+    Profiler::frameCount.store(frame + 1, std::memory_order_release);
+}
+
+void S2DProfiler::SetThreadName(const char* name)
+{
+    S2DProfileThread* thread = Profiler::GetThread();
+
+    std::lock_guard<std::mutex> lock(Profiler::threadsLock);
+    thread->name = name;
+}
+
+void S2DProfiler::RecordZone(const char* name, Uint64 start, Uint64 end)
+{
+    if (!Profiler::enabled.load(std::memory_order_relaxed)) return;
+
+    S2DProfileThread* thread = Profiler::GetThread();
+
+    // Only this thread writes into the buffer, readers check the head to skip overwritten zones
+    Uint64 index = thread->head.load(std::memory_order_relaxed);
+    S2DProfileZoneData& zone = thread->zones[index & (S2D_PROFILER_THREAD_ZONES - 1)];
+    zone.name = name;
+    zone.start = start;
+    zone.end = end;
+    thread->head.store(index + 1, std::memory_order_release);
+}
+
+static void WriteJsonString(FILE* file, const char* str)
+{
+    fputc('"', file);
+
+    for (const char* p = str; *p; p++)
+    {
+        if (*p == '"' || *p == '\\') fputc('\\', file);
+        if ((Uint8)*p >= 0x20) fputc(*p, file);
+    }
+
+    fputc('"', file);
+}
+
+bool S2DProfiler::DumpChromeTrace(const char* path, int frames)
+{
+    Uint64 frameCount = Profiler::frameCount.load(std::memory_order_acquire);
+    if (frameCount == 0 || frames <= 0) return false;
+
+    if (frames > S2D_PROFILER_FRAMES - 1) frames = S2D_PROFILER_FRAMES - 1;
+    if ((Uint64)frames > frameCount) frames = (int)frameCount;
+
+    Uint64 firstFrame = frameCount - frames;
+    Uint64 windowStart = Profiler::frameStarts[firstFrame % S2D_PROFILER_FRAMES];
+
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    double toMicroseconds = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    bool first = true;
+
+    std::vector<S2DProfileThread*> threads;
+    {
+        std::lock_guard<std::mutex> lock(Profiler::threadsLock);
+        threads = Profiler::threads;
+
+        for (auto thread : threads)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", thread->id);
+            WriteJsonString(file, thread->name.c_str());
+            fprintf(file, "}}");
+            first = false;
+        }
+    }
+
+    for (Uint64 frame = firstFrame; frame < frameCount; frame++)
+    {
+        Uint64 start = Profiler::frameStarts[frame % S2D_PROFILER_FRAMES];
+
+        fprintf(file, "%s{\"name\":\"Frame %llu\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":%.3f}", first ? "" : ",\n", (unsigned long long)frame, (start - windowStart) * toMicroseconds);
+        first = false;
+    }
+
+    std::vector<S2DProfileZoneData> zones;
+
+    for (auto thread : threads)
+    {
+        Uint64 head = thread->head.load(std::memory_order_acquire);
+        Uint64 count = head < S2D_PROFILER_THREAD_ZONES ? head : S2D_PROFILER_THREAD_ZONES;
+
+        zones.resize((size_t)count);
+        for (Uint64 i = 0; i < count; i++)
+        {
+            zones[(size_t)i] = thread->zones[(head - count + i) & (S2D_PROFILER_THREAD_ZONES - 1)];
+        }
+
+        // Zones the thread wrote while we were copying may have been overwritten
+        Uint64 newHead = thread->head.load(std::memory_order_acquire);
+        Uint64 firstValid = head - count;
+        if (newHead + 1 > S2D_PROFILER_THREAD_ZONES && newHead + 1 - S2D_PROFILER_THREAD_ZONES > firstValid)
+            firstValid = newHead + 1 - S2D_PROFILER_THREAD_ZONES;
+
+        for (Uint64 i = 0; i < count; i++)
+        {
+            if (head - count + i < firstValid) continue;
+
+            const S2DProfileZoneData& zone = zones[(size_t)i];
+            if (zone.start < windowStart) continue;
+
+            fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+            WriteJsonString(file, zone.name);
+            fprintf(file, ",\"cat\":\"S2D\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", thread->id, (zone.start - windowStart) * toMicroseconds, (zone.end - zone.start) * toMicroseconds);
+            first = false;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    return true;
+}
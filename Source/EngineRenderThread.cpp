@@ -0,0 +1,329 @@
+#include "EngineIncludes.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string.h>
+
+struct S2DRenderThread
+{
+    std::thread thread;
+
+    std::mutex lock;
+    std::condition_variable wake;   // Signaled when a frame is submitted
+    std::condition_variable idle;   // Signaled when the frame is presented
+
+    // Frames swap the buffers, the game records into one while the render thread draws the other
+    S2DRenderCommandBuffer buffers[2];
+    int recording = 0;
+
+    bool ready = false;     // The other buffer holds a finished frame that wasn't submitted yet
+    bool busy = false;      // The render thread is drawing the other buffer
+    bool quit = false;
+
+    // Submits the recorded commands (only used by the thread drawing the frame)
+    SDL_Renderer* renderer = nullptr;
+    S2DSpriteBatch batch;
+    S2DBatchStats stats;
+};
+
+void S2DRenderCommandBuffer::AddRuns(S2DSpriteBatch& batch)
+{
+    int vertexBase = (int)Vertices.size();
+    int indexBase = (int)Indices.size();
+
+    Vertices.insert(Vertices.end(), batch.Vertices.begin(), batch.Vertices.end());
+    Indices.insert(Indices.end(), batch.Indices.begin(), batch.Indices.end());
+
+    Command command = {};
+    command.type = S2DRenderCommandType::Batch;
+    command.firstRun = (int)Runs.size();
+    command.runCount = (int)batch.Runs.size();
+
+    // The indices are relative to the runs, only the runs move
+    for (auto run : batch.Runs)
+    {
+        run.firstVertex += vertexBase;
+        run.firstIndex += indexBase;
+        Runs.push_back(run);
+    }
+
+    Commands.push_back(command);
+}
+
+void S2DRenderCommandBuffer::SetClipRect(const SDL_Rect* rect)
+{
+    Command command = {};
+    command.type = S2DRenderCommandType::ClipRect;
+    command.clip = rect != NULL;
+
+    if (rect) command.rect = *rect;
+
+    Commands.push_back(command);
+}
+
+void S2DRenderCommandBuffer::ClearTarget(Color color)
+{
+    Command command = {};
+    command.type = S2DRenderCommandType::Clear;
+    command.color = { color.r, color.g, color.b, color.a };
+
+    Commands.push_back(command);
+}
+
+void S2DRenderCommandBuffer::Clear()
+{
+    Commands.clear();
+    Vertices.clear();
+    Indices.clear();
+    Runs.clear();
+}
+
+size_t S2DRenderCommandBuffer::GetMemorySize()
+{
+    return Commands.capacity() * sizeof(Command) + Vertices.capacity() * sizeof(S2DVertex) +
+           Indices.capacity() * sizeof(int) + Runs.capacity() * sizeof(S2DSpriteBatch::BatchRun);
+}
+
+void S2DSpriteBatch::SetRecording(S2DRenderCommandBuffer* buffer)
+{
+    Flush();
+    Recording = buffer;
+}
+
+void S2DSpriteBatch::Replay(S2DRenderCommandBuffer& buffer)
+{
+    if (!Renderer || buffer.IsEmpty()) return;
+
+    S2DProfileZone("Replay Commands");
+
+    Flush();
+
+    // The runs point into the geometry of the buffer, borrow it for the submission
+    Vertices.swap(buffer.Vertices);
+    Indices.swap(buffer.Indices);
+
+    for (auto& command : buffer.Commands)
+    {
+        switch (command.type)
+        {
+        case S2DRenderCommandType::Batch:
+            for (int i = 0; i < command.runCount; i++)
+            {
+                SubmitRun(buffer.Runs[command.firstRun + i]);
+            }
+
+            CurrentStats.flushes++;
+            break;
+
+        case S2DRenderCommandType::ClipRect:
+            SDL_RenderSetClipRect(Renderer, command.clip ? &command.rect : NULL);
+            break;
+
+        case S2DRenderCommandType::Clear:
+            SDL_SetRenderDrawColor(Renderer, command.color.r, command.color.g, command.color.b, command.color.a);
+            SDL_RenderClear(Renderer);
+            break;
+        }
+    }
+
+    Vertices.swap(buffer.Vertices);
+    Indices.swap(buffer.Indices);
+}
+
+static void RenderThreadMain(S2DRenderThread* thread)
+{
+    S2DProfiler::SetThreadName("Render Thread");
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(thread->lock);
+            thread->wake.wait(lock, [&]() { return thread->quit || thread->busy; });
+
+            if (thread->quit) return;
+        }
+
+        S2DRenderCommandBuffer& buffer = thread->buffers[thread->recording ^ 1];
+
+        thread->batch.BeginStats();
+        thread->batch.Replay(buffer);
+        thread->batch.EndStats();
+
+        {
+            S2DProfileZone("Present");
+            SDL_RenderPresent(thread->renderer);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(thread->lock);
+            thread->busy = false;
+        }
+
+        thread->idle.notify_all();
+    }
+}
+
+// The renderer is used by one thread at a time, but not always by the one that created it
+static bool CanRenderOnThread(SDL_Renderer* renderer)
+{
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) != 0 || !info.name) return false;
+
+    return !strcmp(info.name, "direct3d") || !strcmp(info.name, "direct3d11") || !strcmp(info.name, "direct3d12") || !strcmp(info.name, "software");
+}
+
+bool S2DGraphics::SetRenderThread(bool state)
+{
+    if (state == (RenderThread != nullptr)) return true;
+
+    if (state)
+    {
+        if (!NativeRenderer || !CanRenderOnThread(NativeRenderer))
+        {
+            S2DDebugOutput("The renderer can't be used from a render thread, drawing on the main thread\n");
+            return false;
+        }
+
+        SpriteBatch.Flush();
+
+        RenderThread = new S2DRenderThread();
+        RenderThread->renderer = NativeRenderer;
+        RenderThread->batch.SetRenderer(NativeRenderer);
+        RenderThread->thread = std::thread(RenderThreadMain, RenderThread);
+
+        SpriteBatch.SetRecording(&RenderThread->buffers[RenderThread->recording]);
+
+        return true;
+    }
+
+    SyncRenderer();
+
+    {
+        std::lock_guard<std::mutex> lock(RenderThread->lock);
+        RenderThread->quit = true;
+    }
+
+    RenderThread->wake.notify_all();
+    RenderThread->thread.join();
+
+    SpriteBatch.SetRecording(nullptr);
+
+    delete RenderThread;
+    RenderThread = nullptr;
+
+    return true;
+}
+
+void S2DGraphics::SubmitFrame()
+{
+    if (!RenderThread) return;
+
+    {
+        std::lock_guard<std::mutex> lock(RenderThread->lock);
+
+        if (!RenderThread->ready) return;
+
+        RenderThread->ready = false;
+        RenderThread->busy = true;
+    }
+
+    RenderThread->wake.notify_one();
+}
+
+void S2DGraphics::FinishRecordedFrame()
+{
+    // The frame before wasn't submitted, it has to be drawn before its buffer gets reused
+    SubmitFrame();
+    WaitRenderThread();
+
+    RenderThread->stats = RenderThread->batch.GetStats();
+
+    // The finished frame waits for SubmitFrame, the next one is recorded into the other buffer
+    RenderThread->recording ^= 1;
+    RenderThread->buffers[RenderThread->recording].Clear();
+    RenderThread->ready = true;
+
+    SpriteBatch.SetRecording(&RenderThread->buffers[RenderThread->recording]);
+}
+
+void S2DGraphics::WaitRenderThread()
+{
+    if (!RenderThread) return;
+
+    std::unique_lock<std::mutex> lock(RenderThread->lock);
+
+    if (!RenderThread->busy) return;
+
+    S2DProfileZone("Wait Render Thread");
+
+    RenderThread->idle.wait(lock, [&]() { return !RenderThread->busy; });
+}
+
+void S2DGraphics::SyncRenderer()
+{
+    SpriteBatch.Flush();
+
+    if (!RenderThread) return;
+
+    WaitRenderThread();
+
+    S2DProfileZone("Sync Renderer");
+
+    // A finished frame that wasn't submitted yet goes first, the renderer is free so it's drawn here
+    if (RenderThread->ready)
+    {
+        RenderThread->ready = false;
+
+        RenderThread->batch.Replay(RenderThread->buffers[RenderThread->recording ^ 1]);
+        SDL_RenderPresent(NativeRenderer);
+    }
+
+    // Then the part of the current frame recorded so far
+    S2DRenderCommandBuffer& buffer = RenderThread->buffers[RenderThread->recording];
+
+    RenderThread->batch.Replay(buffer);
+    buffer.Clear();
+}
+
+void S2DGraphics::DropRecordedFrames(SDL_Renderer* renderer)
+{
+    if (!RenderThread) return;
+
+    WaitRenderThread();
+
+    RenderThread->ready = false;
+    RenderThread->buffers[0].Clear();
+    RenderThread->buffers[1].Clear();
+
+    RenderThread->renderer = renderer;
+    RenderThread->batch.SetRenderer(renderer);
+}
+
+void S2DGraphics::SetRendererClip(const SDL_Rect* rect)
+{
+    if (SpriteBatch.GetRecording())
+        SpriteBatch.GetRecording()->SetClipRect(rect);
+    else
+        SDL_RenderSetClipRect(NativeRenderer, rect);
+}
+
+S2DBatchStats S2DGraphics::GetBatchStats()
+{
+    S2DBatchStats stats = SpriteBatch.GetStats();
+
+    // The geometry is submitted by the render thread
+    if (RenderThread)
+    {
+        stats.vertices = RenderThread->stats.vertices;
+        stats.drawCalls = RenderThread->stats.drawCalls;
+    }
+
+    return stats;
+}
+
+size_t S2DGraphics::GetCommandMemory()
+{
+    if (!RenderThread) return 0;
+
+    return RenderThread->buffers[0].GetMemorySize() + RenderThread->buffers[1].GetMemorySize();
+}
@@ -0,0 +1,282 @@
+#include "EngineIncludes.h"
+#include <cmath>
+
+// Cell key of the objects that don't fit a cell
+#define S2D_SPATIAL_LARGE INT64_MIN
+
+static inline Sint64 MakeCellKey(int x, int y)
+{
+    return ((Sint64)x << 32) | (Uint32)y;
+}
+
+static inline bool RectsOverlap(const SDL_FRect& a, const SDL_FRect& b)
+{
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+S2DSpatialIndex::S2DSpatialIndex(float cellSize)
+{
+    CellSize = cellSize > 0.0f ? cellSize : 1.0f;
+}
+
+void S2DSpatialIndex::SetCellSize(float size)
+{
+    if (size <= 0.0f || size == CellSize) return;
+
+    CellSize = size;
+
+    Cells.clear();
+    LargeObjects.clear();
+
+    for (int id = 0; id < (int)Objects.size(); id++)
+    {
+        if (Objects[id].alive) Link(id);
+    }
+
+    Version++;
+}
+
+Sint64 S2DSpatialIndex::GetCellKey(const SDL_FRect& bounds)
+{
+    // Objects up to a cell big stay within half a cell around their cell
+    if (bounds.w > CellSize || bounds.h > CellSize) return S2D_SPATIAL_LARGE;
+
+    int x = (int)floorf((bounds.x + bounds.w * 0.5f) / CellSize);
+    int y = (int)floorf((bounds.y + bounds.h * 0.5f) / CellSize);
+
+    return MakeCellKey(x, y);
+}
+
+std::vector<int>& S2DSpatialIndex::GetCellObjects(Sint64 key)
+{
+    return key == S2D_SPATIAL_LARGE ? LargeObjects : Cells[key];
+}
+
+void S2DSpatialIndex::Link(int id)
+{
+    Object& object = Objects[id];
+    object.cell = GetCellKey(object.bounds);
+
+    std::vector<int>& list = GetCellObjects(object.cell);
+
+    object.slot = (int)list.size();
+    list.push_back(id);
+}
+
+void S2DSpatialIndex::Unlink(int id)
+{
+    Object& object = Objects[id];
+    std::vector<int>& list = GetCellObjects(object.cell);
+
+    // Move the last object of the cell into the freed slot
+    int moved = list.back();
+    list[object.slot] = moved;
+    Objects[moved].slot = object.slot;
+    list.pop_back();
+
+    if (list.empty() && object.cell != S2D_SPATIAL_LARGE)
+        Cells.erase(object.cell);
+}
+
+int S2DSpatialIndex::Insert(const SDL_FRect& bounds, void* userData)
+{
+    int id;
+
+    if (!FreeIDs.empty())
+    {
+        id = FreeIDs.back();
+        FreeIDs.pop_back();
+    }
+    else
+    {
+        id = (int)Objects.size();
+        Objects.push_back(Object());
+    }
+
+    Object& object = Objects[id];
+    object.bounds = bounds;
+    object.userData = userData;
+    object.alive = true;
+
+    Link(id);
+
+    Count++;
+    Version++;
+
+    return id;
+}
+
+bool S2DSpatialIndex::Update(int id, const SDL_FRect& bounds)
+{
+    if (!Contains(id)) return false;
+
+    Object& object = Objects[id];
+    object.bounds = bounds;
+
+    if (GetCellKey(bounds) != object.cell)
+    {
+        Unlink(id);
+        Link(id);
+    }
+
+    Version++;
+
+    return true;
+}
+
+bool S2DSpatialIndex::Remove(int id)
+{
+    if (!Contains(id)) return false;
+
+    Unlink(id);
+
+    Objects[id].alive = false;
+    Objects[id].userData = nullptr;
+    FreeIDs.push_back(id);
+
+    Count--;
+    Version++;
+
+    return true;
+}
+
+SDL_FRect S2DSpatialIndex::GetBounds(int id)
+{
+    if (!Contains(id)) return { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    return Objects[id].bounds;
+}
+
+void* S2DSpatialIndex::GetUserData(int id)
+{
+    return Contains(id) ? Objects[id].userData : nullptr;
+}
+
+void S2DSpatialIndex::Clear()
+{
+    Cells.clear();
+    LargeObjects.clear();
+    Objects.clear();
+    FreeIDs.clear();
+
+    Count = 0;
+    Version++;
+}
+
+template<typename Test>
+int S2DSpatialIndex::Query(const SDL_FRect& area, Test test, std::vector<int>& results)
+{
+    size_t first = results.size();
+
+    for (int id : LargeObjects)
+    {
+        if (test(Objects[id].bounds)) results.push_back(id);
+    }
+
+    // The objects reach up to half a cell out of their cells
+    float margin = CellSize * 0.5f;
+
+    float minX = floorf((area.x - margin) / CellSize);
+    float minY = floorf((area.y - margin) / CellSize);
+    float maxX = floorf((area.x + area.w + margin) / CellSize);
+    float maxY = floorf((area.y + area.h + margin) / CellSize);
+
+    auto testCell = [&](const std::vector<int>& list)
+    {
+        for (int id : list)
+        {
+            if (test(Objects[id].bounds)) results.push_back(id);
+        }
+    };
+
+    // Areas covering more cells than there are occupied ones walk the occupied cells instead
+    if ((double)(maxX - minX + 1) * (maxY - minY + 1) > (double)Cells.size())
+    {
+        for (auto& cell : Cells)
+        {
+            int x = (int)(cell.first >> 32);
+            int y = (int)(Sint32)(cell.first & 0xFFFFFFFF);
+
+            if (x >= minX && x <= maxX && y >= minY && y <= maxY) testCell(cell.second);
+        }
+    }
+    else
+    {
+        for (int y = (int)minY; y <= (int)maxY; y++)
+        {
+            for (int x = (int)minX; x <= (int)maxX; x++)
+            {
+                auto it = Cells.find(MakeCellKey(x, y));
+                if (it != Cells.end()) testCell(it->second);
+            }
+        }
+    }
+
+    return (int)(results.size() - first);
+}
+
+int S2DSpatialIndex::QueryRect(const SDL_FRect& rect, std::vector<int>& results)
+{
+    return Query(rect, [&](const SDL_FRect& bounds) { return RectsOverlap(bounds, rect); }, results);
+}
+
+int S2DSpatialIndex::QueryRadius(Vec2 center, float radius, std::vector<int>& results)
+{
+    SDL_FRect area = { center.x - radius, center.y - radius, radius * 2.0f, radius * 2.0f };
+
+    return Query(area, [&](const SDL_FRect& bounds)
+    {
+        // Distance from the center to the closest point of the bounds
+        float dx = center.x - SDL_max(bounds.x, SDL_min(center.x, bounds.x + bounds.w));
+        float dy = center.y - SDL_max(bounds.y, SDL_min(center.y, bounds.y + bounds.h));
+
+        return dx * dx + dy * dy <= radius * radius;
+    }, results);
+}
+
+int S2DSpatialIndex::QueryPoint(Vec2 point, std::vector<int>& results)
+{
+    SDL_FRect area = { point.x, point.y, 0.0f, 0.0f };
+
+    return Query(area, [&](const SDL_FRect& bounds) { return RectsOverlap(bounds, area); }, results);
+}
+
+const std::vector<int>& S2DGraphics::GetVisibleObjects(S2DCamera* cam)
+{
+    SDL_FRect view = GetCameraView(cam);
+
+    VisibleObjects* entry = nullptr;
+
+    for (auto& visible : VisibleCache)
+    {
+        if (visible.camera == cam)
+        {
+            entry = &visible;
+            break;
+        }
+    }
+
+    if (!entry)
+    {
+        VisibleCache.push_back(VisibleObjects());
+        entry = &VisibleCache.back();
+        entry->camera = cam;
+        entry->frame = 0;
+    }
+    else if (entry->frame == FrameNumber && entry->version == SpatialIndex.GetVersion() &&
+             entry->view.x == view.x && entry->view.y == view.y && entry->view.w == view.w && entry->view.h == view.h)
+    {
+        return entry->objects;
+    }
+
+    S2DProfileZone("Query Visible Objects");
+
+    entry->objects.clear();
+    SpatialIndex.QueryRect(view, entry->objects);
+
+    entry->frame = FrameNumber;
+    entry->version = SpatialIndex.GetVersion();
+    entry->view = view;
+
+    return entry->objects;
+}
@@ -0,0 +1,608 @@
+#include "EngineIncludes.h"
+#include <cmath>
+
+// Flush automatically when the batch grows over this many quads
+#define S2D_BATCH_MAX_QUADS 16384
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define S2D_HAS_RENDER_GEOMETRY
+static_assert(sizeof(S2DVertex) == sizeof(SDL_Vertex), "S2DVertex must match SDL_Vertex");
+#endif
+
+void S2DSpriteBatch::SetRenderer(SDL_Renderer* renderer)
+{
+    Clear();
+    Renderer = renderer;
+}
+
+SDL_BlendMode S2DSpriteBatch::GetPremultipliedBlendMode()
+{
+    static SDL_BlendMode mode = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                                                           SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+
+    return mode;
+}
+
+bool S2DSpriteBatch::HasGeometry()
+{
+#ifdef S2D_HAS_RENDER_GEOMETRY
+    return true;
+#else
+    return false;
+#endif
+}
+
+void S2DSpriteBatch::BeginStats()
+{
+    CurrentStats = S2DBatchStats();
+    CurrentStats.geometry = HasGeometry();
+}
+
+void S2DSpriteBatch::EndStats()
+{
+    LastStats = CurrentStats;
+}
+
+void S2DSpriteBatch::Clear()
+{
+    Vertices.clear();
+    Indices.clear();
+    Runs.clear();
+}
+
+S2DSpriteBatch::BatchRun* S2DSpriteBatch::GetRun(SDL_Texture* texture, SDL_BlendMode blendMode, S2DBatchPrimitive primitive)
+{
+    if (!Runs.empty() && Runs.back().texture == texture && Runs.back().blendMode == blendMode && Runs.back().primitive == primitive)
+        return &Runs.back();
+
+    BatchRun run;
+    run.texture = texture;
+    run.blendMode = blendMode;
+    run.primitive = primitive;
+    run.textureWidth = run.textureHeight = 0;
+    run.firstVertex = (int)Vertices.size();
+    run.vertexCount = 0;
+    run.firstIndex = (int)Indices.size();
+    run.indexCount = 0;
+
+    if (texture)
+    {
+        SDL_QueryTexture(texture, NULL, NULL, &run.textureWidth, &run.textureHeight);
+
+        if (run.textureWidth <= 0 || run.textureHeight <= 0) return nullptr;
+    }
+
+    Runs.push_back(run);
+
+    return &Runs.back();
+}
+
+void S2DSpriteBatch::CheckSize()
+{
+    if (!Enabled || Vertices.size() >= S2D_BATCH_MAX_QUADS * 4)
+        Flush();
+}
+
+// Premultiplied textures need the tint premultiplied as well, otherwise they can't fade out
+static SDL_Color GetTintColor(SDL_BlendMode blendMode, Color color)
+{
+    SDL_Color tint = { color.r, color.g, color.b, color.a };
+
+    if (blendMode == S2DSpriteBatch::GetPremultipliedBlendMode() && color.a != 255)
+    {
+        tint.r = (Uint8)((color.r * color.a + 127) / 255);
+        tint.g = (Uint8)((color.g * color.a + 127) / 255);
+        tint.b = (Uint8)((color.b * color.a + 127) / 255);
+    }
+
+    return tint;
+}
+
+void S2DSpriteBatch::BuildQuad(S2DVertex* vertices, int textureWidth, int textureHeight, SDL_BlendMode blendMode, const SDL_Rect* src, const SDL_FRect& dst, float angle, const SDL_FPoint* center, TexFlipMode flip, Color color)
+{
+    // Texture coordinates of the source rectangle
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+
+    if (src)
+    {
+        u0 = (float)src->x / textureWidth;
+        v0 = (float)src->y / textureHeight;
+        u1 = (float)(src->x + src->w) / textureWidth;
+        v1 = (float)(src->y + src->h) / textureHeight;
+    }
+
+    if ((int)flip & SDL_FLIP_HORIZONTAL) std::swap(u0, u1);
+    if ((int)flip & SDL_FLIP_VERTICAL) std::swap(v0, v1);
+
+    // Rotation pivot (SDL uses the center of the destination rectangle by default)
+    SDL_FPoint pivot;
+    if (center)
+        pivot = { dst.x + center->x, dst.y + center->y };
+    else
+        pivot = { dst.x + dst.w * 0.5f, dst.y + dst.h * 0.5f };
+
+    float radians = angle * ((float)M_PI / 180.0f);
+    float c = cosf(radians);
+    float s = sinf(radians);
+
+    const float localX[4] = { dst.x - pivot.x, dst.x + dst.w - pivot.x, dst.x + dst.w - pivot.x, dst.x - pivot.x };
+    const float localY[4] = { dst.y - pivot.y, dst.y - pivot.y, dst.y + dst.h - pivot.y, dst.y + dst.h - pivot.y };
+    const float texU[4] = { u0, u1, u1, u0 };
+    const float texV[4] = { v0, v0, v1, v1 };
+
+    SDL_Color vertexColor = GetTintColor(blendMode, color);
+
+    for (int i = 0; i < 4; i++)
+    {
+        vertices[i].position.x = pivot.x + localX[i] * c - localY[i] * s;
+        vertices[i].position.y = pivot.y + localX[i] * s + localY[i] * c;
+        vertices[i].color = vertexColor;
+        vertices[i].texCoord = { texU[i], texV[i] };
+    }
+}
+
+void S2DSpriteBatch::Draw(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, float angle, const SDL_FPoint* center, TexFlipMode flip, Color color)
+{
+    if (!texture) return;
+
+    SDL_BlendMode blendMode;
+    SDL_GetTextureBlendMode(texture, &blendMode);
+
+#ifndef S2D_HAS_RENDER_GEOMETRY
+    // Without SDL_RenderGeometry the quads can't be merged into one call, so they are copied right away
+    // (the recorded runs go first to keep the order), only the recorded frames rebuild the copies from the quads
+    if (!Recording && Renderer)
+    {
+        Flush();
+
+        SDL_Color tint = GetTintColor(blendMode, color);
+        SDL_SetTextureColorMod(texture, tint.r, tint.g, tint.b);
+        SDL_SetTextureAlphaMod(texture, tint.a);
+
+        SDL_RenderCopyExF(Renderer, texture, src, &dst, angle, center, (SDL_RendererFlip)flip);
+
+        CurrentStats.sprites++;
+        CurrentStats.drawCalls++;
+        return;
+    }
+#endif
+
+    BatchRun* current = GetRun(texture, blendMode, S2DBatchPrimitive::Quads);
+    if (!current) return;
+
+    BatchRun& run = *current;
+
+    int base = run.vertexCount;
+
+    Vertices.resize(Vertices.size() + 4);
+    BuildQuad(&Vertices[Vertices.size() - 4], run.textureWidth, run.textureHeight, run.blendMode, src, dst, angle, center, flip, color);
+
+    Indices.push_back(base + 0);
+    Indices.push_back(base + 1);
+    Indices.push_back(base + 2);
+    Indices.push_back(base + 0);
+    Indices.push_back(base + 2);
+    Indices.push_back(base + 3);
+
+    run.vertexCount += 4;
+    run.indexCount += 6;
+
+    CurrentStats.sprites++;
+
+    CheckSize();
+}
+
+S2DVertex* S2DSpriteBatch::ReserveQuads(SDL_Texture* texture, SDL_BlendMode blendMode, int count)
+{
+    if (count <= 0 || !GetRun(texture, blendMode, S2DBatchPrimitive::Quads)) return nullptr;
+
+    ReservedVertex = (int)Vertices.size();
+    Vertices.resize(Vertices.size() + (size_t)count * 4);
+
+    return &Vertices[ReservedVertex];
+}
+
+void S2DSpriteBatch::CommitQuads(int count)
+{
+    if (ReservedVertex < 0) return;
+
+    BatchRun& run = Runs.back();
+
+    Vertices.resize(ReservedVertex + (size_t)count * 4);
+
+    // Indices are relative to the first vertex of the run
+    int base = ReservedVertex - run.firstVertex;
+
+    for (int i = 0; i < count; i++, base += 4)
+    {
+        Indices.push_back(base + 0);
+        Indices.push_back(base + 1);
+        Indices.push_back(base + 2);
+        Indices.push_back(base + 0);
+        Indices.push_back(base + 2);
+        Indices.push_back(base + 3);
+    }
+
+    run.vertexCount += count * 4;
+    run.indexCount += count * 6;
+
+    if (run.texture)
+        CurrentStats.sprites += count;
+    else
+        CurrentStats.primitives += count;
+
+    ReservedVertex = -1;
+
+    // Nothing was written into a new run
+    if (run.vertexCount == 0)
+    {
+        Runs.pop_back();
+        return;
+    }
+
+    CheckSize();
+}
+
+void S2DSpriteBatch::AddVertex(SDL_FPoint position, Color color)
+{
+    S2DVertex v;
+    v.position = position;
+    v.color = { color.r, color.g, color.b, color.a };
+    v.texCoord = { 0.0f, 0.0f };
+    Vertices.push_back(v);
+
+    Runs.back().vertexCount++;
+}
+
+void S2DSpriteBatch::FillRect(const SDL_FRect& rect, Color color)
+{
+    BatchRun* run = GetRun(NULL, PrimitiveBlendMode, S2DBatchPrimitive::Quads);
+
+    int base = run->vertexCount;
+
+    AddVertex({ rect.x, rect.y }, color);
+    AddVertex({ rect.x + rect.w, rect.y }, color);
+    AddVertex({ rect.x + rect.w, rect.y + rect.h }, color);
+    AddVertex({ rect.x, rect.y + rect.h }, color);
+
+    const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+
+    for (int i = 0; i < 6; i++)
+        Indices.push_back(base + quad[i]);
+
+    run->indexCount += 6;
+
+    CurrentStats.primitives++;
+
+    CheckSize();
+}
+
+void S2DSpriteBatch::DrawLine(SDL_FPoint p1, SDL_FPoint p2, Color color)
+{
+    GetRun(NULL, PrimitiveBlendMode, S2DBatchPrimitive::Lines);
+
+    AddVertex(p1, color);
+    AddVertex(p2, color);
+
+    CurrentStats.primitives++;
+
+    CheckSize();
+}
+
+void S2DSpriteBatch::DrawPoint(SDL_FPoint point, Color color)
+{
+    GetRun(NULL, PrimitiveBlendMode, S2DBatchPrimitive::Points);
+
+    AddVertex(point, color);
+
+    CurrentStats.primitives++;
+
+    CheckSize();
+}
+
+void S2DSpriteBatch::FillTriangles(const SDL_FPoint* points, int pointCount, const int* indices, int indexCount, Color color)
+{
+    if (!points || !indices || pointCount <= 0 || indexCount < 3) return;
+
+    BatchRun* run = GetRun(NULL, PrimitiveBlendMode, S2DBatchPrimitive::Triangles);
+
+    int base = run->vertexCount;
+
+    for (int i = 0; i < pointCount; i++)
+        AddVertex(points[i], color);
+
+    for (int i = 0; i < indexCount - indexCount % 3; i++)
+    {
+        if (indices[i] < 0 || indices[i] >= pointCount) continue;
+
+        Indices.push_back(base + indices[i]);
+        run->indexCount++;
+    }
+
+    // Skipped indices would shift the following triangles
+    run->indexCount -= run->indexCount % 3;
+    Indices.resize(run->firstIndex + run->indexCount);
+
+    CurrentStats.primitives++;
+
+    CheckSize();
+}
+
+void S2DSpriteBatch::SubmitRun(BatchRun& run)
+{
+    CurrentStats.vertices += run.vertexCount;
+
+    if (!run.texture)
+    {
+        // The draw state is shared with the direct SDL calls of the game, so it's put back afterwards
+        SDL_BlendMode previous;
+        SDL_GetRenderDrawBlendMode(Renderer, &previous);
+
+        SubmitPrimitives(run);
+
+        SDL_SetRenderDrawBlendMode(Renderer, previous);
+        return;
+    }
+
+#ifdef S2D_HAS_RENDER_GEOMETRY
+    // The color is baked into the vertices, so make sure the texture doesn't modulate it again
+    SDL_SetTextureColorMod(run.texture, 255, 255, 255);
+    SDL_SetTextureAlphaMod(run.texture, 255);
+
+    SDL_RenderGeometry(Renderer, run.texture, (const SDL_Vertex*)&Vertices[run.firstVertex], run.vertexCount, &Indices[run.firstIndex], run.indexCount);
+
+    CurrentStats.drawCalls++;
+#else
+    // SDL_RenderGeometry is not available, rebuild the copy parameters from the quads
+    // and only touch the texture state when the color changes
+    SDL_Color lastColor = { 0, 0, 0, 0 };
+    bool hasColor = false;
+
+    for (int i = 0; i < run.vertexCount; i += 4)
+    {
+        const S2DVertex* q = &Vertices[run.firstVertex + i];
+
+        float edgeX = q[1].position.x - q[0].position.x;
+        float edgeY = q[1].position.y - q[0].position.y;
+        float sideX = q[3].position.x - q[0].position.x;
+        float sideY = q[3].position.y - q[0].position.y;
+
+        float w, h;
+        double angle = 0.0;
+
+        // Most quads aren't rotated, they skip the square roots and the angle
+        if (edgeY == 0.0f && sideX == 0.0f && edgeX >= 0.0f && sideY >= 0.0f)
+        {
+            w = edgeX;
+            h = sideY;
+        }
+        else
+        {
+            w = sqrtf(edgeX * edgeX + edgeY * edgeY);
+            h = sqrtf(sideX * sideX + sideY * sideY);
+            angle = atan2((double)edgeY, (double)edgeX) * (180.0 / M_PI);
+        }
+
+        float cx = (q[0].position.x + q[2].position.x) * 0.5f;
+        float cy = (q[0].position.y + q[2].position.y) * 0.5f;
+
+        int flip = SDL_FLIP_NONE;
+        if (q[0].texCoord.x > q[1].texCoord.x) flip |= SDL_FLIP_HORIZONTAL;
+        if (q[0].texCoord.y > q[3].texCoord.y) flip |= SDL_FLIP_VERTICAL;
+
+        float minU = SDL_min(q[0].texCoord.x, q[1].texCoord.x);
+        float maxU = SDL_max(q[0].texCoord.x, q[1].texCoord.x);
+        float minV = SDL_min(q[0].texCoord.y, q[3].texCoord.y);
+        float maxV = SDL_max(q[0].texCoord.y, q[3].texCoord.y);
+
+        SDL_Rect src;
+        src.x = (int)floorf(minU * run.textureWidth + 0.5f);
+        src.y = (int)floorf(minV * run.textureHeight + 0.5f);
+        src.w = (int)floorf(maxU * run.textureWidth + 0.5f) - src.x;
+        src.h = (int)floorf(maxV * run.textureHeight + 0.5f) - src.y;
+
+        SDL_FRect dst = { cx - w * 0.5f, cy - h * 0.5f, w, h };
+
+        SDL_Color col = q[0].color;
+
+        if (!hasColor || col.r != lastColor.r || col.g != lastColor.g || col.b != lastColor.b || col.a != lastColor.a)
+        {
+            SDL_SetTextureColorMod(run.texture, col.r, col.g, col.b);
+            SDL_SetTextureAlphaMod(run.texture, col.a);
+            lastColor = col;
+            hasColor = true;
+        }
+
+        SDL_RenderCopyExF(Renderer, run.texture, &src, &dst, angle, NULL, (SDL_RendererFlip)flip);
+
+        CurrentStats.drawCalls++;
+    }
+#endif
+}
+
+static inline bool SameColor(const SDL_Color& a, const SDL_Color& b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+#ifndef S2D_HAS_RENDER_GEOMETRY
+// Splits a triangle into one pixel tall spans (pixels with their centers inside are covered)
+static void RasterizeTriangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, std::vector<SDL_FRect>& spans)
+{
+    if (a.y > b.y) std::swap(a, b);
+    if (b.y > c.y) std::swap(b, c);
+    if (a.y > b.y) std::swap(a, b);
+
+    if (c.y - a.y <= 0.0f) return;
+
+    int firstRow = (int)ceilf(a.y - 0.5f);
+    int lastRow = (int)ceilf(c.y - 0.5f);
+
+    for (int row = firstRow; row < lastRow; row++)
+    {
+        float y = row + 0.5f;
+
+        // The long edge from a to c and the short edge on the same side of b
+        float longX = a.x + (c.x - a.x) * (y - a.y) / (c.y - a.y);
+        float shortX;
+
+        if (y < b.y)
+            shortX = a.x + (b.x - a.x) * (y - a.y) / (b.y - a.y);
+        else
+            shortX = c.y > b.y ? b.x + (c.x - b.x) * (y - b.y) / (c.y - b.y) : b.x;
+
+        float left = ceilf(SDL_min(longX, shortX) - 0.5f);
+        float right = ceilf(SDL_max(longX, shortX) - 0.5f);
+
+        if (right > left) spans.push_back({ left, (float)row, right - left, 1.0f });
+    }
+}
+#endif
+
+void S2DSpriteBatch::SubmitPrimitives(BatchRun& run)
+{
+    SDL_SetRenderDrawBlendMode(Renderer, run.blendMode);
+
+    const S2DVertex* v = &Vertices[run.firstVertex];
+
+#ifdef S2D_HAS_RENDER_GEOMETRY
+    // Colored triangles go in a single call
+    if (run.primitive == S2DBatchPrimitive::Quads || run.primitive == S2DBatchPrimitive::Triangles)
+    {
+        SDL_RenderGeometry(Renderer, NULL, (const SDL_Vertex*)v, run.vertexCount, &Indices[run.firstIndex], run.indexCount);
+
+        CurrentStats.drawCalls++;
+        return;
+    }
+#endif
+
+#ifndef S2D_HAS_RENDER_GEOMETRY
+    // Without SDL_RenderGeometry the triangles are filled with spans
+    if (run.primitive == S2DBatchPrimitive::Triangles)
+    {
+        const int* indices = &Indices[run.firstIndex];
+
+        for (int i = 0; i < run.indexCount;)
+        {
+            SDL_Color color = v[indices[i]].color;
+
+            Rects.clear();
+
+            for (; i < run.indexCount && SameColor(v[indices[i]].color, color); i += 3)
+                RasterizeTriangle(v[indices[i]].position, v[indices[i + 1]].position, v[indices[i + 2]].position, Rects);
+
+            if (Rects.empty()) continue;
+
+            SDL_SetRenderDrawColor(Renderer, color.r, color.g, color.b, color.a);
+            SDL_RenderFillRectsF(Renderer, Rects.data(), (int)Rects.size());
+            CurrentStats.drawCalls++;
+        }
+
+        return;
+    }
+#endif
+
+    // The rest is drawn in the draw color, so the primitives are submitted in groups of the same color
+    int first = 0;
+
+    while (first < run.vertexCount)
+    {
+        int count = 1;
+        while (first + count < run.vertexCount && SameColor(v[first + count].color, v[first].color)) count++;
+
+        const SDL_Color& color = v[first].color;
+        SDL_SetRenderDrawColor(Renderer, color.r, color.g, color.b, color.a);
+
+        switch (run.primitive)
+        {
+        case S2DBatchPrimitive::Points:
+        {
+            Points.clear();
+
+            for (int i = first; i < first + count; i++)
+                Points.push_back(v[i].position);
+
+            SDL_RenderDrawPointsF(Renderer, Points.data(), (int)Points.size());
+            CurrentStats.drawCalls++;
+            break;
+        }
+
+        case S2DBatchPrimitive::Lines:
+        {
+            // Segments continuing the previous one are joined into a single line strip
+            for (int i = first; i < first + count; i += 2)
+            {
+                SDL_FPoint start = v[i].position;
+
+                if (Points.empty() || Points.back().x != start.x || Points.back().y != start.y)
+                {
+                    if (Points.size() > 1)
+                    {
+                        SDL_RenderDrawLinesF(Renderer, Points.data(), (int)Points.size());
+                        CurrentStats.drawCalls++;
+                    }
+
+                    Points.clear();
+                    Points.push_back(start);
+                }
+
+                Points.push_back(v[i + 1].position);
+            }
+
+            if (Points.size() > 1)
+            {
+                SDL_RenderDrawLinesF(Renderer, Points.data(), (int)Points.size());
+                CurrentStats.drawCalls++;
+            }
+
+            Points.clear();
+            break;
+        }
+
+#ifndef S2D_HAS_RENDER_GEOMETRY
+        case S2DBatchPrimitive::Quads:
+        {
+            // Filled rectangles are recorded as four corners
+            Rects.clear();
+
+            for (int i = first; i < first + count; i += 4)
+                Rects.push_back({ v[i].position.x, v[i].position.y, v[i + 2].position.x - v[i].position.x, v[i + 2].position.y - v[i].position.y });
+
+            SDL_RenderFillRectsF(Renderer, Rects.data(), (int)Rects.size());
+            CurrentStats.drawCalls++;
+            break;
+        }
+#endif
+
+        default:
+            break;
+        }
+
+        first += count;
+    }
+}
+
+void S2DSpriteBatch::Flush()
+{
+    if (Runs.empty()) return;
+
+    S2DProfileZone("Batch Flush");
+
+    if (Recording)
+    {
+        Recording->AddRuns(*this);
+
+        CurrentStats.flushes++;
+    }
+    else if (Renderer)
+    {
+        for (auto& run : Runs)
+        {
+            SubmitRun(run);
+        }
+
+        CurrentStats.flushes++;
+    }
+
+    Clear();
+}
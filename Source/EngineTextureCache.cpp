@@ -0,0 +1,121 @@
+#include "EngineIncludes.h"
+#include <ctype.h>
+
+std::string S2DTextureCache::NormalizePath(const char* path)
+{
+    std::string result;
+    if (!path) return result;
+
+    bool absolute = *path == '/' || *path == '\\';
+
+    std::vector<std::string> parts;
+
+    for (const char* p = path; *p;)
+    {
+        const char* end = p;
+        while (*end && *end != '/' && *end != '\\') end++;
+
+        std::string part(p, end - p);
+
+        if (part == "..")
+        {
+            // Parent directory, drop the previous part if there's one
+            if (!parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else if (!absolute)
+                parts.push_back(part);
+        }
+        else if (!part.empty() && part != ".")
+        {
+            parts.push_back(part);
+        }
+
+        p = *end ? end + 1 : end;
+    }
+
+    if (absolute) result += '/';
+
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (i > 0) result += '/';
+        result += parts[i];
+    }
+
+#ifdef _WIN32
+    // File names are not case sensitive on Windows
+    for (auto& c : result)
+        c = (char)tolower((unsigned char)c);
+#endif // _WIN32
+
+    return result;
+}
+
+S2DTexture* S2DTextureCache::Acquire(const std::string& path)
+{
+    auto it = Entries.find(path);
+
+    if (it == Entries.end())
+    {
+        Misses++;
+        return nullptr;
+    }
+
+    Hits++;
+
+    it->second.references++;
+    References++;
+
+    return it->second.texture;
+}
+
+const char* S2DTextureCache::Insert(const std::string& path, S2DTexture* texture)
+{
+    auto it = Entries.emplace(path, Entry{ texture, 1 }).first;
+    References++;
+
+    return it->first.c_str();
+}
+
+bool S2DTextureCache::Release(S2DTexture* texture)
+{
+    if (!texture || !texture->GetPath()) return false;
+
+    auto it = Entries.find(texture->GetPath());
+    if (it == Entries.end() || it->second.texture != texture) return false;
+
+    References--;
+
+    if (--it->second.references > 0) return false;
+
+    Entries.erase(it);
+
+    return true;
+}
+
+int S2DTextureCache::GetReferences(S2DTexture* texture)
+{
+    if (!texture || !texture->GetPath()) return 0;
+
+    auto it = Entries.find(texture->GetPath());
+    if (it == Entries.end() || it->second.texture != texture) return 0;
+
+    return it->second.references;
+}
+
+S2DTextureCacheStats S2DTextureCache::GetStats()
+{
+    S2DTextureCacheStats stats;
+
+    stats.hits = Hits;
+    stats.misses = Misses;
+    stats.textures = (int)Entries.size();
+    stats.references = References;
+
+    return stats;
+}
+
+void S2DTextureCache::Clear()
+{
+    Entries.clear();
+    References = 0;
+}
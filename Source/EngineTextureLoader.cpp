@@ -0,0 +1,348 @@
+#include "EngineIncludes.h"
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+// Size of the placeholder checkerboard texture
+#define S2D_PLACEHOLDER_SIZE 8
+
+enum S2DTextureRequestState
+{
+    S2D_REQUEST_QUEUED,
+    S2D_REQUEST_DECODING
+};
+
+struct S2DTextureRequest
+{
+    // Main thread only
+    S2DTexture* texture = nullptr;
+    int handle = S2D_INVALID_TEXTURE;
+    bool canceled = false;
+    std::vector<S2DTextureCallback> callbacks;
+    S2DJobHandle job;
+    bool decodedHere = false;   // Decoded by WaitTexture, freed once the job comes back
+
+    // Set before the request is queued, read by the job
+    std::string path;
+    bool cooked = false;
+
+    // Whoever moves the state from queued to decoding decodes the image (the job or WaitTexture)
+    std::atomic<int> state{ S2D_REQUEST_QUEUED };
+
+    // Written by the decoding thread
+    SDL_Surface* surface = nullptr;
+    S2DCookedTextureHeader header = {};
+};
+
+struct S2DTextureLoader
+{
+    std::mutex lock;
+    std::deque<S2DTextureRequest*> decoded;   // Waiting for the upload, protected by the lock
+
+    // Number of decoding jobs that haven't finished yet
+    std::atomic<int> running{ 0 };
+
+    // Requests of the textures that are still loading (main thread only)
+    std::unordered_map<int, S2DTextureRequest*> requests;
+};
+
+// Decodes an image into the usual texture format (cooked textures are only read)
+static void DecodeTexture(S2DTextureRequest* request)
+{
+    S2DProfileZone("Decode Texture");
+
+    if (request->cooked)
+        request->surface = S2DCookedTexture::Load(request->path.c_str(), &request->header);
+    else
+        request->surface = S2DCookedTexture::DecodeImage(request->path.c_str());
+}
+
+static void DecodeTextureJob(S2DTextureLoader* loader, S2DTextureRequest* request)
+{
+    int queued = S2D_REQUEST_QUEUED;
+
+    // WaitTexture may have decoded it already, the request still comes back so the main thread knows the job is done with it
+    if (request->state.compare_exchange_strong(queued, S2D_REQUEST_DECODING))
+        DecodeTexture(request);
+
+    {
+        std::lock_guard<std::mutex> lock(loader->lock);
+        loader->decoded.push_back(request);
+    }
+
+    loader->running--;
+}
+
+void S2DGraphics::CreatePlaceholderTexture()
+{
+    Uint32 pixels[S2D_PLACEHOLDER_SIZE * S2D_PLACEHOLDER_SIZE];
+
+    // Magenta and black checkerboard
+    for (int y = 0; y < S2D_PLACEHOLDER_SIZE; y++)
+    {
+        for (int x = 0; x < S2D_PLACEHOLDER_SIZE; x++)
+        {
+            bool odd = ((x / (S2D_PLACEHOLDER_SIZE / 2)) + (y / (S2D_PLACEHOLDER_SIZE / 2))) & 1;
+            pixels[y * S2D_PLACEHOLDER_SIZE + x] = odd ? 0xFF000000 : 0xFFFF00FF;
+        }
+    }
+
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+
+    PlaceholderTexture = SDL_CreateTexture(NativeRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, S2D_PLACEHOLDER_SIZE, S2D_PLACEHOLDER_SIZE);
+
+    if (PlaceholderTexture)
+        SDL_UpdateTexture(PlaceholderTexture, NULL, pixels, S2D_PLACEHOLDER_SIZE * sizeof(Uint32));
+}
+
+int S2DGraphics::LoadTextureAsync(const char* fileName, S2DTextureCallback callback)
+{
+    std::string path = S2DTextureCache::NormalizePath(fileName);
+
+    S2DTexture* t = TextureCache.Acquire(path);
+
+    if (t)
+    {
+        if (t->loading)
+        {
+            if (callback) Loader->requests[t->textureID]->callbacks.push_back(callback);
+        }
+        else if (callback)
+        {
+            callback(t->textureID, t->GetSDLTexture() != NULL);
+        }
+
+        return t->textureID;
+    }
+
+    if (!Loader)
+    {
+        // The image libraries are loaded lazily and that isn't thread safe, so load them up front
+        IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG);
+
+        Loader = new S2DTextureLoader();
+    }
+
+    t = new S2DTexture(PlaceholderTexture, NULL);
+    t->loading = true;
+
+    int handle = Textures.Add(t);
+
+    if (handle == S2D_INVALID_TEXTURE)
+    {
+        delete t;
+        return S2D_INVALID_TEXTURE;
+    }
+
+    t->texPath = TextureCache.Insert(path, t);
+
+    S2DTextureRequest* request = new S2DTextureRequest();
+    request->texture = t;
+    request->handle = handle;
+    request->path = path;
+    request->cooked = S2DCookedTexture::IsCookedPath(path.c_str());
+
+    if (callback) request->callbacks.push_back(callback);
+
+    Loader->requests[handle] = request;
+
+    S2DTextureLoader* loader = Loader;
+
+    loader->running++;
+    request->job = GetJobSystem()->Schedule([loader, request]() { DecodeTextureJob(loader, request); });
+
+    return handle;
+}
+
+TextureState S2DGraphics::GetTextureState(int textureID)
+{
+    if (!Textures.IsValid(textureID)) return TextureState::Invalid;
+
+    S2DTexture* tex = Textures.Get(textureID);
+
+    if (tex->loading) return TextureState::Loading;
+
+    return tex->GetSDLTexture() ? TextureState::Ready : TextureState::Failed;
+}
+
+bool S2DGraphics::WaitTexture(int textureID)
+{
+    if (!Loader || !Textures.IsValid(textureID)) return GetTextureState(textureID) == TextureState::Ready;
+
+    auto it = Loader->requests.find(textureID);
+    if (it == Loader->requests.end()) return GetTextureState(textureID) == TextureState::Ready;
+
+    S2DTextureRequest* request = it->second;
+
+    S2DProfileZone("Wait Texture");
+
+    int queued = S2D_REQUEST_QUEUED;
+
+    // Don't wait for a worker if none has picked the request up yet
+    if (request->state.compare_exchange_strong(queued, S2D_REQUEST_DECODING))
+    {
+        DecodeTexture(request);
+        request->decodedHere = true;
+    }
+    else
+    {
+        GetJobSystem()->Wait(request->job);
+
+        std::lock_guard<std::mutex> lock(Loader->lock);
+
+        auto decoded = std::find(Loader->decoded.begin(), Loader->decoded.end(), request);
+        if (decoded != Loader->decoded.end()) Loader->decoded.erase(decoded);
+    }
+
+    FinishTextureRequest(request);
+
+    return GetTextureState(textureID) == TextureState::Ready;
+}
+
+int S2DGraphics::GetPendingTextureCount()
+{
+    return Loader ? (int)Loader->requests.size() : 0;
+}
+
+void S2DGraphics::UploadDecodedTextures()
+{
+    // Canceled requests aren't pending anymore, but they still come back decoded and have to be freed
+    if (!Loader) return;
+
+    S2DProfileZone("Texture Uploads");
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 budget = (Uint64)(UploadBudget * SDL_GetPerformanceFrequency() / 1000.0);
+
+    // At least one texture is uploaded every frame, so a tiny budget can't stall the loading
+    for (;;)
+    {
+        S2DTextureRequest* request;
+
+        {
+            std::lock_guard<std::mutex> lock(Loader->lock);
+
+            if (Loader->decoded.empty()) break;
+
+            request = Loader->decoded.front();
+            Loader->decoded.pop_front();
+        }
+
+        if (request->decodedHere)
+            delete request;
+        else
+            FinishTextureRequest(request);
+
+        if (SDL_GetPerformanceCounter() - start >= budget) break;
+    }
+}
+
+void S2DGraphics::FinishTextureRequest(S2DTextureRequest* request)
+{
+    if (request->canceled)
+    {
+        if (request->surface) SDL_FreeSurface(request->surface);
+        delete request;
+        return;
+    }
+
+    Loader->requests.erase(request->handle);
+
+    S2DTexture* tex = request->texture;
+    SDL_Surface* surface = request->surface;
+    request->surface = nullptr;
+
+    bool loaded = false;
+
+    tex->loading = false;
+    tex->nativeTexture = NULL;
+
+    // The renderer can't create textures while the render thread draws with it
+    WaitRenderThread();
+
+    if (surface && request->cooked)
+    {
+        loaded = UploadCookedTexture(tex, surface, request->header);
+
+        if (loaded && KeepTexturePixels)
+            tex->pixels = surface;
+        else
+            SDL_FreeSurface(surface);
+    }
+    else if (surface)
+    {
+        SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+
+        tex->nativeTexture = SDL_CreateTextureFromSurface(NativeRenderer, surface);
+
+        if (tex->nativeTexture)
+        {
+            SDL_QueryTexture(tex->nativeTexture, NULL, NULL, &tex->width, &tex->height);
+            loaded = true;
+        }
+
+        if (loaded && KeepTexturePixels)
+            tex->pixels = surface;
+        else
+            SDL_FreeSurface(surface);
+    }
+
+    if (!loaded)
+        tex->width = tex->height = 0;
+
+    Textures.Update(request->handle);
+
+    for (auto& callback : request->callbacks)
+    {
+        callback(request->handle, loaded);
+    }
+
+    if (!request->decodedHere) delete request;
+}
+
+void S2DGraphics::CancelTextureLoad(S2DTexture* tex)
+{
+    if (!Loader || !tex->loading) return;
+
+    auto it = Loader->requests.find(tex->textureID);
+    if (it == Loader->requests.end()) return;
+
+    // The job may still be decoding it, the request is freed once it comes back
+    it->second->canceled = true;
+    it->second->texture = nullptr;
+
+    Loader->requests.erase(it);
+
+    tex->loading = false;
+    tex->nativeTexture = NULL;
+}
+
+void S2DGraphics::WaitTextureDecodes()
+{
+    if (!Loader) return;
+
+    // The waiting thread helps with the jobs, the decodes may run on other threads too
+    while (Loader->running > 0)
+    {
+        if (!JobSystem->RunPendingJob()) std::this_thread::yield();
+    }
+}
+
+void S2DGraphics::ShutdownTextureLoader()
+{
+    if (!Loader) return;
+
+    WaitTextureDecodes();
+
+    // Every request (canceled ones too) ends up decoded
+    for (auto request : Loader->decoded)
+    {
+        if (request->surface) SDL_FreeSurface(request->surface);
+        delete request;
+    }
+
+    delete Loader;
+    Loader = nullptr;
+}
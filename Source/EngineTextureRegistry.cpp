@@ -0,0 +1,126 @@
+#include "EngineIncludes.h"
+
+int S2DTextureRegistry::GetSlot(int handle)
+{
+    if (handle < 0) return -1;
+
+    int slot = handle & S2D_TEXTURE_INDEX_MASK;
+    Uint16 generation = (Uint16)((handle >> S2D_TEXTURE_INDEX_BITS) & S2D_TEXTURE_GENERATION_MASK);
+
+    if (slot >= (int)Objects.size() || Generations[slot] != generation || !Objects[slot])
+    {
+#ifndef NDEBUG
+        // Using an handle of an unloaded texture is a bug in the game code
+        S2DAssert(!"Stale or invalid texture handle");
+#endif // NDEBUG
+        return -1;
+    }
+
+    return slot;
+}
+
+int S2DTextureRegistry::Add(S2DTexture* texture)
+{
+    int slot;
+
+    if (!FreeSlots.empty())
+    {
+        slot = FreeSlots.back();
+        FreeSlots.pop_back();
+    }
+    else
+    {
+        if (Objects.size() > S2D_TEXTURE_INDEX_MASK) return S2D_INVALID_TEXTURE;
+
+        slot = (int)Objects.size();
+
+        Infos.emplace_back();
+        Objects.push_back(nullptr);
+        Generations.push_back(1);
+    }
+
+    Objects[slot] = texture;
+    Count++;
+
+    int handle = slot | ((int)Generations[slot] << S2D_TEXTURE_INDEX_BITS);
+
+    texture->textureID = handle;
+    Update(handle);
+
+    return handle;
+}
+
+bool S2DTextureRegistry::Remove(int handle)
+{
+    int slot = GetSlot(handle);
+    if (slot < 0) return false;
+
+    Objects[slot]->textureID = S2D_INVALID_TEXTURE;
+    Objects[slot] = nullptr;
+    Infos[slot] = S2DTextureInfo();
+
+    // Bump the generation so the old handles become stale (0 is never used)
+    Uint16 generation = (Generations[slot] + 1) & S2D_TEXTURE_GENERATION_MASK;
+    Generations[slot] = generation ? generation : 1;
+
+    FreeSlots.push_back(slot);
+    Count--;
+
+    return true;
+}
+
+void S2DTextureRegistry::Update(int handle)
+{
+    int slot = GetSlot(handle);
+    if (slot < 0) return;
+
+    Infos[slot] = Objects[slot]->GetInfo();
+
+    // The sub-textures sort together with their atlas page, they're drawn from the same SDL texture
+    S2DTexture* page = Objects[slot]->page;
+    Infos[slot].sortID = page && page->textureID != S2D_INVALID_TEXTURE ? (page->textureID & S2D_TEXTURE_INDEX_MASK) : slot;
+}
+
+bool S2DTextureRegistry::IsValid(int handle)
+{
+    if (handle < 0) return false;
+
+    int slot = handle & S2D_TEXTURE_INDEX_MASK;
+
+    return slot < (int)Objects.size() && Objects[slot] && Generations[slot] == ((handle >> S2D_TEXTURE_INDEX_BITS) & S2D_TEXTURE_GENERATION_MASK);
+}
+
+S2DTexture* S2DTextureRegistry::Get(int handle)
+{
+    int slot = GetSlot(handle);
+    return slot < 0 ? nullptr : Objects[slot];
+}
+
+const S2DTextureInfo* S2DTextureRegistry::GetInfo(int handle)
+{
+    int slot = GetSlot(handle);
+    return slot < 0 ? nullptr : &Infos[slot];
+}
+
+void S2DTextureRegistry::Clear()
+{
+    FreeSlots.clear();
+
+    for (size_t i = 0; i < Objects.size(); i++)
+    {
+        // The textures may already be destroyed, so they are not touched here
+        if (Objects[i])
+        {
+            Objects[i] = nullptr;
+            Infos[i] = S2DTextureInfo();
+
+            Uint16 generation = (Generations[i] + 1) & S2D_TEXTURE_GENERATION_MASK;
+            Generations[i] = generation ? generation : 1;
+        }
+
+        // Reuse the lowest slots first
+        FreeSlots.push_back((int)(Objects.size() - 1 - i));
+    }
+
+    Count = 0;
+}
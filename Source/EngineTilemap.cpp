@@ -0,0 +1,440 @@
+#include "EngineIncludes.h"
+#include <algorithm>
+#include <cmath>
+
+S2DTilemap::S2DTilemap(int width, int height, Vec2 tileSize, int chunkSize) : TileSize(tileSize)
+{
+    Width = SDL_max(width, 1);
+    Height = SDL_max(height, 1);
+    ChunkSize = SDL_max(chunkSize, 1);
+
+    ChunksX = (Width + ChunkSize - 1) / ChunkSize;
+    ChunksY = (Height + ChunkSize - 1) / ChunkSize;
+
+    Chunks.resize((size_t)ChunksX * ChunksY);
+}
+
+S2DTilemap::~S2DTilemap()
+{
+    ReleaseChunks();
+}
+
+void S2DTilemap::SetTileset(int textureID, Vec2Int tilePixels, int spacing, int margin)
+{
+    Tileset = textureID;
+    TilePixels.x = SDL_max(tilePixels.x, 1);
+    TilePixels.y = SDL_max(tilePixels.y, 1);
+    Spacing = SDL_max(spacing, 0);
+    Margin = SDL_max(margin, 0);
+
+    // The chunk render targets are sized by the tile pixels
+    ReleaseChunks();
+    Invalidate();
+}
+
+int S2DTilemap::AddLayer()
+{
+    Layer layer;
+    layer.tiles.resize((size_t)Width * Height, S2D_TILE_EMPTY);
+
+    Layers.push_back(layer);
+
+    return (int)Layers.size() - 1;
+}
+
+void S2DTilemap::SetLayerVisible(int layer, bool state)
+{
+    if (layer < 0 || layer >= (int)Layers.size() || Layers[layer].visible == state) return;
+
+    Layers[layer].visible = state;
+    Invalidate();
+}
+
+bool S2DTilemap::IsLayerVisible(int layer)
+{
+    return layer >= 0 && layer < (int)Layers.size() && Layers[layer].visible;
+}
+
+void S2DTilemap::SetTile(int layer, int x, int y, Uint16 tile)
+{
+    if (layer < 0 || layer >= (int)Layers.size() || x < 0 || y < 0 || x >= Width || y >= Height) return;
+
+    Uint16& current = Layers[layer].tiles[(size_t)y * Width + x];
+    if (current == tile) return;
+
+    current = tile;
+    MarkDirty(x, y, 1, 1);
+}
+
+Uint16 S2DTilemap::GetTile(int layer, int x, int y)
+{
+    if (layer < 0 || layer >= (int)Layers.size() || x < 0 || y < 0 || x >= Width || y >= Height) return S2D_TILE_EMPTY;
+
+    return Layers[layer].tiles[(size_t)y * Width + x];
+}
+
+void S2DTilemap::Fill(int layer, int x, int y, int w, int h, Uint16 tile)
+{
+    if (layer < 0 || layer >= (int)Layers.size()) return;
+
+    int x0 = SDL_max(x, 0), y0 = SDL_max(y, 0);
+    int x1 = SDL_min(x + w, Width), y1 = SDL_min(y + h, Height);
+
+    if (x0 >= x1 || y0 >= y1) return;
+
+    for (int row = y0; row < y1; row++)
+    {
+        Uint16* tiles = &Layers[layer].tiles[(size_t)row * Width];
+        std::fill(tiles + x0, tiles + x1, tile);
+    }
+
+    MarkDirty(x0, y0, x1 - x0, y1 - y0);
+}
+
+bool S2DTilemap::WorldToTile(Vec2 position, int* x, int* y)
+{
+    int tileX = (int)floorf((position.x - Position.x) / TileSize.x);
+    int tileY = (int)floorf((position.y - Position.y) / TileSize.y);
+
+    if (x) *x = tileX;
+    if (y) *y = tileY;
+
+    return tileX >= 0 && tileY >= 0 && tileX < Width && tileY < Height;
+}
+
+void S2DTilemap::MarkDirty(int x, int y, int w, int h)
+{
+    for (int cy = y / ChunkSize; cy <= (y + h - 1) / ChunkSize; cy++)
+    {
+        for (int cx = x / ChunkSize; cx <= (x + w - 1) / ChunkSize; cx++)
+            Chunks[(size_t)cy * ChunksX + cx].dirty = true;
+    }
+}
+
+void S2DTilemap::Invalidate()
+{
+    for (auto& chunk : Chunks)
+        chunk.dirty = true;
+}
+
+void S2DTilemap::ReleaseChunks()
+{
+    if (Owner) Owner->DestroyTilemapChunks(this);
+}
+
+void S2DGraphics::DestroyTilemapChunks(S2DTilemap* map)
+{
+    // The sprite batch and the render thread can still hold quads of the chunks
+    SyncRenderer();
+
+    for (int index : map->BakedChunks)
+    {
+        S2DTilemap::Chunk& chunk = map->Chunks[index];
+
+        // A recreated renderer destroyed the old render targets already
+        if (map->RendererGeneration == RendererGeneration) SDL_DestroyTexture(chunk.texture);
+
+        chunk.texture = nullptr;
+        chunk.dirty = true;
+    }
+
+    map->BakedChunks.clear();
+}
+
+void S2DGraphics::DrawTilemapTiles(S2DTilemap* map, int chunk, const S2DTextureInfo& tileset, const SDL_FRect& dst, float angle, Color color)
+{
+    int firstX = (chunk % map->ChunksX) * map->ChunkSize;
+    int firstY = (chunk / map->ChunksX) * map->ChunkSize;
+    int tilesX = SDL_min(map->ChunkSize, map->Width - firstX);
+    int tilesY = SDL_min(map->ChunkSize, map->Height - firstY);
+
+    int cellW = map->TilePixels.x + map->Spacing;
+    int cellH = map->TilePixels.y + map->Spacing;
+    int columns = SDL_max((tileset.width - map->Margin * 2 + map->Spacing) / cellW, 1);
+    int rows = SDL_max((tileset.height - map->Margin * 2 + map->Spacing) / cellH, 1);
+
+    float tileW = dst.w / tilesX;
+    float tileH = dst.h / tilesY;
+
+    // Turned chunks move the tile centers around the chunk center
+    S2DMatrix2D turn = S2DMatrix2D::Translation(dst.x + dst.w * 0.5f, dst.y + dst.h * 0.5f) * S2DMatrix2D::Rotation(angle) *
+                       S2DMatrix2D::Translation(-dst.x - dst.w * 0.5f, -dst.y - dst.h * 0.5f);
+
+    for (auto& layer : map->Layers)
+    {
+        if (!layer.visible) continue;
+
+        for (int y = 0; y < tilesY; y++)
+        {
+            const Uint16* tiles = &layer.tiles[(size_t)(firstY + y) * map->Width + firstX];
+
+            for (int x = 0; x < tilesX; x++)
+            {
+                if (tiles[x] == S2D_TILE_EMPTY || tiles[x] > columns * rows) continue;
+
+                int index = tiles[x] - 1;
+
+                SDL_Rect frame = { map->Margin + (index % columns) * cellW, map->Margin + (index / columns) * cellH, map->TilePixels.x, map->TilePixels.y };
+
+                if (angle != 0.0f)
+                {
+                    SDL_FPoint center = turn.Transform({ dst.x + (x + 0.5f) * tileW, dst.y + (y + 0.5f) * tileH });
+
+                    DrawTextureRegion(tileset, &frame, { center.x - tileW * 0.5f, center.y - tileH * 0.5f, tileW, tileH }, angle, TexFlipMode::None, color);
+                    continue;
+                }
+
+                // Snap the tiles to whole pixels, so there are no gaps between them
+                float left = floorf(dst.x + x * tileW + 0.5f);
+                float top = floorf(dst.y + y * tileH + 0.5f);
+                float right = floorf(dst.x + (x + 1) * tileW + 0.5f);
+                float bottom = floorf(dst.y + (y + 1) * tileH + 0.5f);
+
+                DrawTextureRegion(tileset, &frame, { left, top, right - left, bottom - top }, 0.0f, TexFlipMode::None, color);
+            }
+        }
+    }
+}
+
+bool S2DGraphics::CanBlendPremultiplied()
+{
+    if (PremultipliedBlendGeneration == RendererGeneration) return PremultipliedBlend;
+
+    WaitRenderThread();
+
+    SDL_Texture* texture = SDL_CreateTexture(NativeRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 1, 1);
+
+    PremultipliedBlend = texture && SDL_SetTextureBlendMode(texture, S2DSpriteBatch::GetPremultipliedBlendMode()) == 0;
+    PremultipliedBlendGeneration = RendererGeneration;
+
+    if (texture) SDL_DestroyTexture(texture);
+
+    return PremultipliedBlend;
+}
+
+bool S2DGraphics::BakeTilemapChunk(S2DTilemap* map, int index, const S2DTextureInfo& tileset)
+{
+    S2DTilemap::Chunk& chunk = map->Chunks[index];
+
+    int firstX = (index % map->ChunksX) * map->ChunkSize;
+    int firstY = (index / map->ChunksX) * map->ChunkSize;
+    int tilesX = SDL_min(map->ChunkSize, map->Width - firstX);
+    int tilesY = SDL_min(map->ChunkSize, map->Height - firstY);
+
+    // Chunks without any tiles don't need a render target
+    chunk.empty = true;
+
+    for (auto& layer : map->Layers)
+    {
+        if (!layer.visible) continue;
+
+        for (int y = 0; y < tilesY && chunk.empty; y++)
+        {
+            const Uint16* tiles = &layer.tiles[(size_t)(firstY + y) * map->Width + firstX];
+
+            for (int x = 0; x < tilesX; x++)
+            {
+                if (tiles[x] != S2D_TILE_EMPTY)
+                {
+                    chunk.empty = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (chunk.empty)
+    {
+        chunk.dirty = false;
+        return true;
+    }
+
+    if (!chunk.texture)
+    {
+        SDL_RendererInfo info;
+        if (SDL_GetRendererInfo(NativeRenderer, &info) != 0 || !(info.flags & SDL_RENDERER_TARGETTEXTURE)) return false;
+
+        int width = tilesX * map->TilePixels.x;
+        int height = tilesY * map->TilePixels.y;
+
+        if ((info.max_texture_width && width > info.max_texture_width) || (info.max_texture_height && height > info.max_texture_height)) return false;
+
+        // The baked colors end up multiplied by the alpha, the usual blending would darken the soft edges
+        if (!CanBlendPremultiplied()) return false;
+
+        WaitRenderThread();
+
+        SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+
+        chunk.texture = SDL_CreateTexture(NativeRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (!chunk.texture) return false;
+
+        // The tiles are blended into a transparent target, which leaves their colors multiplied by the alpha
+        if (SDL_SetTextureBlendMode(chunk.texture, S2DSpriteBatch::GetPremultipliedBlendMode()) != 0)
+        {
+            SDL_DestroyTexture(chunk.texture);
+            chunk.texture = NULL;
+            return false;
+        }
+
+        map->BakedChunks.push_back(index);
+    }
+
+    S2DProfileZone("Bake Tilemap Chunk");
+
+    // The target is switched on the renderer directly, everything recorded before has to be drawn first
+    SyncRenderer();
+
+    SDL_Texture* previousTarget = SDL_GetRenderTarget(NativeRenderer);
+
+    if (SDL_SetRenderTarget(NativeRenderer, chunk.texture) != 0) return false;
+
+    SDL_SetRenderDrawColor(NativeRenderer, 0, 0, 0, 0);
+    SDL_RenderClear(NativeRenderer);
+
+    int width = 0, height = 0;
+    SDL_QueryTexture(chunk.texture, NULL, NULL, &width, &height);
+
+    DrawTilemapTiles(map, index, tileset, { 0.0f, 0.0f, (float)width, (float)height }, 0.0f, Color::White());
+
+    SyncRenderer();
+
+    SDL_SetRenderTarget(NativeRenderer, previousTarget);
+
+    chunk.dirty = false;
+    map->Stats.bakedChunks++;
+
+    return true;
+}
+
+void S2DGraphics::RenderTilemap(S2DCamera* cam, S2DTilemap* map, Color color)
+{
+    const S2DTextureInfo* tileset = Textures.GetInfo(map->Tileset);
+
+    // The chunks are baked once the tileset is loaded
+    if (!tileset || !tileset->texture || tileset->texture == PlaceholderTexture) return;
+
+    S2DProfileZone("Render Tilemap");
+
+    // Render targets of another renderer are gone, lost contents are baked again
+    if (map->Owner != this || map->RendererGeneration != RendererGeneration)
+    {
+        if (map->Owner && map->Owner != this) map->ReleaseChunks();
+
+        for (int index : map->BakedChunks)
+            map->Chunks[index].texture = nullptr;
+
+        map->BakedChunks.clear();
+        map->Invalidate();
+
+        map->Owner = this;
+        map->RendererGeneration = RendererGeneration;
+        map->TargetGeneration = TargetGeneration;
+    }
+    else if (map->TargetGeneration != TargetGeneration)
+    {
+        map->Invalidate();
+        map->TargetGeneration = TargetGeneration;
+    }
+
+    map->Draws++;
+    map->Stats = S2DTilemapStats();
+
+    float chunkW = map->ChunkSize * map->TileSize.x;
+    float chunkH = map->ChunkSize * map->TileSize.y;
+
+    // Only the chunks overlapping the view are visited
+    SDL_FRect view = GetCameraView(cam);
+
+    int firstX = SDL_max((int)floorf((view.x - map->Position.x) / chunkW), 0);
+    int firstY = SDL_max((int)floorf((view.y - map->Position.y) / chunkH), 0);
+    int lastX = SDL_min((int)floorf((view.x + view.w - map->Position.x) / chunkW), map->ChunksX - 1);
+    int lastY = SDL_min((int)floorf((view.y + view.h - map->Position.y) / chunkH), map->ChunksY - 1);
+
+    SetDrawCamera(cam);
+
+    const S2DMatrix2D& matrix = cam->Matrix;
+    float angle = -cam->Rotation;
+
+    for (int cy = firstY; cy <= lastY; cy++)
+    {
+        for (int cx = firstX; cx <= lastX; cx++)
+        {
+            int index = cy * map->ChunksX + cx;
+            S2DTilemap::Chunk& chunk = map->Chunks[index];
+
+            map->Stats.visibleChunks++;
+            chunk.lastDrawn = map->Draws;
+
+            bool baked = !chunk.dirty || BakeTilemapChunk(map, index, *tileset);
+
+            if (chunk.empty) continue;
+
+            // World rectangle of the used tiles (the last chunks can be smaller)
+            float worldX = map->Position.x + cx * chunkW;
+            float worldY = map->Position.y + cy * chunkH;
+            float worldW = SDL_min(map->ChunkSize, map->Width - cx * map->ChunkSize) * map->TileSize.x;
+            float worldH = SDL_min(map->ChunkSize, map->Height - cy * map->ChunkSize) * map->TileSize.y;
+
+            SDL_FRect rect;
+
+            if (angle == 0.0f)
+            {
+                SDL_FPoint topLeft = matrix.Transform({ worldX, worldY });
+                SDL_FPoint bottomRight = matrix.Transform({ worldX + worldW, worldY + worldH });
+
+                // Snap the edges to whole pixels, so the chunks meet without gaps
+                float left = floorf(topLeft.x + 0.5f);
+                float top = floorf(topLeft.y + 0.5f);
+                float right = floorf(bottomRight.x + 0.5f);
+                float bottom = floorf(bottomRight.y + 0.5f);
+
+                rect = { left, top, right - left, bottom - top };
+            }
+            else
+            {
+                // Turned chunks are drawn around their centers
+                SDL_FPoint center = matrix.Transform({ worldX + worldW * 0.5f, worldY + worldH * 0.5f });
+
+                float width = worldW * cam->ViewportRect.w / 16.0f * cam->Scale;
+                float height = worldH * cam->ViewportRect.h / 16.0f * cam->Scale;
+
+                rect = { center.x - width * 0.5f, center.y - height * 0.5f, width, height };
+            }
+
+            if (baked)
+            {
+                SpriteBatch.Draw(chunk.texture, NULL, rect, angle, NULL, TexFlipMode::None, color);
+            }
+            else
+            {
+                // The renderer can't bake it, draw the tiles one by one
+                DrawTilemapTiles(map, index, *tileset, rect, angle, color);
+                map->Stats.directChunks++;
+            }
+        }
+    }
+
+    // Chunks that weren't seen for a while give their render targets back
+    for (size_t i = 0; i < map->BakedChunks.size();)
+    {
+        S2DTilemap::Chunk& chunk = map->Chunks[map->BakedChunks[i]];
+
+        if (map->Draws - chunk.lastDrawn > (Uint64)map->ChunkLifetime)
+        {
+            SyncRenderer();
+            SDL_DestroyTexture(chunk.texture);
+
+            chunk.texture = nullptr;
+            chunk.dirty = true;
+
+            map->BakedChunks[i] = map->BakedChunks.back();
+            map->BakedChunks.pop_back();
+            continue;
+        }
+
+        i++;
+    }
+
+    map->Stats.chunkTextures = (int)map->BakedChunks.size();
+}
@@ -105,7 +105,7 @@ public:
     // Here comes all the reload stuff
     void OnRenderReload() override
     {
-        player = S2DSprite(Graphics->LoadTextureRaw("data\\sprites\\player.png"), { {17, 18}, {17, 18}, {17, 18} }, 15);
+        // Loaded textures are reloaded in place by the engine, so the player sprite keeps working
         font.UpdateRenderer(Graphics->GetRenderer());
     }
 
@@ -251,9 +251,12 @@ public:
             Graphics->RenderFilledBox(&cam, Vec2(b->currentPos, b->holePos + b->holeSize), Vec2(0.5f, 0), Vec2(150, 1024), Color::Green());
         }
 
+        // The percentiles sort the whole window, they are refreshed on a timer
         if (fpsTime >= 0.075f)
         {
-            sprintf(frameRateText, "%.0f fps (%.1f ms)", roundf(GetFrameRate()), GetFrameTime());
+            S2DFrameStats stats = GetFrameStats();
+
+            sprintf(frameRateText, "%.0f fps (%.1f ms, p99: %.1f ms, 1%% low: %.0f fps)", roundf(stats.averageFps), stats.frame.mean, stats.frame.p99, roundf(stats.onePercentLowFps));
             fpsTime = 0;
         }
 
@@ -359,6 +362,9 @@ public:
             }
         }*/
 
+        // Draw everything batched so far before ImGui renders through Direct3D
+        Graphics->FlushBatch();
+
         ImGui::Render();
         ImGui_ImplDX9_RenderDrawData(ImGui::GetDrawData());
     }